@@ -360,10 +360,37 @@ namespace DdsFileTypePlugin
 	{
 		public	DdsFile()
 		{
-			m_header = new DdsHeader();
+			m_header		= new DdsHeader();
+			m_cancelFlag	= new DdsSquish.CancelFlag();
+		}
+
+		// Stops a Save or CopyToSurface running on another thread at the next tile of blocks.
+		// The interrupted call throws OperationCanceledException. The flag is cleared when the
+		// call finishes, so a cancel that arrives while it is starting up is not lost.
+		public	void	Cancel()
+		{
+			m_cancelFlag.Cancel();
+		}
+
+		// Squish lists its packed formats in the same order as the uncompressed DdsFileFormats.
+		private	static	int		GetPackedFormat( DdsFileFormat fileFormat )
+		{
+			return ( int )fileFormat - ( int )DdsFileFormat.DDS_FORMAT_A8R8G8B8;
 		}
 
 		public	void	Save( System.IO.Stream output, Surface surface, DdsSaveConfigToken ddsToken, ProgressEventHandler progressCallback )
+		{
+			try
+			{
+				SaveSurface( output, surface, ddsToken, progressCallback );
+			}
+			finally
+			{
+				m_cancelFlag.Reset();
+			}
+		}
+
+		private	void	SaveSurface( System.IO.Stream output, Surface surface, DdsSaveConfigToken ddsToken, ProgressEventHandler progressCallback )
 		{
 			// For non-compressed textures, we need pixel width.
 			int pixelWidth	= 0;
@@ -481,6 +508,26 @@ namespace DdsFileTypePlugin
 			m_header.Write( output );
 
 			int	squishFlags = ddsToken.GetSquishFlags();
+
+			// Every format filters the smaller levels the same way, from one level to the next
+			// with an alpha weighted box filter.
+			int	mipmapFlags	= ( int )( DdsSquish.MipmapFlags.kMipmapBox | DdsSquish.MipmapFlags.kMipmapWeightByAlpha );
+
+			if ( isCompressed )
+			{
+				// Let squish resample and compress the whole mip chain from the main surface, 
+				// filtering each level while the one before is still compressing.
+				DdsSquish.ProgressFn chainProgressFn =
+					delegate( int workDone, int workTotal )
+					{
+						progressCallback( this, new ProgressEventArgs( 100.0 * ( double )workDone / ( double )workTotal ) );
+					};
+
+				byte[]	blockData	= DdsSquish.CompressMipmaps( surface, squishFlags, mipCount, mipmapFlags, ( progressCallback == null ) ? null : chainProgressFn, m_cancelFlag );
+
+				output.Write( blockData, 0, blockData.Length );
+				return;
+			}
 		
 			// Our output data array will be sized as necessary
 			byte[]	outputData;
@@ -519,154 +566,50 @@ namespace DdsFileTypePlugin
             mipWidth = surface.Width;
             mipHeight = surface.Height;
 
+			// Let squish filter the smaller levels just as it does for the compressed formats
+			byte[]	mipData			= ( mipCount > 1 ) ? DdsSquish.GenerateMipmaps( surface, mipCount, mipmapFlags, null, m_cancelFlag ) : null;
+			int		mipDataOffset	= 0;
+
             for (int mipLoop = 0; mipLoop < mipCount; mipLoop++)
 			{
                 Size writeSize = writeSizes[mipLoop];
-				Surface	writeSurface = new Surface(writeSize);
+				int	mipPitch = pixelWidth * writeSize.Width;
+
+				// From the DDS documents I read, I'd expected the pitch of each mip level to be
+				// DWORD aligned. As it happens, that's not the case. Re-aligning the pitch of 
+				// each level results in later mips getting sheared as the pitch is incorrect.
+				// So, the following line is intentionally optional. Maybe the documentation
+				// is referring to the pitch when accessing the mip directly.. who knows. 
+				//
+				// Infact, all the talk of non-compressed textures having DWORD alignment of pitch
+				// seems to be bollocks.. If I apply alignment, then they fail to load in 3rd Party
+				// or Microsoft DDS viewing applications.
+				//
+
+#if	APPLY_PITCH_ALIGNMENT
+				mipPitch = ( mipPitch + 3 ) & ( ~3 );
+#endif // APPLY_PITCH_ALIGNMENT
+
+				// Let squish pack the rows straight from the surface or the filtered levels, 
+				// reporting progress through the whole chain in pixels
+				long				previousMipsPixelsDone	= pixelsCompleted[ mipLoop ];
+				int					mipRowPixels			= writeSize.Width;
+				DdsSquish.ProgressFn	mipProgressFn			=
+					delegate( int workDone, int workTotal )
+					{
+						double progress = ( ( double )workDone * ( double )mipRowPixels + ( double )previousMipsPixelsDone ) / ( double )totalPixels;
+						progressCallback( this, new ProgressEventArgs( 100.0 * progress ) );
+					};
 
 				if ( mipLoop == 0 )
 				{
 					// No point resampling the first level.. it's got exactly what we want.
-					writeSurface = surface;
+					outputData = DdsSquish.PackImage( surface, GetPackedFormat( ddsToken.m_fileFormat ), mipPitch, ( progressCallback == null ) ? null : mipProgressFn, m_cancelFlag );
 				}
 				else
 				{
-					// I'd love to have a UI component to select what kind of resampling, but
-					// there's hardly any space for custom UI stuff in the Save Dialog. And I'm
-					// not having any scrollbars in there..! 
-					// Also, note that each mip level is formed from the main level, to reduce
-					// compounded errors when generating mips. 
-					writeSurface.SuperSamplingFitSurface( surface );
-                }
-
-                DdsSquish.ProgressFn progressFn =
-                    delegate(int workDone, int workTotal)
-                    {
-                        long thisMipPixelsDone = workDone * (long)mipWidth;
-                        long previousMipsPixelsDone = pixelsCompleted[mipLoop];
-                        double progress = (double)((double)thisMipPixelsDone + (double)previousMipsPixelsDone) / (double)totalPixels;
-                        progressCallback(this, new ProgressEventArgs(100.0 * progress));
-                    };
-
-				if ( ( ddsToken.m_fileFormat >= DdsFileFormat.DDS_FORMAT_DXT1 ) && ( ddsToken.m_fileFormat <= DdsFileFormat.DDS_FORMAT_DXT5 ) )
-					outputData = DdsSquish.CompressImage( writeSurface, squishFlags, (progressCallback == null) ? null : progressFn );
-				else
-				{
-					int	mipPitch = pixelWidth * writeSurface.Width;
-
-					// From the DDS documents I read, I'd expected the pitch of each mip level to be
-					// DWORD aligned. As it happens, that's not the case. Re-aligning the pitch of 
-					// each level results in later mips getting sheared as the pitch is incorrect.
-					// So, the following line is intentionally optional. Maybe the documentation
-					// is referring to the pitch when accessing the mip directly.. who knows. 
-					//
-					// Infact, all the talk of non-compressed textures having DWORD alignment of pitch
-					// seems to be bollocks.. If I apply alignment, then they fail to load in 3rd Party
-					// or Microsoft DDS viewing applications.
-					//
-
-#if	APPLY_PITCH_ALIGNMENT
-					mipPitch = ( mipPitch + 3 ) & ( ~3 );
-#endif // APPLY_PITCH_ALIGNMENT
-
-					outputData = new byte[ mipPitch * writeSurface.Height ];
-					outputData.Initialize();
-
-					for ( int y = 0; y < writeSurface.Height; y++ )
-					{
-						for ( int x = 0; x < writeSurface.Width; x++ )
-						{
-							// Get colour from surface
-							ColorBgra	pixelColour = writeSurface.GetPoint( x, y );
-							uint		pixelData	= 0;
-					
-							switch( ddsToken.m_fileFormat )
-							{
-								case	DdsFileFormat.DDS_FORMAT_A8R8G8B8:
-								{
-									pixelData = ( ( uint )pixelColour.A << 24 ) | 
-												( ( uint )pixelColour.R << 16 ) |
-												( ( uint )pixelColour.G <<  8 ) |
-												( ( uint )pixelColour.B <<  0 );
-									break;
-								}
-
-								case	DdsFileFormat.DDS_FORMAT_X8R8G8B8:
-								{
-									pixelData = ( ( uint )pixelColour.R << 16 ) |
-												( ( uint )pixelColour.G <<  8 ) |
-												( ( uint )pixelColour.B <<  0 );
-									break;
-								}
-
-								case	DdsFileFormat.DDS_FORMAT_A8B8G8R8:
-								{
-									pixelData = ( ( uint )pixelColour.A << 24 ) | 
-												( ( uint )pixelColour.B << 16 ) |
-												( ( uint )pixelColour.G <<  8 ) |
-												( ( uint )pixelColour.R <<  0 );
-									break;
-								}
-
-								case	DdsFileFormat.DDS_FORMAT_X8B8G8R8:
-								{
-									pixelData = ( ( uint )pixelColour.B << 16 ) |
-												( ( uint )pixelColour.G <<  8 ) |
-												( ( uint )pixelColour.R <<  0 );
-									break;
-								}
-								
-								case	DdsFileFormat.DDS_FORMAT_A1R5G5B5:
-								{
-									pixelData = ( ( uint )( ( pixelColour.A != 0 ) ? 1 : 0 ) << 15 ) |
-												( ( uint )( pixelColour.R >> 3 ) << 10 ) |
-												( ( uint )( pixelColour.G >> 3 ) <<  5 ) |
-												( ( uint )( pixelColour.B >> 3 ) <<  0 );
-									break;
-								}
-
-								case	DdsFileFormat.DDS_FORMAT_A4R4G4B4:
-								{
-									pixelData = ( ( uint )( pixelColour.A >> 4 ) << 12 ) | 
-												( ( uint )( pixelColour.R >> 4 ) <<  8 ) |
-												( ( uint )( pixelColour.G >> 4 ) <<  4 ) |
-												( ( uint )( pixelColour.B >> 4 ) <<  0 );
-									break;
-								}
-
-								case	DdsFileFormat.DDS_FORMAT_R8G8B8:
-								{
-									pixelData = ( ( uint )pixelColour.R << 16 ) |
-												( ( uint )pixelColour.G <<  8 ) |
-												( ( uint )pixelColour.B <<  0 );
-									break;
-								}
-
-								case	DdsFileFormat.DDS_FORMAT_R5G6B5:
-								{
-									pixelData = ( ( uint )( pixelColour.R >> 3 ) << 11 ) |
-												( ( uint )( pixelColour.G >> 2 ) <<  5 ) |
-												( ( uint )( pixelColour.B >> 3 ) <<  0 );
-									break;
-								}
-							}
-
-							// pixelData contains our target data.. so now set the pixel bytes
-							int	pixelOffset	= ( y * mipPitch ) + ( x * pixelWidth );
-							for ( int loop = 0; loop < pixelWidth; loop++ )
-							{
-								outputData[ pixelOffset + loop ] = ( byte )( ( pixelData >> ( 8 * loop ) ) & 0xff );
-							}
-						}
-
-                        if (progressCallback != null)
-                        {
-                            long thisMipPixelsDone = (y + 1) * (long)mipWidth;
-                            long previousMipsPixelsDone = pixelsCompleted[mipLoop];
-                            double progress = (double)((double)thisMipPixelsDone + (double)previousMipsPixelsDone) / (double)totalPixels;
-                            progressCallback(this, new ProgressEventArgs(100.0 * progress));
-                        }
-					}
+					outputData = DdsSquish.PackImage( mipData, mipDataOffset, writeSize, GetPackedFormat( ddsToken.m_fileFormat ), mipPitch, ( progressCallback == null ) ? null : mipProgressFn, m_cancelFlag );
+					mipDataOffset += 4 * writeSize.Width * writeSize.Height;
 				}
 
 				// Write the data for this mip level out.. 
@@ -717,8 +660,9 @@ namespace DdsFileTypePlugin
 				byte[] compressedBlocks = new byte[ blockCount * blockSize ];
 				input.Read( compressedBlocks, 0, compressedBlocks.GetLength( 0 ) );
 
-				// Now decompress..
-				m_pixelData = DdsSquish.DecompressImage( compressedBlocks, GetWidth(), GetHeight(), squishFlags );
+				// Keep the blocks, they're decompressed straight into the surface later..
+				m_compressedBlocks	= compressedBlocks;
+				m_squishFlags		= squishFlags;
 			}
 			else
 			{
@@ -817,115 +761,14 @@ namespace DdsFileTypePlugin
 				byte[] readPixelData = new byte[ rowPitch * m_header.m_height ];
 				input.Read( readPixelData, 0, readPixelData.GetLength( 0 ) );
 
-				// We now need space for the real pixel data.. that's width * height * 4..
-				m_pixelData = new byte[ m_header.m_width * m_header.m_height * 4 ];
+				// Squish reads the rows in place, so they must all be there..
+				if ( rowPitch < ( ( int )m_header.m_width * srcPixelSize ) )
+					throw new FormatException( "File is not a supported DDS format" );
 
-				// And now we have the arduous task of filling that up with stuff..
-				for ( int destY = 0; destY < ( int )m_header.m_height; destY++ )	
-				{
-					for ( int destX = 0; destX < ( int )m_header.m_width; destX++ )	
-					{
-						// Compute source pixel offset
-						int	srcPixelOffset = ( destY * rowPitch ) + ( destX * srcPixelSize );
-
-						// Read our pixel
-						uint	pixelColour = 0;
-						uint	pixelRed	= 0;
-						uint	pixelGreen	= 0;	
-						uint	pixelBlue	= 0;
-						uint	pixelAlpha	= 0;
-
-						// Build our pixel colour as a DWORD	
-						for ( int loop = 0; loop < srcPixelSize; loop++ )
-						{
-							pixelColour |= ( uint )( readPixelData[ srcPixelOffset + loop ] << ( 8 * loop ) );
-						}
-
-						if ( fileFormat == DdsFileFormat.DDS_FORMAT_A8R8G8B8 )
-						{
-							pixelAlpha	= ( pixelColour >> 24 ) & 0xff;
-							pixelRed	= ( pixelColour >> 16 ) & 0xff;
-							pixelGreen	= ( pixelColour >> 8  ) & 0xff;
-							pixelBlue	= ( pixelColour >> 0  ) & 0xff;
-						}
-						else
-						if ( fileFormat == DdsFileFormat.DDS_FORMAT_X8R8G8B8 )
-						{
-							pixelAlpha	= 0xff;
-							pixelRed	= ( pixelColour >> 16 ) & 0xff;
-							pixelGreen	= ( pixelColour >> 8  ) & 0xff;
-							pixelBlue	= ( pixelColour >> 0  ) & 0xff;
-						}
-						else
-						if ( fileFormat == DdsFileFormat.DDS_FORMAT_A8B8G8R8 )
-						{
-							pixelAlpha	= ( pixelColour >> 24 ) & 0xff;
-							pixelRed	= ( pixelColour >> 0  ) & 0xff;
-							pixelGreen	= ( pixelColour >> 8  ) & 0xff;
-							pixelBlue	= ( pixelColour >> 16 ) & 0xff;
-						}
-						else
-						if ( fileFormat == DdsFileFormat.DDS_FORMAT_X8B8G8R8 )
-						{
-							pixelAlpha	= 0xff;
-							pixelRed	= ( pixelColour >> 0  ) & 0xff;
-							pixelGreen	= ( pixelColour >> 8  ) & 0xff;
-							pixelBlue	= ( pixelColour >> 16 ) & 0xff;
-						}
-						else
-						if ( fileFormat == DdsFileFormat.DDS_FORMAT_A1R5G5B5 )
-						{
-							pixelAlpha	= ( pixelColour >> 15 ) * 0xff;
-							pixelRed	= ( pixelColour >> 10 ) & 0x1f;
-							pixelGreen	= ( pixelColour >> 5  ) & 0x1f;
-							pixelBlue	= ( pixelColour >> 0  ) & 0x1f;
-
-							pixelRed	= ( pixelRed   << 3 ) | ( pixelRed   >> 2 );
-							pixelGreen	= ( pixelGreen << 3 ) | ( pixelGreen >> 2 );
-							pixelBlue	= ( pixelBlue  << 3 ) | ( pixelBlue  >> 2 );
-						}
-						else
-						if ( fileFormat == DdsFileFormat.DDS_FORMAT_A4R4G4B4 )
-						{
-							pixelAlpha	= ( pixelColour >> 12 ) & 0xff;
-							pixelRed	= ( pixelColour >> 8  ) & 0x0f;
-							pixelGreen	= ( pixelColour >> 4  ) & 0x0f;
-							pixelBlue	= ( pixelColour >> 0  ) & 0x0f;
-
-							pixelAlpha	= ( pixelAlpha << 4 ) | ( pixelAlpha >> 0 );
-							pixelRed	= ( pixelRed   << 4 ) | ( pixelRed   >> 0 );
-							pixelGreen	= ( pixelGreen << 4 ) | ( pixelGreen >> 0 );
-							pixelBlue	= ( pixelBlue  << 4 ) | ( pixelBlue  >> 0 );
-						}
-						else
-						if ( fileFormat == DdsFileFormat.DDS_FORMAT_R8G8B8 )
-						{
-							pixelAlpha	= 0xff;
-							pixelRed	= ( pixelColour >> 16 ) & 0xff;
-							pixelGreen	= ( pixelColour >> 8  ) & 0xff;
-							pixelBlue	= ( pixelColour >> 0  ) & 0xff;
-						}
-						else
-						if ( fileFormat == DdsFileFormat.DDS_FORMAT_R5G6B5 )
-						{
-							pixelAlpha	= 0xff;
-							pixelRed	= ( pixelColour >> 11 ) & 0x1f;
-							pixelGreen	= ( pixelColour >> 5  ) & 0x3f;
-							pixelBlue	= ( pixelColour >> 0  ) & 0x1f;
-
-							pixelRed	= ( pixelRed   << 3 ) | ( pixelRed   >> 2 );
-							pixelGreen	= ( pixelGreen << 2 ) | ( pixelGreen >> 4 );
-							pixelBlue	= ( pixelBlue  << 3 ) | ( pixelBlue  >> 2 );
-						}
-															
-						// Write the colours away..
-						int	destPixelOffset	= ( destY * ( int )m_header.m_width * 4 ) + ( destX * 4 );
-						m_pixelData[ destPixelOffset + 0 ]	= ( byte )pixelRed;
-						m_pixelData[ destPixelOffset + 1 ]	= ( byte )pixelGreen;
-						m_pixelData[ destPixelOffset + 2 ]	= ( byte )pixelBlue;
-						m_pixelData[ destPixelOffset + 3 ]	= ( byte )pixelAlpha;
-					}
-				}	
+				// Keep the packed rows, they're unpacked straight into the surface later..
+				m_packedData	= readPixelData;
+				m_packedPitch	= rowPitch;
+				m_packedFormat	= GetPackedFormat( fileFormat );
 			}
 		}
 	
@@ -939,16 +782,41 @@ namespace DdsFileTypePlugin
 			return ( int )m_header.m_height;
 		}
 
-		public	byte[]	GetPixelData()
+		public	void	CopyToSurface( Surface surface )
 		{
-			return m_pixelData;
+			try
+			{
+				if ( m_compressedBlocks != null )
+				{
+					// Let squish write the decompressed pixels directly into the surface
+					DdsSquish.DecompressImage( m_compressedBlocks, surface, m_squishFlags, m_cancelFlag );
+				}
+				else
+				{
+					// Let squish unpack the pixels directly into the surface
+					DdsSquish.UnpackImage( m_packedData, m_packedPitch, m_packedFormat, surface, m_cancelFlag );
+				}
+			}
+			finally
+			{
+				m_cancelFlag.Reset();
+			}
 		}
 
 		// Loaded DDS header (also uses storage for save)
 		public	DdsHeader	m_header;
 	
-		// Pixel data
-		byte[]				m_pixelData;
+		// Packed rows of the uncompressed formats, and how to unpack them
+		byte[]				m_packedData;
+		int					m_packedPitch;
+		int					m_packedFormat;
+
+		// Compressed blocks, and the squish flags to decompress them with
+		byte[]				m_compressedBlocks;
+		int					m_squishFlags;
+
+		// Set by Cancel to stop squish early
+		DdsSquish.CancelFlag	m_cancelFlag;
 		
 	}
 }
\ No newline at end of file
@@ -101,24 +101,8 @@ namespace DdsFileTypePlugin
 
 			BitmapLayer layer			= Layer.CreateBackgroundLayer( ddsFile.GetWidth(), ddsFile.GetHeight() );
 			Surface		surface			= layer.Surface;
-			ColorBgra	writeColour		= new ColorBgra();
 
-			byte[]		readPixelData	= ddsFile.GetPixelData();
-
-			for ( int y = 0; y < ddsFile.GetHeight(); y++ )
-			{
-				for ( int x = 0; x < ddsFile.GetWidth(); x++ )
-				{
-					int			readPixelOffset = ( y * ddsFile.GetWidth() * 4 ) + ( x * 4 );
-					
-					writeColour.R = readPixelData[ readPixelOffset + 0 ];
-					writeColour.G = readPixelData[ readPixelOffset + 1 ];
-					writeColour.B = readPixelData[ readPixelOffset + 2 ];
-					writeColour.A = readPixelData[ readPixelOffset + 3 ];
-
-					surface[ x, y ] = writeColour;
-				}
-			}
+			ddsFile.CopyToSurface( surface );
 
 			// Create a document, add the surface layer to it, and return to caller.
 			Document	document	= new Document( surface.Width, surface.Height );
@@ -30,6 +30,7 @@ using System.Collections.Generic;
 using System.Text;
 using System.Drawing;
 using System.Runtime.InteropServices;
+using System.Threading;
 using PaintDotNet;
 using PaintDotNet.SystemLayer;
 
@@ -54,6 +55,34 @@ namespace DdsFileTypePlugin
 			kColourIterativeClusterFit	= ( 1 << 8 ),		// Use a very slow but very high quality colour compressor.
 		}
 
+		public enum PixelFormat
+		{
+			kPixelRgba					= 0,				// Bytes in the order red, green, blue, alpha.
+			kPixelBgra					= ( 1 << 0 ),		// Bytes in the order blue, green, red, alpha (ColorBgra).
+			kPixelPremultiplied			= ( 1 << 1 ),		// The colour has been multiplied by alpha.
+		}
+
+		public enum MipmapFlags
+		{
+			kMipmapBox					= 0,				// Average the pixels that each mipmap pixel covers (the default).
+			kMipmapKaiser				= 1,				// Use a Kaiser windowed sinc filter, which keeps the mipmaps sharper.
+			kMipmapLanczos				= 2,				// Use a 3 lobe Lanczos filter, which is sharper again but can ring.
+			kMipmapGammaCorrect			= ( 1 << 4 ),		// Filter the colours in linear light, treating the pixels as sRGB.
+			kMipmapWeightByAlpha		= ( 1 << 5 ),		// Weight the colours by alpha, so transparent pixels do not bleed.
+		}
+
+		public enum PackedFormat
+		{
+			kFormatA8R8G8B8				= 0,				// 32 bits with 8 bits each of alpha, red, green and blue.
+			kFormatX8R8G8B8				= 1,				// 32 bits with 8 unused bits and 8 bits each of red, green and blue.
+			kFormatA8B8G8R8				= 2,				// 32 bits with 8 bits each of alpha, blue, green and red.
+			kFormatX8B8G8R8				= 3,				// 32 bits with 8 unused bits and 8 bits each of blue, green and red.
+			kFormatA1R5G5B5				= 4,				// 16 bits with 1 bit of alpha and 5 bits each of red, green and blue.
+			kFormatA4R4G4B4				= 5,				// 16 bits with 4 bits each of alpha, red, green and blue.
+			kFormatR8G8B8				= 6,				// 24 bits with 8 bits each of red, green and blue.
+			kFormatR5G6B5				= 7,				// 16 bits with 5 bits of red, 6 bits of green and 5 bits of blue.
+		}
+
 		private	static bool	Is64Bit()
 		{
 			return ( Marshal.SizeOf( IntPtr.Zero ) == 8 ); 
@@ -61,82 +90,304 @@ namespace DdsFileTypePlugin
 
         internal delegate void ProgressFn(int workDone, int workTotal);
 
+		public enum Status
+		{
+			kStatusOk					= 0,				// Every block of the image was processed.
+			kStatusCancelled			= 1,				// The cancel flag was set before every block was processed.
+		}
+
+		// Flag that another thread can set to stop a squish call at the next tile of blocks
+		internal sealed class CancelFlag
+		{
+			public	void	Cancel()
+			{
+				Thread.VolatileWrite( ref m_flag[ 0 ], 1 );
+			}
+
+			public	void	Reset()
+			{
+				Thread.VolatileWrite( ref m_flag[ 0 ], 0 );
+			}
+
+			// Squish reads the flag through a pointer while the array is pinned
+			internal	int[]	m_flag	= new int[ 1 ];
+		}
+
         private sealed class SquishInterface_32
         {
             [DllImport("Squish_x86.dll")]
-            internal static extern unsafe void SquishCompressImage(byte* rgba, int width, int height, byte* blocks, int flags,
-                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn);
+            internal static extern unsafe int SquishCompressSurface(void* pixels, int width, int height, int stride, int pixelFormat, byte* blocks, int flags,
+                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn, int* cancel);
 
             [DllImport("Squish_x86.dll")]
-            internal static extern unsafe void SquishDecompressImage(byte* rgba, int width, int height, byte* blocks, int flags,
-                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn);
+            internal static extern unsafe int SquishDecompressSurface(void* pixels, int width, int height, int stride, int pixelFormat, byte* blocks, int flags,
+                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn, int* cancel);
 
             [DllImport("Squish_x86.dll")]
-            internal static extern void SquishInitialize();
-        }
+            internal static extern unsafe int SquishRecompressSurface(void* pixels, int width, int height, int stride, int pixelFormat, byte* blocks, int flags, int* rects, int rectCount,
+                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn, int* cancel);
 
-        private sealed class SquishInterface_32_SSE2
-        {
-            [DllImport("Squish_x86_SSE2.dll")]
-            internal static extern unsafe void SquishCompressImage(byte* rgba, int width, int height, byte* blocks, int flags,
-                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn);
+            [DllImport("Squish_x86.dll")]
+            internal static extern unsafe int SquishCompressMipmaps(void* pixels, int width, int height, int stride, int pixelFormat, int mipmapCount, int mipmapFlags, byte* blocks, int flags,
+                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn, int* cancel);
 
-            [DllImport("Squish_x86_SSE2.dll")]
-            internal static extern unsafe void SquishDecompressImage(byte* rgba, int width, int height, byte* blocks, int flags,
-                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn);
+            [DllImport("Squish_x86.dll")]
+            internal static extern unsafe int SquishGenerateMipmaps(void* pixels, int width, int height, int stride, int pixelFormat, int mipmapCount, int mipmapFlags, byte* mipmaps,
+                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn, int* cancel);
+
+            [DllImport("Squish_x86.dll")]
+            internal static extern unsafe int SquishRecompressMipmaps(void* pixels, int width, int height, int stride, int pixelFormat, int mipmapCount, int mipmapFlags, byte* blocks, int flags, int* rects, int rectCount,
+                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn, int* cancel);
+
+            [DllImport("Squish_x86.dll")]
+            internal static extern unsafe int SquishPackSurface(void* pixels, int width, int height, int stride, int pixelFormat, byte* packed, int pitch, int format,
+                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn, int* cancel);
+
+            [DllImport("Squish_x86.dll")]
+            internal static extern unsafe int SquishUnpackSurface(void* pixels, int width, int height, int stride, int pixelFormat, byte* packed, int pitch, int format,
+                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn, int* cancel);
 
-            [DllImport("Squish_x86_SSE2.dll")]
+            [DllImport("Squish_x86.dll")]
+            internal static extern unsafe void SquishGetMipDirtyRect(int* rect, int width, int height, int level, int mipmapFlags, int* mipRect);
+
+            [DllImport("Squish_x86.dll")]
             internal static extern void SquishInitialize();
         }
 
         private sealed class SquishInterface_64
 		{
 			[DllImport("Squish_x64.dll")]
-			internal static extern unsafe void SquishCompressImage( byte* rgba, int width, int height, byte* blocks, int flags,
-                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn);
+			internal static extern unsafe int SquishCompressSurface( void* pixels, int width, int height, int stride, int pixelFormat, byte* blocks, int flags,
+                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn, int* cancel);
+
+            [DllImport("Squish_x64.dll")]
+			internal static	extern unsafe int SquishDecompressSurface( void* pixels, int width, int height, int stride, int pixelFormat, byte* blocks, int flags,
+                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn, int* cancel);
+
+            [DllImport("Squish_x64.dll")]
+			internal static extern unsafe int SquishRecompressSurface( void* pixels, int width, int height, int stride, int pixelFormat, byte* blocks, int flags, int* rects, int rectCount,
+                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn, int* cancel);
+
+            [DllImport("Squish_x64.dll")]
+			internal static extern unsafe int SquishCompressMipmaps( void* pixels, int width, int height, int stride, int pixelFormat, int mipmapCount, int mipmapFlags, byte* blocks, int flags,
+                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn, int* cancel);
+
+            [DllImport("Squish_x64.dll")]
+			internal static extern unsafe int SquishGenerateMipmaps( void* pixels, int width, int height, int stride, int pixelFormat, int mipmapCount, int mipmapFlags, byte* mipmaps,
+                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn, int* cancel);
+
+            [DllImport("Squish_x64.dll")]
+			internal static extern unsafe int SquishRecompressMipmaps( void* pixels, int width, int height, int stride, int pixelFormat, int mipmapCount, int mipmapFlags, byte* blocks, int flags, int* rects, int rectCount,
+                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn, int* cancel);
+
+            [DllImport("Squish_x64.dll")]
+			internal static extern unsafe int SquishPackSurface( void* pixels, int width, int height, int stride, int pixelFormat, byte* packed, int pitch, int format,
+                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn, int* cancel);
+
+            [DllImport("Squish_x64.dll")]
+			internal static extern unsafe int SquishUnpackSurface( void* pixels, int width, int height, int stride, int pixelFormat, byte* packed, int pitch, int format,
+                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn, int* cancel);
 
             [DllImport("Squish_x64.dll")]
-			internal static	extern unsafe void SquishDecompressImage( byte* rgba, int width, int height, byte* blocks, int flags,
-                [MarshalAs(UnmanagedType.FunctionPtr)] ProgressFn progressFn);
+			internal static extern unsafe void SquishGetMipDirtyRect( int* rect, int width, int height, int level, int mipmapFlags, int* mipRect );
 
             [DllImport("Squish_x64.dll")]
             internal static extern void SquishInitialize();
         }
 
-		private static unsafe void	CallCompressImage( byte[] rgba, int width, int height, byte[] blocks, int flags, ProgressFn progressFn )
+		private static unsafe void	CallCompressSurface( Surface surface, byte[] blocks, int flags, ProgressFn progressFn, CancelFlag cancelFlag )
 		{
-			fixed ( byte* pRGBA = rgba )
+			int status;
+
+			fixed ( byte* pBlocks = blocks )
 			{
-				fixed ( byte* pBlocks = blocks )
+				fixed ( int* pCancel = ( cancelFlag == null ) ? null : cancelFlag.m_flag )
 				{
 					if ( Processor.Architecture == ProcessorArchitecture.X64 )
-						SquishInterface_64.SquishCompressImage( pRGBA, width, height, pBlocks, flags, progressFn );
-                    else if ( Processor.IsFeaturePresent(ProcessorFeature.SSE2) )
-                        SquishInterface_32_SSE2.SquishCompressImage(pRGBA, width, height, pBlocks, flags, progressFn);
-                    else
-						SquishInterface_32.SquishCompressImage( pRGBA, width, height, pBlocks, flags, progressFn );
+						status = SquishInterface_64.SquishCompressSurface( surface.Scan0.VoidStar, surface.Width, surface.Height, surface.Stride, ( int )PixelFormat.kPixelBgra, pBlocks, flags, progressFn, pCancel );
+					else
+						status = SquishInterface_32.SquishCompressSurface( surface.Scan0.VoidStar, surface.Width, surface.Height, surface.Stride, ( int )PixelFormat.kPixelBgra, pBlocks, flags, progressFn, pCancel );
 				}
 			}
 
+            GC.KeepAlive(surface);
             GC.KeepAlive(progressFn);
+			CheckStatus( status );
 		}
 		
-		private static unsafe void	CallDecompressImage( byte[] rgba, int width, int height, byte[] blocks, int flags, ProgressFn progressFn )
+		private static unsafe void	CallDecompressSurface( Surface surface, byte[] blocks, int flags, ProgressFn progressFn, CancelFlag cancelFlag )
+		{
+			int status;
+
+			fixed ( byte* pBlocks = blocks )
+			{
+				fixed ( int* pCancel = ( cancelFlag == null ) ? null : cancelFlag.m_flag )
+				{
+					if ( Processor.Architecture == ProcessorArchitecture.X64 )
+						status = SquishInterface_64.SquishDecompressSurface( surface.Scan0.VoidStar, surface.Width, surface.Height, surface.Stride, ( int )PixelFormat.kPixelBgra, pBlocks, flags, progressFn, pCancel );
+					else
+						status = SquishInterface_32.SquishDecompressSurface( surface.Scan0.VoidStar, surface.Width, surface.Height, surface.Stride, ( int )PixelFormat.kPixelBgra, pBlocks, flags, progressFn, pCancel );
+				}
+			}
+
+            GC.KeepAlive(surface);
+            GC.KeepAlive(progressFn);
+			CheckStatus( status );
+		}
+
+		private static unsafe void	CallRecompressSurface( Surface surface, byte[] blocks, int flags, int[] rects, ProgressFn progressFn, CancelFlag cancelFlag )
 		{
-			fixed ( byte* pRGBA = rgba )
+			int status;
+
+			fixed ( byte* pBlocks = blocks )
 			{
-				fixed ( byte* pBlocks = blocks )
+				fixed ( int* pRects = rects )
 				{
-                    if ( Processor.Architecture == ProcessorArchitecture.X64 )
-                        SquishInterface_64.SquishDecompressImage(pRGBA, width, height, pBlocks, flags, progressFn);
-					else if ( Processor.IsFeaturePresent(ProcessorFeature.SSE2) )
-						SquishInterface_32_SSE2.SquishDecompressImage( pRGBA, width, height, pBlocks, flags, progressFn );
-                    else
-						SquishInterface_32.SquishDecompressImage( pRGBA, width, height, pBlocks, flags, progressFn );
+					fixed ( int* pCancel = ( cancelFlag == null ) ? null : cancelFlag.m_flag )
+					{
+						if ( Processor.Architecture == ProcessorArchitecture.X64 )
+							status = SquishInterface_64.SquishRecompressSurface( surface.Scan0.VoidStar, surface.Width, surface.Height, surface.Stride, ( int )PixelFormat.kPixelBgra, pBlocks, flags, pRects, rects.Length / 4, progressFn, pCancel );
+						else
+							status = SquishInterface_32.SquishRecompressSurface( surface.Scan0.VoidStar, surface.Width, surface.Height, surface.Stride, ( int )PixelFormat.kPixelBgra, pBlocks, flags, pRects, rects.Length / 4, progressFn, pCancel );
+					}
 				}
 			}
 
+            GC.KeepAlive(surface);
             GC.KeepAlive(progressFn);
+			CheckStatus( status );
+		}
+
+		private static unsafe void	CallCompressMipmaps( Surface surface, int mipCount, int mipmapFlags, byte[] blocks, int flags, ProgressFn progressFn, CancelFlag cancelFlag )
+		{
+			int status;
+
+			fixed ( byte* pBlocks = blocks )
+			{
+				fixed ( int* pCancel = ( cancelFlag == null ) ? null : cancelFlag.m_flag )
+				{
+					if ( Processor.Architecture == ProcessorArchitecture.X64 )
+						status = SquishInterface_64.SquishCompressMipmaps( surface.Scan0.VoidStar, surface.Width, surface.Height, surface.Stride, ( int )PixelFormat.kPixelBgra, mipCount, mipmapFlags, pBlocks, flags, progressFn, pCancel );
+					else
+						status = SquishInterface_32.SquishCompressMipmaps( surface.Scan0.VoidStar, surface.Width, surface.Height, surface.Stride, ( int )PixelFormat.kPixelBgra, mipCount, mipmapFlags, pBlocks, flags, progressFn, pCancel );
+				}
+			}
+
+            GC.KeepAlive(surface);
+            GC.KeepAlive(progressFn);
+			CheckStatus( status );
+		}
+
+		private static unsafe void	CallGenerateMipmaps( Surface surface, int mipCount, int mipmapFlags, byte[] mipmaps, ProgressFn progressFn, CancelFlag cancelFlag )
+		{
+			int status;
+
+			fixed ( byte* pMipmaps = mipmaps )
+			{
+				fixed ( int* pCancel = ( cancelFlag == null ) ? null : cancelFlag.m_flag )
+				{
+					if ( Processor.Architecture == ProcessorArchitecture.X64 )
+						status = SquishInterface_64.SquishGenerateMipmaps( surface.Scan0.VoidStar, surface.Width, surface.Height, surface.Stride, ( int )PixelFormat.kPixelBgra, mipCount, mipmapFlags, pMipmaps, progressFn, pCancel );
+					else
+						status = SquishInterface_32.SquishGenerateMipmaps( surface.Scan0.VoidStar, surface.Width, surface.Height, surface.Stride, ( int )PixelFormat.kPixelBgra, mipCount, mipmapFlags, pMipmaps, progressFn, pCancel );
+				}
+			}
+
+            GC.KeepAlive(surface);
+            GC.KeepAlive(progressFn);
+			CheckStatus( status );
+		}
+
+		private static unsafe void	CallRecompressMipmaps( Surface surface, int mipCount, int mipmapFlags, byte[] blocks, int flags, int[] rects, ProgressFn progressFn, CancelFlag cancelFlag )
+		{
+			int status;
+
+			fixed ( byte* pBlocks = blocks )
+			{
+				fixed ( int* pRects = rects )
+				{
+					fixed ( int* pCancel = ( cancelFlag == null ) ? null : cancelFlag.m_flag )
+					{
+						if ( Processor.Architecture == ProcessorArchitecture.X64 )
+							status = SquishInterface_64.SquishRecompressMipmaps( surface.Scan0.VoidStar, surface.Width, surface.Height, surface.Stride, ( int )PixelFormat.kPixelBgra, mipCount, mipmapFlags, pBlocks, flags, pRects, rects.Length / 4, progressFn, pCancel );
+						else
+							status = SquishInterface_32.SquishRecompressMipmaps( surface.Scan0.VoidStar, surface.Width, surface.Height, surface.Stride, ( int )PixelFormat.kPixelBgra, mipCount, mipmapFlags, pBlocks, flags, pRects, rects.Length / 4, progressFn, pCancel );
+					}
+				}
+			}
+
+            GC.KeepAlive(surface);
+            GC.KeepAlive(progressFn);
+			CheckStatus( status );
+		}
+
+		private static unsafe void	CallPackSurface( Surface surface, byte[] packed, int pitch, int format, ProgressFn progressFn, CancelFlag cancelFlag )
+		{
+			int status;
+
+			fixed ( byte* pPacked = packed )
+			{
+				fixed ( int* pCancel = ( cancelFlag == null ) ? null : cancelFlag.m_flag )
+				{
+					if ( Processor.Architecture == ProcessorArchitecture.X64 )
+						status = SquishInterface_64.SquishPackSurface( surface.Scan0.VoidStar, surface.Width, surface.Height, surface.Stride, ( int )PixelFormat.kPixelBgra, pPacked, pitch, format, progressFn, pCancel );
+					else
+						status = SquishInterface_32.SquishPackSurface( surface.Scan0.VoidStar, surface.Width, surface.Height, surface.Stride, ( int )PixelFormat.kPixelBgra, pPacked, pitch, format, progressFn, pCancel );
+				}
+			}
+
+            GC.KeepAlive(surface);
+            GC.KeepAlive(progressFn);
+			CheckStatus( status );
+		}
+
+		private static unsafe void	CallPackPixels( byte[] pixels, int offset, Size size, byte[] packed, int pitch, int format, ProgressFn progressFn, CancelFlag cancelFlag )
+		{
+			int status;
+
+			fixed ( byte* pPixels = pixels )
+			{
+				fixed ( byte* pPacked = packed )
+				{
+					fixed ( int* pCancel = ( cancelFlag == null ) ? null : cancelFlag.m_flag )
+					{
+						if ( Processor.Architecture == ProcessorArchitecture.X64 )
+							status = SquishInterface_64.SquishPackSurface( pPixels + offset, size.Width, size.Height, size.Width * 4, ( int )PixelFormat.kPixelBgra, pPacked, pitch, format, progressFn, pCancel );
+						else
+							status = SquishInterface_32.SquishPackSurface( pPixels + offset, size.Width, size.Height, size.Width * 4, ( int )PixelFormat.kPixelBgra, pPacked, pitch, format, progressFn, pCancel );
+					}
+				}
+			}
+
+            GC.KeepAlive(progressFn);
+			CheckStatus( status );
+		}
+
+		private static unsafe void	CallUnpackSurface( Surface surface, byte[] packed, int pitch, int format, ProgressFn progressFn, CancelFlag cancelFlag )
+		{
+			int status;
+
+			fixed ( byte* pPacked = packed )
+			{
+				fixed ( int* pCancel = ( cancelFlag == null ) ? null : cancelFlag.m_flag )
+				{
+					if ( Processor.Architecture == ProcessorArchitecture.X64 )
+						status = SquishInterface_64.SquishUnpackSurface( surface.Scan0.VoidStar, surface.Width, surface.Height, surface.Stride, ( int )PixelFormat.kPixelBgra, pPacked, pitch, format, progressFn, pCancel );
+					else
+						status = SquishInterface_32.SquishUnpackSurface( surface.Scan0.VoidStar, surface.Width, surface.Height, surface.Stride, ( int )PixelFormat.kPixelBgra, pPacked, pitch, format, progressFn, pCancel );
+				}
+			}
+
+            GC.KeepAlive(surface);
+            GC.KeepAlive(progressFn);
+			CheckStatus( status );
+		}
+
+		private static void	CheckStatus( int status )
+		{
+			// The output is incomplete, so don't let the caller carry on with it
+			if ( status == ( int )Status.kStatusCancelled )
+				throw new OperationCanceledException();
 		}
 
         public static void Initialize()
@@ -145,10 +396,6 @@ namespace DdsFileTypePlugin
             {
                 SquishInterface_64.SquishInitialize();
             }
-            else if (Processor.IsFeaturePresent(ProcessorFeature.SSE2))
-            {
-                SquishInterface_32_SSE2.SquishInitialize();
-            }
             else
             {
                 SquishInterface_32.SquishInitialize();
@@ -160,33 +407,19 @@ namespace DdsFileTypePlugin
 		// ---------------------------------------------------------------------------------------
 		//
 		//	Params
-		//		inputSurface	:	Source byte array containing RGBA pixel data
+		//		inputSurface	:	Source surface, read in place by squish
 		//		flags			:	Flags for squish compression control
+		//		cancelFlag		:	Flag to stop the compression early, or null
 		//
 		//	Return	
 		//		blockData		:	Array of bytes containing compressed blocks
 		//
+		//	Throws OperationCanceledException if cancelFlag was set before every block was done.
+		//
 		// ---------------------------------------------------------------------------------------
 
-		internal static byte[] CompressImage( Surface inputSurface, int squishFlags, ProgressFn progressFn )
+		internal static byte[] CompressImage( Surface inputSurface, int squishFlags, ProgressFn progressFn, CancelFlag cancelFlag )
 		{
-			// We need the input to be in a byte array for squish.. so create one.
-			byte[]	pixelData	= new byte[ inputSurface.Width * inputSurface.Height * 4 ];
-
-			for ( int y = 0; y < inputSurface.Height; y++ )
-			{
-				for ( int x = 0; x < inputSurface.Width; x++ )
-				{
-					ColorBgra	pixelColour = inputSurface.GetPoint( x, y );
-					int			pixelOffset	= ( y * inputSurface.Width * 4 ) + ( x * 4 );
-						
-					pixelData[ pixelOffset + 0 ]	= pixelColour.R;
-					pixelData[ pixelOffset + 1 ]	= pixelColour.G;
-					pixelData[ pixelOffset + 2 ]	= pixelColour.B;
-					pixelData[ pixelOffset + 3 ]	= pixelColour.A;
-				}
-			}
-
 			// Compute size of compressed block area, and allocate 
 			int blockCount = ( ( inputSurface.Width + 3 )/4 ) * ( ( inputSurface.Height + 3 )/4 );
 			int blockSize = ( ( squishFlags & ( int )DdsSquish.SquishFlags.kDxt1 ) != 0 ) ? 8 : 16;
@@ -194,38 +427,274 @@ namespace DdsFileTypePlugin
 			// Allocate room for compressed blocks
 			byte[]	blockData		= new byte[ blockCount * blockSize ];
 	
-			// Invoke squish::CompressImage() with the required parameters
-			CallCompressImage( pixelData, inputSurface.Width, inputSurface.Height, blockData, squishFlags, progressFn );
+			// Invoke squish::CompressImage() straight on the surface's BGRA rows
+			CallCompressSurface( inputSurface, blockData, squishFlags, progressFn, cancelFlag );
 				
 			// Return our block data to caller..
 			return	blockData;	
 		}
 
+		// ---------------------------------------------------------------------------------------
+		//	CompressMipmaps
+		// ---------------------------------------------------------------------------------------
+		//
+		//	Params
+		//		inputSurface	:	Source surface for the first mip level, read in place by squish
+		//		flags			:	Flags for squish compression control
+		//		mipCount		:	Number of mip levels, including the first
+		//		mipmapFlags		:	MipmapFlags for the filter that makes the smaller levels
+		//		cancelFlag		:	Flag to stop the compression early, or null
+		//
+		//	Return	
+		//		blockData		:	Array of bytes containing the compressed blocks of every level in turn
+		//
+		//	Squish filters each level from the one before while it is compressing that one, so
+		//	no mip surfaces are made here. Progress is reported in blocks of the whole chain.
+		//
+		// ---------------------------------------------------------------------------------------
+
+		internal static byte[] CompressMipmaps( Surface inputSurface, int squishFlags, int mipCount, int mipmapFlags, ProgressFn progressFn, CancelFlag cancelFlag )
+		{
+			// Compute size of compressed block area of all the levels, and allocate 
+			int blockSize = ( ( squishFlags & ( int )DdsSquish.SquishFlags.kDxt1 ) != 0 ) ? 8 : 16;
+			int blockCount = 0;
+
+			for ( int mipLoop = 0; mipLoop < mipCount; mipLoop++ )
+			{
+				int mipWidth	= Math.Max( inputSurface.Width >> mipLoop, 1 );
+				int mipHeight	= Math.Max( inputSurface.Height >> mipLoop, 1 );
+				blockCount += ( ( mipWidth + 3 )/4 ) * ( ( mipHeight + 3 )/4 );
+			}
+
+			byte[]	blockData		= new byte[ blockCount * blockSize ];
+
+			// Invoke squish::CompressMipmaps() straight on the surface's BGRA rows
+			CallCompressMipmaps( inputSurface, mipCount, mipmapFlags, blockData, squishFlags, progressFn, cancelFlag );
+
+			return	blockData;
+		}
+
+		// ---------------------------------------------------------------------------------------
+		//	RecompressImage
+		// ---------------------------------------------------------------------------------------
+		//
+		//	Params
+		//		inputSurface	:	Source surface, changed only inside the dirty rectangles
+		//		flags			:	Flags for squish compression control, as used for blockData
+		//		blockData		:	Compressed blocks of the previous surface, updated in place
+		//		dirtyRects		:	Rectangles of pixels that have changed since blockData was made
+		//		cancelFlag		:	Flag to stop the compression early, or null
+		//
+		//	Only the 4x4 blocks that the rectangles touch are compressed again.
+		//
+		// ---------------------------------------------------------------------------------------
+
+		internal static void RecompressImage( Surface inputSurface, int squishFlags, byte[] blockData, Rectangle[] dirtyRects, ProgressFn progressFn, CancelFlag cancelFlag )
+		{
+			int[]	rects	= new int[ dirtyRects.Length * 4 ];
+
+			for ( int rectLoop = 0; rectLoop < dirtyRects.Length; rectLoop++ )
+			{
+				rects[ ( rectLoop * 4 ) + 0 ] = dirtyRects[ rectLoop ].X;
+				rects[ ( rectLoop * 4 ) + 1 ] = dirtyRects[ rectLoop ].Y;
+				rects[ ( rectLoop * 4 ) + 2 ] = dirtyRects[ rectLoop ].Width;
+				rects[ ( rectLoop * 4 ) + 3 ] = dirtyRects[ rectLoop ].Height;
+			}
+
+			// Invoke squish::RecompressImage() straight on the surface's BGRA rows
+			CallRecompressSurface( inputSurface, blockData, squishFlags, rects, progressFn, cancelFlag );
+		}
+
+		// ---------------------------------------------------------------------------------------
+		//	GenerateMipmaps
+		// ---------------------------------------------------------------------------------------
+		//
+		//	Params
+		//		inputSurface	:	Source surface for the first mip level, read in place by squish
+		//		mipCount		:	Number of mip levels, including the first
+		//		mipmapFlags		:	MipmapFlags for the filter that makes the smaller levels
+		//		cancelFlag		:	Flag to stop the filtering early, or null
+		//
+		//	Return	
+		//		mipData			:	Array of BGRA pixels of every level after the first in turn
+		//
+		//	The levels are filtered just as CompressMipmaps filters them before compressing.
+		//
+		// ---------------------------------------------------------------------------------------
+
+		internal static byte[] GenerateMipmaps( Surface inputSurface, int mipCount, int mipmapFlags, ProgressFn progressFn, CancelFlag cancelFlag )
+		{
+			// Compute size of the levels after the first, and allocate 
+			int pixelCount = 0;
+
+			for ( int mipLoop = 1; mipLoop < mipCount; mipLoop++ )
+			{
+				int mipWidth	= Math.Max( inputSurface.Width >> mipLoop, 1 );
+				int mipHeight	= Math.Max( inputSurface.Height >> mipLoop, 1 );
+				pixelCount += mipWidth * mipHeight;
+			}
+
+			byte[]	mipData			= new byte[ pixelCount * 4 ];
+
+			// Invoke squish::GenerateMipmaps() straight on the surface's BGRA rows
+			CallGenerateMipmaps( inputSurface, mipCount, mipmapFlags, mipData, progressFn, cancelFlag );
+
+			return	mipData;
+		}
+
+		// ---------------------------------------------------------------------------------------
+		//	RecompressMipmaps
+		// ---------------------------------------------------------------------------------------
+		//
+		//	Params
+		//		inputSurface	:	Source surface for the first mip level, changed only inside the dirty rectangles
+		//		flags			:	Flags for squish compression control, as used for blockData
+		//		mipCount		:	Number of mip levels, as used for blockData
+		//		mipmapFlags		:	MipmapFlags the levels of blockData were filtered with
+		//		blockData		:	Compressed blocks of every level from CompressMipmaps, updated in place
+		//		dirtyRects		:	Rectangles of pixels that have changed since blockData was made
+		//		cancelFlag		:	Flag to stop the compression early, or null
+		//
+		//	Only the blocks of each level that the rectangles reach are compressed again.
+		//
+		// ---------------------------------------------------------------------------------------
+
+		internal static void RecompressMipmaps( Surface inputSurface, int squishFlags, int mipCount, int mipmapFlags, byte[] blockData, Rectangle[] dirtyRects, ProgressFn progressFn, CancelFlag cancelFlag )
+		{
+			int[]	rects	= new int[ dirtyRects.Length * 4 ];
+
+			for ( int rectLoop = 0; rectLoop < dirtyRects.Length; rectLoop++ )
+			{
+				rects[ ( rectLoop * 4 ) + 0 ] = dirtyRects[ rectLoop ].X;
+				rects[ ( rectLoop * 4 ) + 1 ] = dirtyRects[ rectLoop ].Y;
+				rects[ ( rectLoop * 4 ) + 2 ] = dirtyRects[ rectLoop ].Width;
+				rects[ ( rectLoop * 4 ) + 3 ] = dirtyRects[ rectLoop ].Height;
+			}
+
+			// Invoke squish::RecompressMipmaps() straight on the surface's BGRA rows
+			CallRecompressMipmaps( inputSurface, mipCount, mipmapFlags, blockData, squishFlags, rects, progressFn, cancelFlag );
+		}
+
+		// ---------------------------------------------------------------------------------------
+		//	GetMipDirtyRect
+		// ---------------------------------------------------------------------------------------
+		//
+		//	Params
+		//		dirtyRect		:	Changed rectangle of the main surface
+		//		size			:	Size of the main surface
+		//		level			:	Mip level, where 0 is the main surface
+		//		mipmapFlags		:	Flags the mip levels are filtered with, as for CompressMipmaps
+		//
+		//	Return	
+		//		Rectangle		:	Rectangle of the mip level that can depend on dirtyRect
+		//
+		// ---------------------------------------------------------------------------------------
+
+		internal static unsafe Rectangle GetMipDirtyRect( Rectangle dirtyRect, Size size, int level, int mipmapFlags )
+		{
+			int*	rect	= stackalloc int[ 4 ];
+			int*	mipRect	= stackalloc int[ 4 ];
+
+			rect[ 0 ] = dirtyRect.X;
+			rect[ 1 ] = dirtyRect.Y;
+			rect[ 2 ] = dirtyRect.Width;
+			rect[ 3 ] = dirtyRect.Height;
+
+			if ( Processor.Architecture == ProcessorArchitecture.X64 )
+				SquishInterface_64.SquishGetMipDirtyRect( rect, size.Width, size.Height, level, mipmapFlags, mipRect );
+			else
+				SquishInterface_32.SquishGetMipDirtyRect( rect, size.Width, size.Height, level, mipmapFlags, mipRect );
+
+			return new Rectangle( mipRect[ 0 ], mipRect[ 1 ], mipRect[ 2 ], mipRect[ 3 ] );
+		}
+
 		// ---------------------------------------------------------------------------------------
 		//	DecompressImage
 		// ---------------------------------------------------------------------------------------
 		//
 		//	Params
-		//		inputSurface	:	Source byte array containing DXT block data
-		//		width			:	Width of image in pixels
-		//		height			:	Height of image in pixels
+		//		blocks			:	Source byte array containing DXT block data
+		//		outputSurface	:	Surface to receive the pixels, written in place by squish
 		//		flags			:	Flags for squish decompression control
+		//		cancelFlag		:	Flag to stop the decompression early, or null
+		//
+		// ---------------------------------------------------------------------------------------
+
+		internal static void DecompressImage( byte[] blocks, Surface outputSurface, int flags, CancelFlag cancelFlag )
+		{
+			// Invoke squish::DecompressImage() straight on the surface's BGRA rows
+			CallDecompressSurface( outputSurface, blocks, flags, null, cancelFlag );
+		}
+
+		// ---------------------------------------------------------------------------------------
+		//	PackImage
+		// ---------------------------------------------------------------------------------------
+		//
+		//	Params
+		//		inputSurface	:	Source surface, read in place by squish
+		//		format			:	PackedFormat of the output pixels
+		//		pitch			:	Distance in bytes from one packed row to the next
+		//		cancelFlag		:	Flag to stop the packing early, or null
+		//
+		//	Return	
+		//		packedData		:	Array of bytes containing the packed rows
+		//
+		// ---------------------------------------------------------------------------------------
+
+		internal static byte[] PackImage( Surface inputSurface, int format, int pitch, ProgressFn progressFn, CancelFlag cancelFlag )
+		{
+			byte[]	packedData		= new byte[ pitch * inputSurface.Height ];
+
+			// Invoke squish::PackImage() straight on the surface's BGRA rows
+			CallPackSurface( inputSurface, packedData, pitch, format, progressFn, cancelFlag );
+
+			return	packedData;
+		}
+
+		// ---------------------------------------------------------------------------------------
+		//	PackImage
+		// ---------------------------------------------------------------------------------------
+		//
+		//	Params
+		//		pixels			:	Source byte array containing BGRA pixels, such as from GenerateMipmaps
+		//		offset			:	Offset in bytes of the first pixel of the image
+		//		size			:	Size of the image, with rows of 4 * size.Width bytes
+		//		format			:	PackedFormat of the output pixels
+		//		pitch			:	Distance in bytes from one packed row to the next
+		//		cancelFlag		:	Flag to stop the packing early, or null
 		//
 		//	Return	
-		//		byte[]			:	Array of bytes containing decompressed blocks
+		//		packedData		:	Array of bytes containing the packed rows
 		//
 		// ---------------------------------------------------------------------------------------
 
-		internal static byte[] DecompressImage( byte[] blocks, int width, int height, int flags )
+		internal static byte[] PackImage( byte[] pixels, int offset, Size size, int format, int pitch, ProgressFn progressFn, CancelFlag cancelFlag )
 		{
-			// Allocate room for decompressed output
-			byte[]	pixelOutput	= new byte[ width * height * 4 ];
+			byte[]	packedData		= new byte[ pitch * size.Height ];
+
+			// Invoke squish::PackImage() straight on the BGRA pixels
+			CallPackPixels( pixels, offset, size, packedData, pitch, format, progressFn, cancelFlag );
+
+			return	packedData;
+		}
 
-			// Invoke squish::DecompressImage() with the required parameters
-			CallDecompressImage( pixelOutput, width, height, blocks, flags, null );
+		// ---------------------------------------------------------------------------------------
+		//	UnpackImage
+		// ---------------------------------------------------------------------------------------
+		//
+		//	Params
+		//		packedData		:	Source byte array containing the packed rows
+		//		pitch			:	Distance in bytes from one packed row to the next
+		//		format			:	PackedFormat of the packed pixels
+		//		outputSurface	:	Surface to receive the pixels, written in place by squish
+		//		cancelFlag		:	Flag to stop the unpacking early, or null
+		//
+		// ---------------------------------------------------------------------------------------
 
-			// Return our pixel data to caller..
-			return pixelOutput;
+		internal static void UnpackImage( byte[] packedData, int pitch, int format, Surface outputSurface, CancelFlag cancelFlag )
+		{
+			// Invoke squish::UnpackImage() straight on the surface's BGRA rows
+			CallUnpackSurface( outputSurface, packedData, pitch, format, null, cancelFlag );
 		}
 	}
 }
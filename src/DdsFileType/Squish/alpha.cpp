@@ -24,6 +24,7 @@
    -------------------------------------------------------------------------- */
    
 #include "alpha.h"
+#include "kernels.h"
 #include <algorithm>
 
 namespace squish {
@@ -97,48 +98,6 @@ static void FixRange( int& min, int& max, int steps )
 		min = std::max( 0, max - steps );
 }
 
-static int FitCodes( u8 const* rgba, int mask, u8 const* codes, u8* indices )
-{
-	// fit each alpha value to the codebook
-	int err = 0;
-	for( int i = 0; i < 16; ++i )
-	{
-		// check this pixel is valid
-		int bit = 1 << i;
-		if( ( mask & bit ) == 0 )
-		{
-			// use the first code
-			indices[i] = 0;
-			continue;
-		}
-		
-		// find the least error and corresponding index
-		int value = rgba[4*i + 3];
-		int least = INT_MAX;
-		int index = 0;
-		for( int j = 0; j < 8; ++j )
-		{
-			// get the squared error from this code
-			int dist = ( int )value - ( int )codes[j];
-			dist *= dist;
-			
-			// compare with the best so far
-			if( dist < least )
-			{
-				least = dist;
-				index = j;
-			}
-		}
-		
-		// save this index and accumulate the error
-		indices[i] = ( u8 )index;
-		err += least;
-	}
-	
-	// return the total error
-	return err;
-}
-
 static void WriteAlphaBlock( int alpha0, int alpha1, u8 const* indices, void* block )
 {
 	u8* bytes = reinterpret_cast< u8* >( block );
@@ -169,7 +128,7 @@ static void WriteAlphaBlock( int alpha0, int alpha1, u8 const* indices, void* bl
 	}
 }
 
-static void WriteAlphaBlock5( int alpha0, int alpha1, u8 const* indices, void* block )
+void WriteAlphaBlock5( int alpha0, int alpha1, u8 const* indices, void* block )
 {
 	// check the relative values of the endpoints
 	if( alpha0 > alpha1 )
@@ -199,7 +158,7 @@ static void WriteAlphaBlock5( int alpha0, int alpha1, u8 const* indices, void* b
 	}	
 }
 
-static void WriteAlphaBlock7( int alpha0, int alpha1, u8 const* indices, void* block )
+void WriteAlphaBlock7( int alpha0, int alpha1, u8 const* indices, void* block )
 {
 	// check the relative values of the endpoints
 	if( alpha0 < alpha1 )
@@ -227,69 +186,47 @@ static void WriteAlphaBlock7( int alpha0, int alpha1, u8 const* indices, void* b
 	}	
 }
 
-void CompressAlphaDxt5( u8 const* rgba, int mask, void* block )
+void SetAlphaCodebook( int min, int max, int steps, u8* codes )
 {
-	// get the range for 5-alpha and 7-alpha interpolation
-	int min5 = 255;
-	int max5 = 0;
-	int min7 = 255;
-	int max7 = 0;
-	for( int i = 0; i < 16; ++i )
-	{
-		// check this pixel is valid
-		int bit = 1 << i;
-		if( ( mask & bit ) == 0 )
-			continue;
+	// fix the range to be the minimum
+	if( min > max )
+		min = max;
+	FixRange( min, max, steps );
 
-		// incorporate into the min/max
-		int value = rgba[4*i + 3];
-		if( value < min7 )
-			min7 = value;
-		if( value > max7 )
-			max7 = value;
-		if( value != 0 && value < min5 )
-			min5 = value;
-		if( value != 255 && value > max5 )
-			max5 = value;
+	// interpolate between the end points, adding 0 and 255 to the 5-alpha code book
+	codes[0] = ( u8 )min;
+	codes[1] = ( u8 )max;
+	for( int i = 1; i < steps; ++i )
+		codes[1 + i] = ( u8 )( ( ( steps - i )*min + i*max )/steps );
+	if( steps == 5 )
+	{
+		codes[6] = 0;
+		codes[7] = 255;
 	}
-	
-	// handle the case that no valid range was found
-	if( min5 > max5 )
-		min5 = max5;
-	if( min7 > max7 )
-		min7 = max7;
-		
-	// fix the range to be the minimum in each case
-	FixRange( min5, max5, 5 );
-	FixRange( min7, max7, 7 );
-	
-	// set up the 5-alpha code book
-	u8 codes5[8];
-	codes5[0] = ( u8 )min5;
-	codes5[1] = ( u8 )max5;
-	for( int i = 1; i < 5; ++i )
-		codes5[1 + i] = ( u8 )( ( ( 5 - i )*min5 + i*max5 )/5 );
-	codes5[6] = 0;
-	codes5[7] = 255;
-	
-	// set up the 7-alpha code book
-	u8 codes7[8];
-	codes7[0] = ( u8 )min7;
-	codes7[1] = ( u8 )max7;
-	for( int i = 1; i < 7; ++i )
-		codes7[1 + i] = ( u8 )( ( ( 7 - i )*min7 + i*max7 )/7 );
-		
-	// fit the data to both code books
-	u8 indices5[16];
-	u8 indices7[16];
-	int err5 = FitCodes( rgba, mask, codes5, indices5 );
-	int err7 = FitCodes( rgba, mask, codes7, indices7 );
-	
-	// save the block with least error
-	if( err5 <= err7 )
-		WriteAlphaBlock5( min5, max5, indices5, block );
-	else
-		WriteAlphaBlock7( min7, max7, indices7, block );
+}
+
+void CompressAlphaDxt5( u8 const* rgba, int mask, void* block, bool refine )
+{
+	GetKernels().FitAlphas( rgba, &mask, 1, refine, reinterpret_cast< u8* >( block ), 16 );
+}
+
+struct SingleAlphaLookup
+{
+	u8 min;
+	u8 max;
+	u8 index;
+};
+
+#include "singlealphalookup.inl"
+
+void CompressSingleAlphaDxt5( int alpha, int mask, void* block )
+{
+	// the valid pixels take the exact code and the masked ones the first
+	SingleAlphaLookup const& lookup = lookup_alpha[alpha];
+	u8 indices[16];
+	for( int i = 0; i < 16; ++i )
+		indices[i] = ( ( mask & ( 1 << i ) ) != 0 ) ? lookup.index : 0;
+	WriteAlphaBlock( lookup.min, lookup.max, indices, block );
 }
 
 void DecompressAlphaDxt5( u8* rgba, void const* block )
@@ -31,7 +31,15 @@
 namespace squish {
 
 void CompressAlphaDxt3( u8 const* rgba, int mask, void* block );
-void CompressAlphaDxt5( u8 const* rgba, int mask, void* block );
+void CompressAlphaDxt5( u8 const* rgba, int mask, void* block, bool refine );
+
+//! Compresses the DXT5 alpha of a block whose valid pixels all have the same alpha, as CompressAlphaDxt5 would.
+void CompressSingleAlphaDxt5( int alpha, int mask, void* block );
+
+//! Sets a 5-alpha or 7-alpha code book between the end points, widening the range to at least steps.
+void SetAlphaCodebook( int min, int max, int steps, u8* codes );
+void WriteAlphaBlock5( int alpha0, int alpha1, u8 const* indices, void* block );
+void WriteAlphaBlock7( int alpha0, int alpha1, u8 const* indices, void* block );
 
 void DecompressAlphaDxt3( u8* rgba, void const* block );
 void DecompressAlphaDxt5( u8* rgba, void const* block );
@@ -0,0 +1,189 @@
+/* -----------------------------------------------------------------------------
+
+	Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files (the 
+	"Software"), to	deal in the Software without restriction, including
+	without limitation the rights to use, copy, modify, merge, publish,
+	distribute, sublicense, and/or sell copies of the Software, and to 
+	permit persons to whom the Software is furnished to do so, subject to 
+	the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+	
+   -------------------------------------------------------------------------- */
+   
+#include "blockcache.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cstring>
+
+namespace squish {
+
+// the states of a shared entry
+enum
+{
+	kSharedEmpty = 0,
+	kSharedWriting = 1,
+	kSharedReady = 2
+};
+
+// the table sizes and the number of shared slots to try for each hash
+enum
+{
+	kLocalEntries = 1024,
+	kSharedEntries = 16384,
+	kSharedProbes = 8
+};
+
+// the lookups before a worker gives up on the cache, and the hit rate it needs
+enum
+{
+	kTrialLookups = 1024,
+	kUsefulRatio = 32
+};
+
+static int GetTableSize( int blockCount, int limit )
+{
+	int size = 64;
+	while( size < blockCount && size < limit )
+		size *= 2;
+	return size;
+}
+
+BlockCache::BlockCache( int blockCount, int workerCount, int bytesPerBlock )
+  : m_bytesPerBlock( bytesPerBlock ), 
+	m_localSize( GetTableSize( blockCount, kLocalEntries ) ), 
+	m_sharedSize( GetTableSize( blockCount, kSharedEntries ) ), 
+	m_counts( workerCount )
+{
+	// mark every entry as empty
+	Entry empty;
+	std::memset( &empty, 0, sizeof( empty ) );
+	empty.mask = -1;
+	m_local.resize( workerCount*m_localSize, empty );
+
+	SharedEntry emptyShared;
+	emptyShared.state = kSharedEmpty;
+	emptyShared.entry = empty;
+	m_shared.resize( m_sharedSize, emptyShared );
+
+	Counts zero;
+	std::memset( &zero, 0, sizeof( zero ) );
+	std::fill( m_counts.begin(), m_counts.end(), zero );
+}
+
+unsigned int BlockCache::Hash( u8 const* rgba, int mask )
+{
+	// mix in each pixel as a 32 bit word
+	unsigned int hash = 2166136261u ^ ( unsigned int )mask;
+	for( int i = 0; i < 16; ++i )
+	{
+		unsigned int pixel;
+		std::memcpy( &pixel, rgba + 4*i, 4 );
+		hash = ( hash ^ pixel )*16777619u;
+		hash ^= hash >> 15;
+	}
+	return hash;
+}
+
+bool BlockCache::Matches( Entry const& entry, unsigned int hash, u8 const* rgba, int mask ) const
+{
+	return entry.hash == hash 
+		&& entry.mask == mask 
+		&& std::memcmp( entry.rgba, rgba, 64 ) == 0;
+}
+
+void BlockCache::Fill( Entry& entry, unsigned int hash, u8 const* rgba, int mask, u8 const* block ) const
+{
+	entry.hash = hash;
+	entry.mask = mask;
+	std::memcpy( entry.rgba, rgba, 64 );
+	std::memcpy( entry.block, block, m_bytesPerBlock );
+}
+
+bool BlockCache::Find( int worker, unsigned int hash, u8 const* rgba, int mask, u8* block )
+{
+	Counts& counts = m_counts[worker];
+	++counts.lookups;
+
+	// try the table of this worker
+	Entry& local = m_local[worker*m_localSize + ( hash & ( m_localSize - 1 ) )];
+	if( Matches( local, hash, rgba, mask ) )
+	{
+		std::memcpy( block, local.block, m_bytesPerBlock );
+		++counts.localHits;
+		return true;
+	}
+
+	// try the shared table up to the first empty slot
+	for( int probe = 0; probe < kSharedProbes; ++probe )
+	{
+		SharedEntry& shared = m_shared[( hash + probe ) & ( m_sharedSize - 1 )];
+		long const state = AtomicAdd( &shared.state, 0 );
+		if( state == kSharedEmpty )
+			break;
+		if( state == kSharedReady && Matches( shared.entry, hash, rgba, mask ) )
+		{
+			std::memcpy( block, shared.entry.block, m_bytesPerBlock );
+			local = shared.entry;
+			++counts.sharedHits;
+			return true;
+		}
+	}
+	return false;
+}
+
+void BlockCache::Insert( int worker, unsigned int hash, u8 const* rgba, int mask, u8 const* block )
+{
+	// always keep the block in the table of this worker
+	Fill( m_local[worker*m_localSize + ( hash & ( m_localSize - 1 ) )], hash, rgba, mask, block );
+
+	// claim an empty shared slot, unless another worker already added the block
+	for( int probe = 0; probe < kSharedProbes; ++probe )
+	{
+		SharedEntry& shared = m_shared[( hash + probe ) & ( m_sharedSize - 1 )];
+		long const state = AtomicCompareExchange( &shared.state, kSharedWriting, kSharedEmpty );
+		if( state == kSharedEmpty )
+		{
+			// fill the entry then publish it
+			Fill( shared.entry, hash, rgba, mask, block );
+			AtomicAdd( &shared.state, kSharedReady - kSharedWriting );
+			return;
+		}
+		if( state == kSharedReady && Matches( shared.entry, hash, rgba, mask ) )
+			return;
+	}
+}
+
+bool BlockCache::IsUseful( int worker ) const
+{
+	Counts const& counts = m_counts[worker];
+	if( counts.lookups < kTrialLookups )
+		return true;
+	return ( counts.localHits + counts.sharedHits )*kUsefulRatio >= counts.lookups;
+}
+
+BlockCacheStats BlockCache::GetStats() const
+{
+	BlockCacheStats stats = { 0, 0, 0 };
+	for( size_t i = 0; i < m_counts.size(); ++i )
+	{
+		stats.blocks += m_counts[i].lookups;
+		stats.localHits += m_counts[i].localHits;
+		stats.sharedHits += m_counts[i].sharedHits;
+	}
+	return stats;
+}
+
+} // namespace squish
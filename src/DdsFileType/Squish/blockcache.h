@@ -0,0 +1,107 @@
+/* -----------------------------------------------------------------------------
+
+	Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files (the 
+	"Software"), to	deal in the Software without restriction, including
+	without limitation the rights to use, copy, modify, merge, publish,
+	distribute, sublicense, and/or sell copies of the Software, and to 
+	permit persons to whom the Software is furnished to do so, subject to 
+	the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+	
+   -------------------------------------------------------------------------- */
+   
+#ifndef SQUISH_BLOCKCACHE_H
+#define SQUISH_BLOCKCACHE_H
+
+#include <squish.h>
+#include <vector>
+
+namespace squish {
+
+/*! @brief Remembers the compressed output of the source blocks of an image.
+
+	Images with flat areas or repeated tiles contain many identical blocks, 
+	and compressing the same block with the same flags always gives the same
+	output. Each worker looks in its own direct mapped table first, then in 
+	a table shared by all the workers. Entries in the shared table are only
+	ever written once, so readers never wait for each other.
+	
+	Blocks are keyed on their mask and the values of their valid pixels, so 
+	the pixels that are not enabled by the mask must be zero.
+	
+	On images without repeats the lookups only cost time, so a worker stops
+	using the cache once it has seen enough blocks with very few hits.
+*/
+class BlockCache
+{
+public:
+	BlockCache( int blockCount, int workerCount, int bytesPerBlock );
+
+	//! Gets the hash of a source block.
+	static unsigned int Hash( u8 const* rgba, int mask );
+
+	//! Copies the compressed block for this source into block if it is known.
+	bool Find( int worker, unsigned int hash, u8 const* rgba, int mask, u8* block );
+	
+	//! Remembers the compressed block for this source.
+	void Insert( int worker, unsigned int hash, u8 const* rgba, int mask, u8 const* block );
+	
+	//! Checks if the cache has been finding enough blocks for this worker to be worth the lookups.
+	bool IsUseful( int worker ) const;
+
+	//! Counts a block that was reused without going through the cache.
+	void CountHit( int worker ) { ++m_counts[worker].localHits; }
+
+	//! Gets the lookup and hit counts of all the workers.
+	BlockCacheStats GetStats() const;
+
+private:
+	struct Entry
+	{
+		unsigned int hash;
+		int mask;
+		u8 rgba[64];
+		u8 block[16];
+	};
+	
+	struct SharedEntry
+	{
+		long volatile state;
+		Entry entry;
+	};
+	
+	struct Counts
+	{
+		int lookups;
+		int localHits;
+		int sharedHits;
+		int padding[13];	// keep each worker on its own cache line
+	};
+
+	bool Matches( Entry const& entry, unsigned int hash, u8 const* rgba, int mask ) const;
+	void Fill( Entry& entry, unsigned int hash, u8 const* rgba, int mask, u8 const* block ) const;
+
+	int m_bytesPerBlock;
+	int m_localSize;
+	int m_sharedSize;
+	std::vector< Entry > m_local;
+	std::vector< SharedEntry > m_shared;
+	std::vector< Counts > m_counts;
+};
+
+} // namespace squish
+
+#endif // ndef SQUISH_BLOCKCACHE_H
@@ -29,8 +29,8 @@
 
 #include <squish.h>
 #include "maths.h"
-#include "simd.h"
 #include "colourfit.h"
+#include "kernels.h"
 
 namespace squish {
 
@@ -41,6 +41,11 @@ public:
 	
 private:
 	bool ConstructOrdering( Vec3 const& axis, int iteration );
+	void BeginSearch();
+	int Search( void ( *search )( ClusterFitSearch& ) );
+
+	Vec3 GetBestStart() const { return Vec3( m_search.beststart[0], m_search.beststart[1], m_search.beststart[2] ); }
+	Vec3 GetBestEnd() const { return Vec3( m_search.bestend[0], m_search.bestend[1], m_search.bestend[2] ); }
 
 	virtual void Compress3( void* block );
 	virtual void Compress4( void* block );
@@ -50,10 +55,8 @@ private:
 	int m_iterationCount;
 	Vec3 m_principle;
 	u8 m_order[16*kMaxIterations];
-	Vec4 m_points_weights[16];
-	Vec4 m_xsum_wsum;
-	Vec4 m_metric;
-	Vec4 m_besterror;
+	ClusterFitSearch m_search;
+	float m_besterror;
 };
 
 } // namespace squish
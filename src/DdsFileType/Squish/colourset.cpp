@@ -1,3 +1,4 @@
+#include <cstring>
 /* -----------------------------------------------------------------------------
 
 	Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
@@ -24,6 +25,8 @@
    -------------------------------------------------------------------------- */
    
 #include "colourset.h"
+#include "kernels.h"
+#include <cstring>
 
 namespace squish {
 
@@ -35,75 +38,54 @@ ColourSet::ColourSet( u8 const* rgba, int mask, int flags )
 	bool isDxt1 = ( ( flags & kDxt1 ) != 0 );
 	bool weightByAlpha = ( ( flags & kWeightColourByAlpha ) != 0 );
 
-	// create the minimal set
-	for( int i = 0; i < 16; ++i )
+	// leave out the transparent pixels when using dxt1
+	int valid = mask & 0xffff;
+	for( int i = 0; isDxt1 && i < 16; ++i )
 	{
-		// check this pixel is enabled
-		int bit = 1 << i;
-		if( ( mask & bit ) == 0 )
+		if( ( valid & ( 1 << i ) ) != 0 && rgba[4*i + 3] < 128 )
 		{
-			m_remap[i] = -1;
-			continue;
+			valid &= ~( 1 << i );
+			m_transparent = true;
 		}
-	
-		// check for transparent pixels when using dxt1
-		if( isDxt1 && rgba[4*i + 3] < 128 )
+	}
+
+	// find the first pixel of each colour
+	Kernels const& kernels = GetKernels();
+	int firsts[16];
+	kernels.MatchColours( rgba, valid, firsts );
+
+	// create the minimal set, with a point for the first pixel of each colour
+	std::memset( m_bytes, 0, sizeof( m_bytes ) );
+	std::memset( m_wholeWeights, 0, sizeof( m_wholeWeights ) );
+	for( int i = 0; i < 16; ++i )
+	{
+		// check this pixel is enabled
+		if( ( valid & ( 1 << i ) ) == 0 )
 		{
 			m_remap[i] = -1;
-			m_transparent = true;
 			continue;
 		}
 
-		// loop over previous points for a match
-		for( int j = 0;; ++j )
+		// map to the point of an earlier pixel of this colour, or add a new point
+		int index;
+		if( firsts[i] == i )
 		{
-			// allocate a new point
-			if( j == i )
-			{
-				// normalise coordinates to [0,1]
-				float x = ( float )rgba[4*i] / 255.0f;
-				float y = ( float )rgba[4*i + 1] / 255.0f;
-				float z = ( float )rgba[4*i + 2] / 255.0f;
-				
-				// ensure there is always non-zero weight even for zero alpha
-				float w = ( float )( rgba[4*i + 3] + 1 ) / 256.0f;
-
-				// add the point
-				m_points[m_count] = Vec3( x, y, z );
-				m_weights[m_count] = ( weightByAlpha ? w : 1.0f );
-				m_remap[i] = m_count;
-				
-				// advance
-				++m_count;
-				break;
-			}
-		
-			// check for a match
-			int oldbit = 1 << j;
-			bool match = ( ( mask & oldbit ) != 0 )
-				&& ( rgba[4*i] == rgba[4*j] )
-				&& ( rgba[4*i + 1] == rgba[4*j + 1] )
-				&& ( rgba[4*i + 2] == rgba[4*j + 2] )
-				&& ( rgba[4*j + 3] >= 128 || !isDxt1 );
-			if( match )
-			{
-				// get the index of the match
-				int index = m_remap[j];
-				
-				// ensure there is always non-zero weight even for zero alpha
-				float w = ( float )( rgba[4*i + 3] + 1 ) / 256.0f;
-
-				// map to this point and increase the weight
-				m_weights[index] += ( weightByAlpha ? w : 1.0f );
-				m_remap[i] = index;
-				break;
-			}
+			index = m_count++;
+			std::memcpy( m_bytes[index], rgba + 4*i, 4 );
 		}
+		else
+			index = m_remap[firsts[i]];
+		m_remap[i] = index;
+
+		// ensure there is always non-zero weight even for zero alpha
+		m_wholeWeights[index] += weightByAlpha ? rgba[4*i + 3] + 1 : 1;
 	}
 
-	// square root the weights
+	// normalise the coordinates to [0,1] and square root the weights, which are exact before the root
+	float points[16][4];
+	kernels.UnpackColours( m_bytes[0], m_wholeWeights, m_count, weightByAlpha ? 1.0f/256.0f : 1.0f, points[0], m_weights );
 	for( int i = 0; i < m_count; ++i )
-		m_weights[i] = std::sqrt( m_weights[i] );
+		m_points[i] = Vec3( points[i][0], points[i][1], points[i][2] );
 }
 
 void ColourSet::RemapIndices( u8 const* source, u8* target ) const
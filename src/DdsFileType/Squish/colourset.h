@@ -36,6 +36,7 @@ namespace squish {
 class ColourSet
 {
 public:
+	ColourSet() : m_count( 0 ), m_transparent( false ) {}
 	ColourSet( u8 const* rgba, int mask, int flags );
 
 	int GetCount() const { return m_count; }
@@ -43,12 +44,20 @@ public:
 	float const* GetWeights() const { return m_weights; }
 	bool IsTransparent() const { return m_transparent; }
 
+	//! Gets the points as the original bytes, 4 per point with the last unused.
+	u8 const* GetBytes() const { return m_bytes[0]; }
+
+	//! Gets the unrooted weights in whole numbers, as pixel counts or sums of alpha + 1.
+	int const* GetWholeWeights() const { return m_wholeWeights; }
+
 	void RemapIndices( u8 const* source, u8* target ) const;
 
 private:
 	int m_count;
 	Vec3 m_points[16];
 	float m_weights[16];
+	u8 m_bytes[16][4];
+	int m_wholeWeights[16];
 	int m_remap[16];
 	bool m_transparent;
 };
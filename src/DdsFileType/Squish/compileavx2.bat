@@ -0,0 +1,16 @@
+@rem Usage: compileavx2 x86|x86_amd64 source.cpp output.obj
+@rem Compiles the AVX2 kernels with Visual Studio 2012 or later, since Visual
+@rem Studio 2008 has no AVX2 intrinsics. The object names no default libraries,
+@rem has no stack checks, exceptions or runtime mismatch checks, so it links into
+@rem the Visual Studio 2008 DLL against its runtime.
+@setlocal
+@set VCVARS=
+@set VSCMD_START_DIR=%CD%
+@set VSWHERE=%ProgramFiles(x86)%\Microsoft Visual Studio\Installer\vswhere.exe
+@if exist "%VSWHERE%" for /f "usebackq delims=" %%i in (`call "%VSWHERE%" -latest -requires Microsoft.VisualStudio.Component.VC.Tools.x86.x64 -property installationPath`) do @set VCVARS=%%i\VC\Auxiliary\Build\vcvarsall.bat
+@if not defined VCVARS if defined VS140COMNTOOLS set VCVARS=%VS140COMNTOOLS%..\..\VC\vcvarsall.bat
+@if not defined VCVARS if defined VS120COMNTOOLS set VCVARS=%VS120COMNTOOLS%..\..\VC\vcvarsall.bat
+@if not defined VCVARS if defined VS110COMNTOOLS set VCVARS=%VS110COMNTOOLS%..\..\VC\vcvarsall.bat
+@if not exist "%VCVARS%" echo %~2 : error : the AVX2 kernels need Visual Studio 2012 or later to compile & exit /b 1
+@call "%VCVARS%" %1 > nul
+cl.exe /nologo /c /O2 /Oi /GS- /Zl /EHs-c- /arch:AVX /fp:precise /W3 /WX /DNDEBUG /D_HAS_EXCEPTIONS=0 /DSQUISH_USE_AVX2_KERNEL=1 /D_ALLOW_MSC_VER_MISMATCH /D_ALLOW_RUNTIME_LIBRARY_MISMATCH /D_ALLOW_ITERATOR_DEBUG_LEVEL_MISMATCH /I"%~dp2." /Fo"%~3" "%~2"
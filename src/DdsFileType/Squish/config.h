@@ -41,10 +41,38 @@
 #define SQUISH_USE_SSE 0
 #endif
 
+// Set to 1 when building squish to use AVX2 instructions (requires SSE2).
+#ifndef SQUISH_USE_AVX
+#define SQUISH_USE_AVX 0
+#endif
+
+// Set to 1 to build the SSE2 kernels that are selected at runtime on x86.
+#ifndef SQUISH_USE_X86_KERNELS
+#if defined( _M_IX86 ) || defined( _M_X64 ) || defined( __i386__ ) || defined( __x86_64__ )
+#define SQUISH_USE_X86_KERNELS 1
+#else
+#define SQUISH_USE_X86_KERNELS 0
+#endif
+#endif
+
+// Set to 1 to also build the AVX2 kernels (needs AVX2 compiler support for
+// kernels_avx2.cpp, so Visual Studio 2012 or above with MSVC). The Visual 
+// Studio 2008 projects set it and compile that file with compileavx2.bat.
+#ifndef SQUISH_USE_AVX2_KERNEL
+#if SQUISH_USE_X86_KERNELS && ( !defined( _MSC_VER ) || ( _MSC_VER >= 1700 ) )
+#define SQUISH_USE_AVX2_KERNEL 1
+#else
+#define SQUISH_USE_AVX2_KERNEL 0
+#endif
+#endif
+
 // Internally et SQUISH_USE_SIMD when either Altivec or SSE is available.
 #if SQUISH_USE_ALTIVEC && SQUISH_USE_SSE
 #error "Cannot enable both Altivec and SSE!"
 #endif
+#if SQUISH_USE_AVX && ( SQUISH_USE_SSE < 2 )
+#error "AVX requires SQUISH_USE_SSE=2!"
+#endif
 #if SQUISH_USE_ALTIVEC || SQUISH_USE_SSE
 #define SQUISH_USE_SIMD 1
 #else
@@ -0,0 +1,99 @@
+/* -----------------------------------------------------------------------------
+
+	Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files (the 
+	"Software"), to	deal in the Software without restriction, including
+	without limitation the rights to use, copy, modify, merge, publish,
+	distribute, sublicense, and/or sell copies of the Software, and to 
+	permit persons to whom the Software is furnished to do so, subject to 
+	the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+	
+   -------------------------------------------------------------------------- */
+
+/*! @file
+
+	@brief	Generates clusterfitlookup.inl.
+	
+	The cluster fit searches try every split of an ordering of the points 
+	into 3 or 4 contiguous clusters. This lists the splits for each point 
+	count in the order that the searches have always visited them, so that 
+	they can sweep a flat table and still keep the same winner on ties.
+	Each 3 cluster split [0,i) [i,j) [j,count) is stored as ( i, j ) and 
+	each 4 cluster split [0,i) [i,j) [j,k) [k,count) as ( i, j, k ).
+*/
+
+#include <cstdio>
+#include <vector>
+
+static void Write( char const* name, int width, std::vector< int > const& values, std::vector< int > const& offsets )
+{
+	std::printf( "static u8 const %s[][%d] = \n{\n", name, width );
+	for( size_t n = 0; n < values.size(); n += width )
+	{
+		std::printf( "\t{ " );
+		for( int c = 0; c < width; ++c )
+			std::printf( "%s%d", c ? ", " : "", values[n + c] );
+		std::printf( " }%s\n", ( n + width < values.size() ) ? "," : "" );
+	}
+	std::printf( "};\n\n" );
+
+	std::printf( "static int const %s_offsets[] = \n{\n\t", name );
+	for( size_t n = 0; n < offsets.size(); ++n )
+		std::printf( "%d%s", offsets[n], ( n + 1 < offsets.size() ) ? ", " : "\n" );
+	std::printf( "};\n" );
+}
+
+int main()
+{
+	std::vector< int > partitions3, offsets3;
+	std::vector< int > partitions4, offsets4;
+	for( int count = 0; count <= 16; ++count )
+	{
+		// the 3 cluster splits
+		offsets3.push_back( ( int )partitions3.size()/2 );
+		for( int i = 0; i < count; ++i )
+		{
+			for( int j = ( i == 0 ) ? 1 : i; j <= count; ++j )
+			{
+				partitions3.push_back( i );
+				partitions3.push_back( j );
+			}
+		}
+
+		// the 4 cluster splits
+		offsets4.push_back( ( int )partitions4.size()/3 );
+		for( int i = 0; i < count; ++i )
+		{
+			for( int j = i; j <= count; ++j )
+			{
+				for( int k = ( j == 0 ) ? 1 : j; k <= count; ++k )
+				{
+					partitions4.push_back( i );
+					partitions4.push_back( j );
+					partitions4.push_back( k );
+				}
+			}
+		}
+	}
+	offsets3.push_back( ( int )partitions3.size()/2 );
+	offsets4.push_back( ( int )partitions4.size()/3 );
+
+	// write the tables
+	Write( "partitions_3", 2, partitions3, offsets3 );
+	std::printf( "\n" );
+	Write( "partitions_4", 3, partitions4, offsets4 );
+	return 0;
+}
@@ -0,0 +1,69 @@
+/* -----------------------------------------------------------------------------
+
+	Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files (the 
+	"Software"), to	deal in the Software without restriction, including
+	without limitation the rights to use, copy, modify, merge, publish,
+	distribute, sublicense, and/or sell copies of the Software, and to 
+	permit persons to whom the Software is furnished to do so, subject to 
+	the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+	
+   -------------------------------------------------------------------------- */
+
+/*! @file
+
+	@brief	Generates singlealphalookup.inl.
+	
+	A DXT5 alpha block of a single value always fits it exactly with the 
+	5-alpha code book, which is widened to a range of 5 to have distinct 
+	end points. This lists the end points and the first code that matches 
+	each value, as CompressAlphaDxt5 finds them, so that solid blocks can 
+	be written without fitting them. The 5-alpha range leaves out 0 and 255 
+	since the code book has them already, so those values use the range of 
+	the lowest end point instead.
+*/
+
+#include <algorithm>
+#include <cstdio>
+
+int main()
+{
+	std::printf( "static SingleAlphaLookup const lookup_alpha[] = \n{\n" );
+	for( int value = 0; value < 256; ++value )
+	{
+		// widen the range as FixRange does
+		int min = ( value == 0 || value == 255 ) ? 0 : value;
+		int max = std::min( min + 5, 255 );
+		if( max - min < 5 )
+			min = std::max( 0, max - 5 );
+
+		// build the code book and take the first exact code
+		int codes[8];
+		codes[0] = min;
+		codes[1] = max;
+		for( int i = 1; i < 5; ++i )
+			codes[1 + i] = ( ( 5 - i )*min + i*max )/5;
+		codes[6] = 0;
+		codes[7] = 255;
+		int index = 0;
+		while( codes[index] != value )
+			++index;
+
+		std::printf( "\t{ %d, %d, %d }%s\n", min, max, index, ( value < 255 ) ? "," : "" );
+	}
+	std::printf( "};\n" );
+	return 0;
+}
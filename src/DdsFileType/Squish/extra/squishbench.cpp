@@ -0,0 +1,433 @@
+/* -----------------------------------------------------------------------------
+
+	Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files (the 
+	"Software"), to	deal in the Software without restriction, including
+	without limitation the rights to use, copy, modify, merge, publish,
+	distribute, sublicense, and/or sell copies of the Software, and to 
+	permit persons to whom the Software is furnished to do so, subject to 
+	the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+	
+   -------------------------------------------------------------------------- */
+
+/*! @file
+
+	@brief	Benchmarks every compression mode over a corpus of images.
+	
+	Each image is compressed with every combination of format, colour fit,
+	colour metric and alpha weighting, once for each thread count. The 
+	speed and the error of the decompressed result are written to stdout 
+	as JSON so that runs can be compared by a script.
+	
+	The corpus is made up of the binary PPM and PAM images named on the
+	command line, or a set of generated images if none are given.
+*/
+
+#include <squish.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+using namespace squish;
+
+class Image
+{
+public:
+	std::string name;
+	int width;
+	int height;
+	std::vector< u8 > rgba;
+};
+
+static double GetSeconds()
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency( &frequency );
+	QueryPerformanceCounter( &counter );
+	return ( double )counter.QuadPart/( double )frequency.QuadPart;
+#else
+	timeval now;
+	gettimeofday( &now, NULL );
+	return ( double )now.tv_sec + 1.0e-6*( double )now.tv_usec;
+#endif
+}
+
+static bool ReadToken( FILE* file, char* token, int size )
+{
+	// skip whitespace and comments
+	int c = fgetc( file );
+	for( ;; )
+	{
+		if( c == '#' )
+		{
+			while( c != EOF && c != '\n' )
+				c = fgetc( file );
+		}
+		else if( c == ' ' || c == '\t' || c == '\r' || c == '\n' )
+			c = fgetc( file );
+		else
+			break;
+	}
+	
+	// read up to the next whitespace
+	int length = 0;
+	while( c != EOF && c != ' ' && c != '\t' && c != '\r' && c != '\n' )
+	{
+		if( length + 1 < size )
+			token[length++] = ( char )c;
+		c = fgetc( file );
+	}
+	token[length] = '\0';
+	return length > 0;
+}
+
+static bool LoadImage( char const* fileName, Image& image )
+{
+	FILE* file = fopen( fileName, "rb" );
+	if( !file )
+		return false;
+
+	// read the header of a P6 (rgb) or P7 (rgb or rgb alpha) file
+	char token[64];
+	int channels = 0;
+	int maxval = 0;
+	image.width = image.height = 0;
+	bool ok = ReadToken( file, token, sizeof( token ) );
+	if( ok && std::strcmp( token, "P6" ) == 0 )
+	{
+		channels = 3;
+		ok = ReadToken( file, token, sizeof( token ) ); image.width = std::atoi( token );
+		ok = ok && ReadToken( file, token, sizeof( token ) ); image.height = std::atoi( token );
+		ok = ok && ReadToken( file, token, sizeof( token ) ); maxval = std::atoi( token );
+	}
+	else if( ok && std::strcmp( token, "P7" ) == 0 )
+	{
+		while( ( ok = ReadToken( file, token, sizeof( token ) ) ) && std::strcmp( token, "ENDHDR" ) != 0 )
+		{
+			char value[64];
+			if( !ReadToken( file, value, sizeof( value ) ) )
+				ok = false;
+			else if( std::strcmp( token, "WIDTH" ) == 0 )
+				image.width = std::atoi( value );
+			else if( std::strcmp( token, "HEIGHT" ) == 0 )
+				image.height = std::atoi( value );
+			else if( std::strcmp( token, "DEPTH" ) == 0 )
+				channels = std::atoi( value );
+			else if( std::strcmp( token, "MAXVAL" ) == 0 )
+				maxval = std::atoi( value );
+		}
+	}
+	else
+		ok = false;
+	if( !ok || image.width <= 0 || image.height <= 0 || maxval != 255 || ( channels != 3 && channels != 4 ) )
+	{
+		fclose( file );
+		return false;
+	}
+
+	// read the pixels and expand to rgba
+	std::vector< u8 > pixels( image.width*image.height*channels );
+	ok = fread( &pixels[0], 1, pixels.size(), file ) == pixels.size();
+	fclose( file );
+	image.rgba.resize( 4*image.width*image.height );
+	for( int i = 0; i < image.width*image.height; ++i )
+	{
+		for( int c = 0; c < 3; ++c )
+			image.rgba[4*i + c] = pixels[channels*i + c];
+		image.rgba[4*i + 3] = ( channels == 4 ) ? pixels[channels*i + 3] : 255;
+	}
+	image.name = fileName;
+	return ok;
+}
+
+static void MakeCorpus( std::vector< Image >& corpus )
+{
+	char const* names[] = { "gradient", "noise", "cutout", "smooth" };
+	unsigned int seed = 1;
+	for( int kind = 0; kind < 4; ++kind )
+	{
+		Image image;
+		image.name = names[kind];
+		image.width = 256;
+		image.height = 256;
+		image.rgba.resize( 4*image.width*image.height );
+		for( int y = 0; y < image.height; ++y )
+		{
+			for( int x = 0; x < image.width; ++x )
+			{
+				u8* pixel = &image.rgba[4*( image.width*y + x )];
+				seed = seed*1103515245 + 12345;
+				int random = ( seed >> 16 ) & 0xff;
+				switch( kind )
+				{
+				case 0:
+					// smooth ramps in every channel
+					pixel[0] = ( u8 )x;
+					pixel[1] = ( u8 )y;
+					pixel[2] = ( u8 )( ( x + y )/2 );
+					pixel[3] = ( u8 )( 255 - x );
+					break;
+
+				case 1:
+					// uncorrelated noise
+					pixel[0] = ( u8 )random;
+					pixel[1] = ( u8 )( random*7 );
+					pixel[2] = ( u8 )( random*13 );
+					pixel[3] = ( u8 )( random*29 );
+					break;
+					
+				case 2:
+					// flat shapes with binary alpha, like a sprite sheet
+					{
+						int cell = ( ( x/24 ) + ( y/24 ) ) % 3;
+						pixel[0] = ( u8 )( 60 + 80*cell );
+						pixel[1] = ( u8 )( 200 - 50*cell );
+						pixel[2] = ( u8 )( 30*cell );
+						pixel[3] = ( cell == 0 ) ? 0 : 255;
+					}
+					break;
+					
+				default:
+					// smooth shading with a little noise, like a photograph
+					{
+						double s = std::sin( 0.05*x ) + std::cos( 0.035*y );
+						int base = ( int )( 96.0 + 48.0*s );
+						pixel[0] = ( u8 )( base + ( random & 7 ) );
+						pixel[1] = ( u8 )( base/2 + 64 + ( random & 3 ) );
+						pixel[2] = ( u8 )( 255 - base );
+						pixel[3] = ( u8 )( 128 + base/2 );
+					}
+					break;
+				}
+			}
+		}
+		corpus.push_back( image );
+	}
+}
+
+static void GetError( Image const& image, std::vector< u8 > const& output, bool isDxt1, double& colourSquares, long& colourPixels, double& alphaSquares )
+{
+	colourSquares = alphaSquares = 0.0;
+	colourPixels = 0;
+	for( int i = 0; i < image.width*image.height; ++i )
+	{
+		// dxt1 makes pixels with alpha below 128 black, so only the alpha counts there
+		double diff = ( double )image.rgba[4*i + 3] - ( double )output[4*i + 3];
+		alphaSquares += diff*diff;
+		if( isDxt1 && image.rgba[4*i + 3] < 128 )
+			continue;
+		++colourPixels;
+		for( int c = 0; c < 3; ++c )
+		{
+			double diff = ( double )image.rgba[4*i + c] - ( double )output[4*i + c];
+			colourSquares += diff*diff;
+		}
+	}
+}
+
+static std::string Quote( std::string const& text )
+{
+	// escape a string for json, windows paths being the usual problem
+	std::string quoted( "\"" );
+	for( size_t i = 0; i < text.size(); ++i )
+	{
+		if( text[i] == '\\' || text[i] == '"' )
+			quoted += '\\';
+		quoted += text[i];
+	}
+	return quoted + "\"";
+}
+
+static double GetPsnr( double rmse )
+{
+	return ( rmse > 0.0 ) ? 20.0*std::log10( 255.0/rmse ) : 99.0;
+}
+
+static void ParseThreads( char const* list, std::vector< int >& threads )
+{
+	threads.clear();
+	while( *list != '\0' )
+	{
+		threads.push_back( std::atoi( list ) );
+		while( *list != '\0' && *list != ',' )
+			++list;
+		if( *list == ',' )
+			++list;
+	}
+}
+
+int main( int argc, char* argv[] )
+{
+	// parse the command line
+	int iterations = 3;
+	std::vector< int > threads;
+	threads.push_back( 1 );
+	threads.push_back( 0 );
+	std::vector< Image > corpus;
+	for( int i = 1; i < argc; ++i )
+	{
+		if( std::strcmp( argv[i], "-i" ) == 0 && i + 1 < argc )
+			iterations = std::max( 1, std::atoi( argv[++i] ) );
+		else if( std::strcmp( argv[i], "-t" ) == 0 && i + 1 < argc )
+			ParseThreads( argv[++i], threads );
+		else if( std::strcmp( argv[i], "-n" ) == 0 )
+			SetBlockCache( false );
+		else if( argv[i][0] == '-' )
+		{
+			std::fprintf( stderr, "usage: squish-bench [-i iterations] [-t threads,...] [-n] [image.ppm|image.pam ...]\n" );
+			return 1;
+		}
+		else
+		{
+			Image image;
+			if( !LoadImage( argv[i], image ) )
+			{
+				std::fprintf( stderr, "squish-bench: cannot read %s\n", argv[i] );
+				return 1;
+			}
+			corpus.push_back( image );
+		}
+	}
+	if( corpus.empty() )
+		MakeCorpus( corpus );
+	if( threads.empty() )
+		threads.push_back( 0 );
+
+	// count the blocks in the corpus
+	long blockCount = 0;
+	for( size_t n = 0; n < corpus.size(); ++n )
+		blockCount += ( long )( ( corpus[n].width + 3 )/4 )*( ( corpus[n].height + 3 )/4 );
+
+	// describe the run
+	std::printf( "{\n\t\"instructionSet\": %d,\n\t\"iterations\": %d,\n\t\"images\": [", GetInstructionSet(), iterations );
+	for( size_t n = 0; n < corpus.size(); ++n )
+		std::printf( "%s\n\t\t{ \"name\": %s, \"width\": %d, \"height\": %d }", n ? "," : "", Quote( corpus[n].name ).c_str(), corpus[n].width, corpus[n].height );
+	std::printf( "\n\t],\n\t\"results\": [" );
+
+	// run every combination of flags
+	int const formats[] = { kDxt1, kDxt3, kDxt5 };
+	char const* formatNames[] = { "dxt1", "dxt3", "dxt5" };
+	int const fits[] = { kColourRangeFit, kColourClusterFit, kColourIterativeClusterFit };
+	char const* fitNames[] = { "range", "cluster", "iterative" };
+	int const metrics[] = { kColourMetricPerceptual, kColourMetricUniform };
+	char const* metricNames[] = { "perceptual", "uniform" };
+	bool first = true;
+	for( int format = 0; format < 3; ++format )
+	for( int fit = 0; fit < 3; ++fit )
+	for( int metric = 0; metric < 2; ++metric )
+	for( int weight = 0; weight < 2; ++weight )
+	{
+		int flags = formats[format] | fits[fit] | metrics[metric] | ( weight ? kWeightColourByAlpha : 0 );
+		std::printf( "%s\n\t\t{\n\t\t\t\"format\": \"%s\", \"fit\": \"%s\", \"metric\": \"%s\", \"weightByAlpha\": %s,\n", 
+			first ? "" : ",", formatNames[format], fitNames[fit], metricNames[metric], weight ? "true" : "false" );
+		first = false;
+
+		// time the compression and decompression at each thread count
+		std::vector< std::vector< u8 > > blocks( corpus.size() );
+		std::vector< std::vector< u8 > > outputs( corpus.size() );
+		std::vector< BlockCacheStats > cacheStats( corpus.size() );
+		double baseline = 0.0;
+		std::printf( "\t\t\t\"runs\": [" );
+		for( size_t t = 0; t < threads.size(); ++t )
+		{
+			SetThreadCount( threads[t] );
+			double compressTime = 0.0;
+			double decompressTime = 0.0;
+			for( size_t n = 0; n < corpus.size(); ++n )
+			{
+				Image const& image = corpus[n];
+				blocks[n].resize( GetStorageRequirements( image.width, image.height, flags ) );
+				outputs[n].resize( 4*image.width*image.height );
+
+				// keep the fastest of the iterations
+				double bestCompress = 0.0;
+				double bestDecompress = 0.0;
+				for( int i = 0; i < iterations; ++i )
+				{
+					double start = GetSeconds();
+					CompressImage( &image.rgba[0], image.width, image.height, &blocks[n][0], flags, NULL );
+					double middle = GetSeconds();
+					cacheStats[n] = GetBlockCacheStats();
+					DecompressImage( &outputs[n][0], image.width, image.height, &blocks[n][0], flags, NULL );
+					double end = GetSeconds();
+					if( i == 0 || middle - start < bestCompress )
+						bestCompress = middle - start;
+					if( i == 0 || end - middle < bestDecompress )
+						bestDecompress = end - middle;
+				}
+				compressTime += bestCompress;
+				decompressTime += bestDecompress;
+			}
+			if( t == 0 )
+				baseline = compressTime;
+
+			std::printf( "%s\n\t\t\t\t{ \"threads\": %d, \"compressSeconds\": %.6f, \"decompressSeconds\": %.6f, \"blocksPerSecond\": %.1f, \"speedup\": %.3f }", 
+				t ? "," : "", GetThreadCount(), compressTime, decompressTime, 
+				( compressTime > 0.0 ) ? blockCount/compressTime : 0.0, 
+				( compressTime > 0.0 ) ? baseline/compressTime : 0.0 );
+		}
+		std::printf( "\n\t\t\t],\n" );
+
+		// measure the quality of the last output
+		double totalColour = 0.0;
+		double totalAlpha = 0.0;
+		long totalHits = 0;
+		long totalColourPixels = 0;
+		long totalPixels = 0;
+		std::printf( "\t\t\t\"quality\": [" );
+		for( size_t n = 0; n < corpus.size(); ++n )
+		{
+			Image const& image = corpus[n];
+			int pixels = image.width*image.height;
+			double colourSquares, alphaSquares;
+			long colourPixels;
+			GetError( image, outputs[n], format == 0, colourSquares, colourPixels, alphaSquares );
+			totalColour += colourSquares;
+			totalAlpha += alphaSquares;
+			totalColourPixels += colourPixels;
+			totalPixels += pixels;
+
+			int blocks = ( ( image.width + 3 )/4 )*( ( image.height + 3 )/4 );
+			int hits = cacheStats[n].localHits + cacheStats[n].sharedHits;
+			totalHits += hits;
+
+			double rmse = std::sqrt( colourSquares/( 3.0*std::max( colourPixels, 1L ) ) );
+			double alphaRmse = std::sqrt( alphaSquares/pixels );
+			std::printf( "%s\n\t\t\t\t{ \"image\": %s, \"rmse\": %.4f, \"psnr\": %.3f, \"alphaRmse\": %.4f, \"alphaPsnr\": %.3f, \"cacheHitRate\": %.4f }", 
+				n ? "," : "", Quote( image.name ).c_str(), rmse, GetPsnr( rmse ), alphaRmse, GetPsnr( alphaRmse ), ( double )hits/blocks );
+		}
+		double rmse = std::sqrt( totalColour/( 3.0*std::max( totalColourPixels, 1L ) ) );
+		double alphaRmse = std::sqrt( totalAlpha/totalPixels );
+		std::printf( "\n\t\t\t],\n\t\t\t\"blocks\": %ld, \"rmse\": %.4f, \"psnr\": %.3f, \"alphaRmse\": %.4f, \"alphaPsnr\": %.3f, \"cacheHitRate\": %.4f\n\t\t}", 
+			blockCount, rmse, GetPsnr( rmse ), alphaRmse, GetPsnr( alphaRmse ), ( double )totalHits/blockCount );
+		std::fflush( stdout );
+	}
+	std::printf( "\n\t]\n}\n" );
+	return 0;
+}
@@ -0,0 +1,362 @@
+/* -----------------------------------------------------------------------------
+
+	Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files (the 
+	"Software"), to	deal in the Software without restriction, including
+	without limitation the rights to use, copy, modify, merge, publish,
+	distribute, sublicense, and/or sell copies of the Software, and to 
+	permit persons to whom the Software is furnished to do so, subject to 
+	the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+	
+   -------------------------------------------------------------------------- */
+   
+#include "fixedclusterfit.h"
+#include "colourset.h"
+#include "colourblock.h"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+
+namespace squish {
+
+//! Expands a 5 or 6 bit grid value to 8 bits as the decoder does.
+static int Expand( int q, int bits )
+{
+	return ( q << ( 8 - bits ) ) | ( q >> ( 2*bits - 8 ) );
+}
+
+//! Scales an integer vector so that its largest component is in [2^14,2^15).
+static bool NormaliseAxis( int* axis )
+{
+	int largest = std::max( std::abs( axis[0] ), std::max( std::abs( axis[1] ), std::abs( axis[2] ) ) );
+	if( largest == 0 )
+		return false;
+	for( ; largest >= 0x8000; largest >>= 1 )
+	{
+		for( int c = 0; c < 3; ++c )
+			axis[c] /= 2;
+	}
+	for( ; largest < 0x4000; largest <<= 1 )
+	{
+		for( int c = 0; c < 3; ++c )
+			axis[c] *= 2;
+	}
+	return true;
+}
+
+FixedClusterFit::FixedClusterFit( ColourSet const* colours, int flags ) 
+  : ColourFit( colours, flags )
+{
+	// set the iteration count
+	m_iterationCount = ( m_flags & kColourIterativeClusterFit ) ? kMaxIterations : 1;
+
+	// initialise the best error
+	m_besterror = INT_MAX;
+
+	// get the weights, scaling alpha down to at most 16 per pixel so the errors fit 32 bits
+	bool const weightByAlpha = ( ( m_flags & kWeightColourByAlpha ) != 0 );
+	int const count = m_colours->GetCount();
+	int const* weights = m_colours->GetWholeWeights();
+	for( int i = 0; i < count; ++i )
+		m_weights[i] = weightByAlpha ? std::max( ( weights[i] + 8 ) >> 4, 1 ) : weights[i];
+
+	// initialise the metric with weights that keep the largest error below 2^31
+	bool const perceptual = ( ( m_flags & kColourMetricPerceptual ) != 0 );
+	int* metric = m_search.metric;
+	if( perceptual && weightByAlpha )
+	{
+		metric[0] = 27;
+		metric[1] = 92;
+		metric[2] = 9;
+	}
+	else if( perceptual )
+	{
+		metric[0] = 218;
+		metric[1] = 732;
+		metric[2] = 74;
+	}
+	else
+	{
+		for( int c = 0; c < 3; ++c )
+			metric[c] = 1;
+	}
+	metric[3] = 0;
+
+	// sum the points, which is the same for every ordering
+	u8 const* bytes = m_colours->GetBytes();
+	double total = 0.0;
+	double sums[3] = { 0.0, 0.0, 0.0 };
+	double products[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+	for( int c = 0; c < 4; ++c )
+		m_search.xxsum[c] = 0;
+	for( int i = 0; i < count; ++i )
+	{
+		int const w = m_weights[i];
+		u8 const* x = bytes + 4*i;
+		total += w;
+		for( int a = 0, index = 0; a < 3; ++a )
+		{
+			sums[a] += w*x[a];
+			for( int b = a; b < 3; ++b, ++index )
+				products[index] += w*x[a]*x[b];
+		}
+		for( int c = 0; c < 3; ++c )
+			m_search.xxsum[c] += w*x[c]*x[c];
+	}
+	m_search.count = count;
+
+	// get the covariance scaled by the total weight squared, exactly in double
+	double covariance[6];
+	double largest = 0.0;
+	for( int a = 0, index = 0; a < 3; ++a )
+	{
+		for( int b = a; b < 3; ++b, ++index )
+		{
+			covariance[index] = total*products[index] - sums[a]*sums[b];
+			largest = std::max( largest, std::fabs( covariance[index] ) );
+		}
+	}
+
+	// scale it down by a power of two into 15 bit integers
+	double scale = 1.0;
+	while( largest*scale >= 16384.0 )
+		scale *= 0.5;
+	int const symmetric[3][3] = { { 0, 1, 2 }, { 1, 3, 4 }, { 2, 4, 5 } };
+	int matrix[3][3];
+	for( int a = 0; a < 3; ++a )
+	{
+		for( int b = 0; b < 3; ++b )
+			matrix[a][b] = ( int )( scale*covariance[symmetric[a][b]] );
+	}
+
+	// start from the column with the largest variance
+	int column = 0;
+	for( int c = 1; c < 3; ++c )
+	{
+		if( matrix[c][c] > matrix[column][column] )
+			column = c;
+	}
+	for( int c = 0; c < 3; ++c )
+		m_principle[c] = matrix[c][column];
+
+	// refine it towards the principle component by power iteration
+	if( !NormaliseAxis( m_principle ) )
+	{
+		for( int c = 0; c < 3; ++c )
+			m_principle[c] = 1;
+	}
+	for( int iteration = 0; iteration < 8; ++iteration )
+	{
+		int axis[3];
+		for( int a = 0; a < 3; ++a )
+			axis[a] = matrix[a][0]*m_principle[0] + matrix[a][1]*m_principle[1] + matrix[a][2]*m_principle[2];
+		if( !NormaliseAxis( axis ) )
+			break;
+		for( int c = 0; c < 3; ++c )
+			m_principle[c] = axis[c];
+	}
+}
+
+bool FixedClusterFit::ConstructOrdering( int const* axis, int iteration )
+{
+	// cache some values
+	int const count = m_colours->GetCount();
+	u8 const* bytes = m_colours->GetBytes();
+
+	// build the list of dot products
+	int dps[16];
+	u8* order = ( u8* )m_order + 16*iteration;
+	for( int i = 0; i < count; ++i )
+	{
+		u8 const* x = bytes + 4*i;
+		dps[i] = x[0]*axis[0] + x[1]*axis[1] + x[2]*axis[2];
+		order[i] = ( u8 )i;
+	}
+		
+	// stable sort using them
+	for( int i = 0; i < count; ++i )
+	{
+		for( int j = i; j > 0 && dps[j] < dps[j - 1]; --j )
+		{
+			std::swap( dps[j], dps[j - 1] );
+			std::swap( order[j], order[j - 1] );
+		}
+	}
+	
+	// check this ordering is unique
+	for( int it = 0; it < iteration; ++it )
+	{
+		u8 const* prev = ( u8* )m_order + 16*it;
+		bool same = true;
+		for( int i = 0; i < count; ++i )
+		{
+			if( order[i] != prev[i] )
+			{
+				same = false;
+				break;
+			}
+		}
+		if( same )
+			return false;
+	}
+	
+	// copy the ordering and weight all the points
+	int* xsum_wsum = m_search.xsum_wsum;
+	for( int c = 0; c < 4; ++c )
+		xsum_wsum[c] = 0;
+	for( int i = 0; i < count; ++i )
+	{
+		int const j = order[i];
+		int const w = m_weights[j];
+		int* x = m_search.points_weights[i];
+		for( int c = 0; c < 3; ++c )
+			x[c] = w*bytes[4*j + c];
+		x[3] = w;
+		for( int c = 0; c < 4; ++c )
+			xsum_wsum[c] += x[c];
+	}
+	return true;
+}
+
+void FixedClusterFit::BeginSearch()
+{
+	// start from the best error so far (this block may already have a solution)
+	m_search.besterror = m_besterror;
+	for( int c = 0; c < 4; ++c )
+	{
+		m_search.beststart[c] = 0;
+		m_search.bestend[c] = 0;
+	}
+	m_search.besti = 0;
+	m_search.bestj = 0;
+	m_search.bestk = 0;
+}
+
+int FixedClusterFit::Search( void ( *search )( FixedClusterFitSearch& ) )
+{
+	// prepare an ordering using the principle axis
+	ConstructOrdering( m_principle, 0 );
+	
+	// check all possible clusters and iterate on the total order
+	BeginSearch();
+	int bestiteration = 0;
+	for( int iterationIndex = 0;; )
+	{
+		// search the clusters of this ordering
+		search( m_search );
+		if( m_search.improved )
+			bestiteration = iterationIndex;
+
+		// stop if we didn't improve in this iteration
+		if( bestiteration != iterationIndex )
+			break;
+			
+		// advance if possible
+		++iterationIndex;
+		if( iterationIndex == m_iterationCount )
+			break;
+			
+		// stop if a new iteration is an ordering that has already been tried
+		int const bits[3] = { 5, 6, 5 };
+		int axis[3];
+		for( int c = 0; c < 3; ++c )
+			axis[c] = Expand( m_search.bestend[c], bits[c] ) - Expand( m_search.beststart[c], bits[c] );
+		if( !ConstructOrdering( axis, iterationIndex ) )
+			break;
+	}
+	return bestiteration;
+}
+
+Vec3 FixedClusterFit::GetBestStart() const
+{
+	return Vec3( ( float )m_search.beststart[0]/31.0f, ( float )m_search.beststart[1]/63.0f, ( float )m_search.beststart[2]/31.0f );
+}
+
+Vec3 FixedClusterFit::GetBestEnd() const
+{
+	return Vec3( ( float )m_search.bestend[0]/31.0f, ( float )m_search.bestend[1]/63.0f, ( float )m_search.bestend[2]/31.0f );
+}
+
+void FixedClusterFit::Compress3( void* block )
+{
+	// search the orderings
+	int const count = m_colours->GetCount();
+	int const bestiteration = Search( GetKernels().FixedClusterFitSearch3 );
+		
+	// save the block if necessary
+	if( m_search.besterror < m_besterror )
+	{
+		// remap the indices
+		u8 const* order = ( u8* )m_order + 16*bestiteration;
+		int const besti = m_search.besti;
+		int const bestj = m_search.bestj;
+
+		u8 unordered[16];
+		for( int m = 0; m < besti; ++m )
+			unordered[order[m]] = 0;
+		for( int m = besti; m < bestj; ++m )
+			unordered[order[m]] = 2;
+		for( int m = bestj; m < count; ++m )
+			unordered[order[m]] = 1;
+
+		u8 bestindices[16];
+		m_colours->RemapIndices( unordered, bestindices );
+		
+		// save the block
+		WriteColourBlock3( GetBestStart(), GetBestEnd(), bestindices, block );
+
+		// save the error
+		m_besterror = m_search.besterror;
+	}
+}
+
+void FixedClusterFit::Compress4( void* block )
+{
+	// search the orderings
+	int const count = m_colours->GetCount();
+	int const bestiteration = Search( GetKernels().FixedClusterFitSearch4 );
+
+	// save the block if necessary
+	if( m_search.besterror < m_besterror )
+	{
+		// remap the indices
+		u8 const* order = ( u8* )m_order + 16*bestiteration;
+		int const besti = m_search.besti;
+		int const bestj = m_search.bestj;
+		int const bestk = m_search.bestk;
+
+		u8 unordered[16];
+		for( int m = 0; m < besti; ++m )
+			unordered[order[m]] = 0;
+		for( int m = besti; m < bestj; ++m )
+			unordered[order[m]] = 2;
+		for( int m = bestj; m < bestk; ++m )
+			unordered[order[m]] = 3;
+		for( int m = bestk; m < count; ++m )
+			unordered[order[m]] = 1;
+
+		u8 bestindices[16];
+		m_colours->RemapIndices( unordered, bestindices );
+		
+		// save the block
+		WriteColourBlock4( GetBestStart(), GetBestEnd(), bestindices, block );
+
+		// save the error
+		m_besterror = m_search.besterror;
+	}
+}
+
+} // namespace squish
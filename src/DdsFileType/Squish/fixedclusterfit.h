@@ -0,0 +1,71 @@
+/* -----------------------------------------------------------------------------
+
+	Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files (the 
+	"Software"), to	deal in the Software without restriction, including
+	without limitation the rights to use, copy, modify, merge, publish,
+	distribute, sublicense, and/or sell copies of the Software, and to 
+	permit persons to whom the Software is furnished to do so, subject to 
+	the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+	
+   -------------------------------------------------------------------------- */
+   
+#ifndef SQUISH_FIXEDCLUSTERFIT_H
+#define SQUISH_FIXEDCLUSTERFIT_H
+
+#include <squish.h>
+#include "maths.h"
+#include "colourfit.h"
+#include "kernels.h"
+
+namespace squish {
+
+/*! @brief A cluster fit that works entirely in integers.
+
+	The orderings, end points and errors are all computed from the original
+	bytes in exact integer arithmetic, so the compressed block is the same 
+	whichever instruction set or floating point model the library is built 
+	for. The errors are the exact errors of the decoded palette.
+*/
+class FixedClusterFit : public ColourFit
+{
+public:
+	FixedClusterFit( ColourSet const* colours, int flags );
+	
+private:
+	bool ConstructOrdering( int const* axis, int iteration );
+	void BeginSearch();
+	int Search( void ( *search )( FixedClusterFitSearch& ) );
+
+	Vec3 GetBestStart() const;
+	Vec3 GetBestEnd() const;
+
+	virtual void Compress3( void* block );
+	virtual void Compress4( void* block );
+
+	enum { kMaxIterations = 8 };
+
+	int m_iterationCount;
+	int m_weights[16];
+	int m_principle[3];
+	u8 m_order[16*kMaxIterations];
+	FixedClusterFitSearch m_search;
+	int m_besterror;
+};
+
+} // namespace squish
+
+#endif // ndef SQUISH_FIXEDCLUSTERFIT_H
@@ -0,0 +1,232 @@
+/* -----------------------------------------------------------------------------
+
+	Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files (the 
+	"Software"), to	deal in the Software without restriction, including
+	without limitation the rights to use, copy, modify, merge, publish,
+	distribute, sublicense, and/or sell copies of the Software, and to 
+	permit persons to whom the Software is furnished to do so, subject to 
+	the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+	
+   -------------------------------------------------------------------------- */
+   
+#include "kernels.h"
+#include "config.h"
+#include "threadpool.h"
+#include <cstddef>
+
+#if SQUISH_USE_X86_KERNELS
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace squish {
+
+// one table for each level, filled in before the level is first used
+static Kernels g_kernels[kInstructionSetAvx2 + 1];
+static bool g_built[kInstructionSetAvx2 + 1];
+
+// the level in use, or -1 before the first use
+static long volatile g_instructionSet = -1;
+
+// a level set while images are being processed, and the number of those images
+static int g_requested = -1;
+static int g_scopes = 0;
+static CriticalSection g_lock;
+
+#include "clusterfitlookup.inl"
+
+#if SQUISH_USE_X86_KERNELS
+
+static void CpuId( int leaf, int* regs )
+{
+#ifdef _MSC_VER
+	__cpuidex( regs, leaf, 0 );
+#else
+	unsigned int a, b, c, d;
+	__cpuid_count( leaf, 0, a, b, c, d );
+	regs[0] = ( int )a;
+	regs[1] = ( int )b;
+	regs[2] = ( int )c;
+	regs[3] = ( int )d;
+#endif
+}
+
+static bool IsAvxStateEnabled()
+{
+	// XCR0 is read in the AVX2 kernels, whose compiler has the intrinsic for it
+#if SQUISH_USE_AVX2_KERNEL
+	return avx2::IsStateEnabled();
+#else
+	return false;
+#endif
+}
+
+static int DetectInstructionSet()
+{
+	int regs[4];
+	CpuId( 0, regs );
+	int const maxLeaf = regs[0];
+
+	// SSE2 is edx bit 26 of leaf 1
+	CpuId( 1, regs );
+	if( ( regs[3] & ( 1 << 26 ) ) == 0 )
+		return kInstructionSetScalar;
+
+	// AVX2 needs OSXSAVE and AVX (ecx bits 27 and 28) and leaf 7 ebx bit 5
+	bool const avx = ( regs[2] & ( 1 << 27 ) ) != 0 && ( regs[2] & ( 1 << 28 ) ) != 0;
+	if( avx && maxLeaf >= 7 && IsAvxStateEnabled() )
+	{
+		CpuId( 7, regs );
+		if( ( regs[1] & ( 1 << 5 ) ) != 0 )
+			return kInstructionSetAvx2;
+	}
+	return kInstructionSetSse2;
+}
+
+#else
+
+static int DetectInstructionSet()
+{
+	return kInstructionSetScalar;
+}
+
+#endif
+
+static int GetSupportedInstructionSet( int maximum )
+{
+	// clamp to what the processor and this build support
+	int level = DetectInstructionSet();
+	if( maximum < level )
+		level = maximum;
+#if !SQUISH_USE_AVX2_KERNEL
+	if( level > kInstructionSetSse2 )
+		level = kInstructionSetSse2;
+#endif
+	return ( level > kInstructionSetScalar ) ? level : kInstructionSetScalar;
+}
+
+static void ApplyInstructionSet( int level )
+{
+	// fill the table for this level the first time it is used
+	if( !g_built[level] )
+	{
+		switch( level )
+		{
+#if SQUISH_USE_AVX2_KERNEL
+		case kInstructionSetAvx2:
+			avx2::InitialiseKernels( g_kernels[level] );
+			break;
+#endif
+
+#if SQUISH_USE_X86_KERNELS
+		case kInstructionSetSse2:
+			sse2::InitialiseKernels( g_kernels[level] );
+			break;
+#endif
+
+		default:
+			scalar::InitialiseKernels( g_kernels[level] );
+			break;
+		}
+		g_built[level] = true;
+	}
+
+	// publish the level with a full barrier, so readers never see it before its table
+	AtomicCompareExchange( &g_instructionSet, level, g_instructionSet );
+}
+
+int SetInstructionSet( int maximum )
+{
+	int const level = GetSupportedInstructionSet( maximum );
+
+	// wait for the images being processed to finish before switching
+	g_lock.Enter();
+	if( g_scopes == 0 )
+	{
+		ApplyInstructionSet( level );
+		g_requested = -1;
+	}
+	else
+		g_requested = level;
+	g_lock.Leave();
+	return level;
+}
+
+int GetInstructionSet()
+{
+	GetKernels();
+	return ( int )g_instructionSet;
+}
+
+u8 const* GetClusterPartitions3( int count, int& partitionCount )
+{
+	partitionCount = partitions_3_offsets[count + 1] - partitions_3_offsets[count];
+	return partitions_3[partitions_3_offsets[count]];
+}
+
+u8 const* GetClusterPartitions4( int count, int& partitionCount )
+{
+	partitionCount = partitions_4_offsets[count + 1] - partitions_4_offsets[count];
+	return partitions_4[partitions_4_offsets[count]];
+}
+
+Kernels const& GetKernels()
+{
+	// select the best kernels on first use if SquishInitialize was not called
+	long level = g_instructionSet;
+	if( level < 0 )
+	{
+		g_lock.Enter();
+		if( g_instructionSet < 0 )
+			ApplyInstructionSet( GetSupportedInstructionSet( kInstructionSetAvx2 ) );
+		level = g_instructionSet;
+		g_lock.Leave();
+	}
+	return g_kernels[level];
+}
+
+KernelScope::KernelScope()
+{
+	// take any level set since the last image, or the best one on first use
+	g_lock.Enter();
+	if( g_scopes == 0 && g_requested >= 0 )
+	{
+		ApplyInstructionSet( g_requested );
+		g_requested = -1;
+	}
+	else if( g_instructionSet < 0 )
+		ApplyInstructionSet( GetSupportedInstructionSet( kInstructionSetAvx2 ) );
+	++g_scopes;
+	g_lock.Leave();
+}
+
+KernelScope::~KernelScope()
+{
+	// switch to a level that was set while the images were being processed
+	g_lock.Enter();
+	if( --g_scopes == 0 && g_requested >= 0 )
+	{
+		ApplyInstructionSet( g_requested );
+		g_requested = -1;
+	}
+	g_lock.Leave();
+}
+
+} // namespace squish
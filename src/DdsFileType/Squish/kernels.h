@@ -0,0 +1,199 @@
+/* -----------------------------------------------------------------------------
+
+	Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files (the 
+	"Software"), to	deal in the Software without restriction, including
+	without limitation the rights to use, copy, modify, merge, publish,
+	distribute, sublicense, and/or sell copies of the Software, and to 
+	permit persons to whom the Software is furnished to do so, subject to 
+	the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+	
+   -------------------------------------------------------------------------- */
+   
+#ifndef SQUISH_KERNELS_H
+#define SQUISH_KERNELS_H
+
+#include <squish.h>
+
+namespace squish {
+
+/*! @brief The state of a cluster fit search over one total ordering.
+
+	The points are stored in order with their weights applied, as 
+	( w*x, w*y, w*z, w ), and the best solution is updated in place.
+*/
+struct ClusterFitSearch
+{
+	float points_weights[16][4];
+	float xsum_wsum[4];
+	float metric[4];
+	int count;
+
+	float besterror;
+	float beststart[4];
+	float bestend[4];
+	int besti;
+	int bestj;
+	int bestk;
+	bool improved;
+};
+
+/*! @brief The state of an integer cluster fit search over one total ordering.
+
+	The points are the original bytes with whole number weights applied, as
+	( w*r, w*g, w*b, w ), and the errors are the exact weighted squared 
+	errors of the decoded palette against them. The best end points are 
+	kept on the 5:6:5 grid. Every instruction set finds the same solution.
+*/
+struct FixedClusterFitSearch
+{
+	int points_weights[16][4];
+	int xsum_wsum[4];
+	int xxsum[4];
+	int metric[4];
+	int count;
+
+	int besterror;
+	int beststart[4];
+	int bestend[4];
+	int besti;
+	int bestj;
+	int bestk;
+	bool improved;
+};
+
+/*! @brief The range fits of up to four blocks, one block per lane.
+
+	The points are stored a component at a time with the lanes innermost, 
+	and blocks with fewer points are padded with zero weights up to count.
+	The covariance is filled in by the first range fit kernel, and the 
+	principle component either by RangeFitPrinciple or the exact solver.
+*/
+struct RangeFitBatch
+{
+	float points[16][3][4];
+	float weights[16][4];
+	float counts[4];
+	float metric[4];
+	int count;
+	bool dxt1;
+
+	float covariance[6][4];
+	float principle[3][4];
+
+	float start[3][4];
+	float end[3][4];
+	float error3[4];
+	float error4[4];
+	u8 closest3[16][4];
+	u8 closest4[16][4];
+};
+
+/*! @brief The hot loops that are compiled once per instruction set.
+
+	The faster variants evaluate more candidates at once. The SSE2 and AVX2
+	versions of the float cluster fit searches use an approximate reciprocal
+	with a Newton-Raphson step where the scalar code divides, so they can
+	pick different end points for a few blocks. Every other kernel gives
+	identical results on all the instruction sets.
+*/
+struct Kernels
+{
+	void ( *ClusterFitSearch3 )( ClusterFitSearch& search );
+	void ( *ClusterFitSearch4 )( ClusterFitSearch& search );
+	void ( *FixedClusterFitSearch3 )( FixedClusterFitSearch& search );
+	void ( *FixedClusterFitSearch4 )( FixedClusterFitSearch& search );
+	void ( *RangeFitCovariance )( RangeFitBatch& batch );
+	void ( *RangeFitPrinciple )( RangeFitBatch& batch );
+	void ( *RangeFitCodes )( RangeFitBatch& batch );
+
+	//! Finds the first valid pixel with the colour of each valid pixel of a block, ignoring alpha.
+	void ( *MatchColours )( u8 const* rgba, int valid, int* firsts );
+
+	//! Converts count points of 4 bytes to floats in [0,1] and roots their scaled weights, using whole groups of 4 points.
+	void ( *UnpackColours )( u8 const* bytes, int const* weights, int count, float weightScale, float* points, float* roots );
+
+	//! Checks whether the valid pixels of a block all have the same 4 bytes, and gets them as colour.
+	bool ( *GetSolidColour )( u8 const* rgba, int mask, u8* colour );
+
+	//! Counts the pixels at the start of a row of count pixels that have the same 4 bytes as colour.
+	int ( *MatchPixels )( u8 const* pixels, int count, u8 const* colour );
+
+	//! Compresses the colour of count blocks with bounding box end points, writing the blocks stride bytes apart, and the squared RGB error of each block to errors if it is not NULL.
+	void ( *FastFitColours )( u8 const* rgba, int const* masks, int count, bool dxt1, u8* blocks, int stride, int* errors );
+
+	//! Compresses the DXT5 alpha of count blocks over the range of their values, writing the blocks stride bytes apart.
+	void ( *FastFitAlphas )( u8 const* rgba, int const* masks, int count, u8* blocks, int stride );
+
+	//! Compresses the DXT5 alpha of count blocks, optionally refining the end points, writing the blocks stride bytes apart.
+	void ( *FitAlphas )( u8 const* rgba, int const* masks, int count, bool refine, u8* blocks, int stride );
+
+	//! Decompresses a row of count blocks into 4 rows of rgba pixels, stride bytes apart.
+	void ( *DecompressBlocks )( u8 const* blocks, int count, int flags, u8* rgba, int stride );
+
+	//! Sums count values of each row with one weight per row, for filtering a mipmap vertically.
+	void ( *FilterRows )( float const* const* rows, float const* weights, int rowCount, int count, float* output );
+
+	//! Filters count rgba pixels, each from tapCount input pixels from its start with its own weights.
+	void ( *FilterPixels )( float const* input, int const* starts, float const* weights, int tapCount, int count, float* output );
+
+	//! Packs count pixels in the given layout into a row of an uncompressed DDS format.
+	void ( *PackPixels )( u8 const* pixels, int count, int pixelFormat, int format, u8* packed );
+
+	//! Unpacks count pixels of an uncompressed DDS format into the given layout.
+	void ( *UnpackPixels )( u8* pixels, int count, int pixelFormat, int format, u8 const* packed );
+};
+
+/*! @brief Gets the splits of an ordering of count points into clusters.
+
+	The 3 cluster splits are ( i, j ) pairs for the clusters [0,i) [i,j)
+	[j,count) and the 4 cluster splits are ( i, j, k ) triples for [0,i) 
+	[i,j) [j,k) [k,count). They are listed in the order that the searches 
+	visit them, see extra/clusterfitgen.cpp.
+*/
+u8 const* GetClusterPartitions3( int count, int& partitionCount );
+u8 const* GetClusterPartitions4( int count, int& partitionCount );
+
+//! Gets the kernels selected for this processor.
+Kernels const& GetKernels();
+
+/*! @brief Keeps the selected kernels fixed while an image is processed.
+
+	SetInstructionSet only switches the kernels once every open scope has
+	closed, so all the blocks of an image go through the same kernels. The
+	scope also selects the kernels before the workers first need them.
+*/
+class KernelScope
+{
+public:
+	KernelScope();
+	~KernelScope();
+
+private:
+	KernelScope( KernelScope const& );
+	KernelScope& operator=( KernelScope const& );
+};
+
+namespace scalar { void InitialiseKernels( Kernels& kernels ); }
+namespace sse2 { void InitialiseKernels( Kernels& kernels ); }
+namespace avx2 { void InitialiseKernels( Kernels& kernels ); }
+
+// checks that the OS saves the upper halves of the AVX registers, built with the AVX2 kernels
+namespace avx2 { bool IsStateEnabled(); }
+
+} // namespace squish
+
+#endif // ndef SQUISH_KERNELS_H
@@ -0,0 +1,2508 @@
+/* -----------------------------------------------------------------------------
+
+	Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files (the 
+	"Software"), to	deal in the Software without restriction, including
+	without limitation the rights to use, copy, modify, merge, publish,
+	distribute, sublicense, and/or sell copies of the Software, and to 
+	permit persons to whom the Software is furnished to do so, subject to 
+	the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+	
+   -------------------------------------------------------------------------- */
+   
+/*! @file
+
+	The bodies of the dispatched kernels. This file is included once per 
+	instruction set, with SQUISH_KERNEL_NAMESPACE and the SQUISH_USE_* 
+	macros set up by the including file, so that every copy of Vec4 and 
+	everything built on it gets its own symbols.
+*/
+
+#include "kernels.h"
+#include "alpha.h"
+#include "maths.h"
+#include "simd.h"
+#include <cfloat>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+namespace squish {
+namespace SQUISH_KERNEL_NAMESPACE {
+
+static Vec4 Load( float const* values )
+{
+	return Vec4( values[0], values[1], values[2], values[3] );
+}
+
+/*! @brief Lower bounds on the error of the partitions of one ordering.
+
+	All the points of a cluster share one code, so the error of a cluster
+	can never be less than the scatter of its points about their centroid.
+	The searches skip a partition once the scatter of its clusters is over 
+	the best error, and stop once the first cluster alone is over.
+	
+	The bounds are exact sums in double precision. The slack adds back the 
+	constant term that the searches leave out of their errors, plus a margin 
+	that is many times the rounding error of the float error terms, so that 
+	a skipped partition could never have won. The search therefore finds 
+	exactly the same solution as checking every partition.
+*/
+class ClusterBounds
+{
+public:
+	ClusterBounds( ClusterFitSearch const& search )
+	{
+		double sums[17][7];
+		Initialise( search.points_weights, search.metric, search.count, sums );
+
+		// the slack covers the missing xxsum and the float rounding
+		double xxsum = 0.0;
+		double metric = 0.0;
+		for( int c = 0; c < 3; ++c )
+		{
+			xxsum += search.metric[c]*sums[m_count][3 + c];
+			metric += search.metric[c];
+		}
+		m_slack = xxsum + ( 1.0/65536.0 )*metric*sums[m_count][6];
+	}
+
+	ClusterBounds( FixedClusterFitSearch const& search )
+	{
+		// the integer errors are exact and whole, so the bounds need no slack
+		double sums[17][7];
+		Initialise( search.points_weights, search.metric, search.count, sums );
+		m_slack = 0.0;
+	}
+
+	//! Gets the scatter of the first cluster [0,i).
+	double First( int i ) const { return m_scatter[0][i]; }
+
+	//! Gets the scatter of the clusters [0,i) [i,count).
+	double Get( int i, int j ) const 
+	{ 
+		return m_scatter[0][i] + m_scatter[i][j] + m_scatter[j][m_count]; 
+	}
+
+	//! Gets the scatter of the clusters [0,i) [i,j) [j,k) [k,count).
+	double Get( int i, int j, int k ) const 
+	{ 
+		return m_scatter[0][i] + m_scatter[i][j] + m_scatter[j][k] + m_scatter[k][m_count]; 
+	}
+
+	//! Gets the bound that a partition must not exceed to beat this error.
+	double GetLimit( Vec4::Arg besterror ) const
+	{
+		float errors[4];
+		besterror.Store( errors );
+		return errors[0] + m_slack;
+	}
+
+	//! Gets the bound that a partition must not exceed to beat this integer error.
+	double GetLimit( int besterror ) const
+	{
+		return besterror + m_slack;
+	}
+
+private:
+	template< typename T >
+	void Initialise( T const ( *points_weights )[4], T const* metric, int count, double ( *sums )[7] )
+	{
+		// accumulate the weighted sums of x, x^2 and w along the ordering
+		for( int c = 0; c < 7; ++c )
+			sums[0][c] = 0.0;
+		for( int i = 0; i < count; ++i )
+		{
+			T const* x = points_weights[i];
+			double const w = x[3];
+			for( int c = 0; c < 3; ++c )
+			{
+				sums[i + 1][c] = sums[i][c] + x[c];
+				sums[i + 1][3 + c] = sums[i][3 + c] + ( double )x[c]*x[c]/w;
+			}
+			sums[i + 1][6] = sums[i][6] + w;
+		}
+
+		// get the scatter of each run [a,b) from the differences of the sums
+		for( int a = 0; a <= count; ++a )
+		{
+			m_scatter[a][a] = 0.0;
+			for( int b = a + 1; b <= count; ++b )
+			{
+				double const rcp = 1.0/( sums[b][6] - sums[a][6] );
+				double scatter = 0.0;
+				for( int c = 0; c < 3; ++c )
+				{
+					double const x = sums[b][c] - sums[a][c];
+					double const xx = sums[b][3 + c] - sums[a][3 + c];
+					scatter += metric[c]*( xx - x*x*rcp );
+				}
+				m_scatter[a][b] = scatter;
+			}
+		}
+		m_count = count;
+	}
+
+	double m_scatter[17][17];
+	double m_slack;
+	int m_count;
+};
+
+/*! @brief Sums every run of the ordered points.
+
+	Each run [a,b) is summed from a upwards, which is the order that the 
+	nested cluster loops used to accumulate them in, so the partitions see 
+	exactly the same sums whichever order they are visited in.
+*/
+static void SumRuns( Vec4 const* points_weights, int count, Vec4 ( *runs )[17] )
+{
+	for( int a = 0; a <= count; ++a )
+	{
+		Vec4 sum = VEC4_CONST( 0.0f );
+		runs[a][a] = sum;
+		for( int b = a + 1; b <= count; ++b )
+		{
+			sum += points_weights[b - 1];
+			runs[a][b] = sum;
+		}
+	}
+}
+
+static void ClusterFitSearch3( ClusterFitSearch& search )
+{
+	// declare variables
+	int const count = search.count;
+	Vec4 const two = VEC4_CONST( 2.0 );
+	Vec4 const one = VEC4_CONST( 1.0f );
+	Vec4 const half_half2( 0.5f, 0.5f, 0.5f, 0.25f );
+	Vec4 const zero = VEC4_CONST( 0.0f );
+	Vec4 const half = VEC4_CONST( 0.5f );
+	Vec4 const grid( 31.0f, 63.0f, 31.0f, 0.0f );
+	Vec4 const gridrcp( 1.0f/31.0f, 1.0f/63.0f, 1.0f/31.0f, 0.0f );
+
+	// load the ordered points and sum their runs
+	Vec4 points_weights[16];
+	for( int i = 0; i < count; ++i )
+		points_weights[i] = Load( search.points_weights[i] );
+	Vec4 runs[17][17];
+	SumRuns( points_weights, count, runs );
+	Vec4 const xsum_wsum = Load( search.xsum_wsum );
+	Vec4 const metric = Load( search.metric );
+	
+	// check all possible clusters for this total order
+	Vec4 beststart = Load( search.beststart );
+	Vec4 bestend = Load( search.bestend );
+	Vec4 besterror = Vec4( search.besterror );
+	int besti = search.besti, bestj = search.bestj;
+	bool improved = false;
+
+	// get the bounds for skipping the partitions that cannot win
+	ClusterBounds const bounds( search );
+	double limit = bounds.GetLimit( besterror );
+
+	// sweep the partitions [0,i) [i,j) [j,count) in order
+	int partitionCount;
+	u8 const* partitions = GetClusterPartitions3( count, partitionCount );
+	for( int n = 0; n < partitionCount; ++n, partitions += 2 )
+	{
+		int const i = partitions[0];
+		int const j = partitions[1];
+
+		// stop once the first cluster is over, as it only grows from here
+		if( bounds.First( i ) > limit )
+			break;
+		if( bounds.Get( i, j ) > limit )
+			continue;
+
+		// the clusters are at the start, half along and at the end
+		Vec4 const part0 = runs[0][i];
+		Vec4 const part1 = runs[i][j];
+		Vec4 const part2 = xsum_wsum - part1 - part0;
+		
+		// compute least squares terms directly
+		Vec4 alphax_sum = MultiplyAdd( part1, half_half2, part0 );
+		Vec4 alpha2_sum = alphax_sum.SplatW();
+
+		Vec4 betax_sum = MultiplyAdd( part1, half_half2, part2 );
+		Vec4 beta2_sum = betax_sum.SplatW();
+
+		Vec4 alphabeta_sum = ( part1*half_half2 ).SplatW();
+
+		// compute the least-squares optimal points
+		Vec4 factor = Reciprocal( NegativeMultiplySubtract( alphabeta_sum, alphabeta_sum, alpha2_sum*beta2_sum ) );
+		Vec4 a = NegativeMultiplySubtract( betax_sum, alphabeta_sum, alphax_sum*beta2_sum )*factor;
+		Vec4 b = NegativeMultiplySubtract( alphax_sum, alphabeta_sum, betax_sum*alpha2_sum )*factor;
+
+		// clamp to the grid
+		a = Min( one, Max( zero, a ) );
+		b = Min( one, Max( zero, b ) );
+		a = Truncate( MultiplyAdd( grid, a, half ) )*gridrcp;
+		b = Truncate( MultiplyAdd( grid, b, half ) )*gridrcp;
+		
+		// compute the error (we skip the constant xxsum)
+		Vec4 e1 = MultiplyAdd( a*a, alpha2_sum, b*b*beta2_sum );
+		Vec4 e2 = NegativeMultiplySubtract( a, alphax_sum, a*b*alphabeta_sum );
+		Vec4 e3 = NegativeMultiplySubtract( b, betax_sum, e2 );
+		Vec4 e4 = MultiplyAdd( two, e3, e1 );
+
+		// apply the metric to the error term
+		Vec4 e5 = e4*metric;
+		Vec4 error = e5.SplatX() + e5.SplatY() + e5.SplatZ();
+		
+		// keep the solution if it wins
+		if( CompareAnyLessThan( error, besterror ) )
+		{
+			beststart = a;
+			bestend = b;
+			besti = i;
+			bestj = j;
+			besterror = error;
+			improved = true;
+			limit = bounds.GetLimit( besterror );
+		}
+	}
+
+	// store the best solution
+	if( improved )
+	{
+		float errors[4];
+		besterror.Store( errors );
+		beststart.Store( search.beststart );
+		bestend.Store( search.bestend );
+		search.besterror = errors[0];
+		search.besti = besti;
+		search.bestj = bestj;
+	}
+	search.improved = improved;
+}
+
+static void ClusterFitSearch4( ClusterFitSearch& search )
+{
+	// declare variables
+	int const count = search.count;
+	Vec4 const two = VEC4_CONST( 2.0f );
+	Vec4 const one = VEC4_CONST( 1.0f );
+	Vec4 const onethird_onethird2( 1.0f/3.0f, 1.0f/3.0f, 1.0f/3.0f, 1.0f/9.0f );
+	Vec4 const twothirds_twothirds2( 2.0f/3.0f, 2.0f/3.0f, 2.0f/3.0f, 4.0f/9.0f );
+	Vec4 const twonineths = VEC4_CONST( 2.0f/9.0f );
+	Vec4 const zero = VEC4_CONST( 0.0f );
+	Vec4 const half = VEC4_CONST( 0.5f );
+	Vec4 const grid( 31.0f, 63.0f, 31.0f, 0.0f );
+	Vec4 const gridrcp( 1.0f/31.0f, 1.0f/63.0f, 1.0f/31.0f, 0.0f );
+
+	// load the ordered points and sum their runs
+	Vec4 points_weights[16];
+	for( int i = 0; i < count; ++i )
+		points_weights[i] = Load( search.points_weights[i] );
+	Vec4 runs[17][17];
+	SumRuns( points_weights, count, runs );
+	Vec4 const xsum_wsum = Load( search.xsum_wsum );
+	Vec4 const metric = Load( search.metric );
+#if SQUISH_USE_AVX
+	Vec8 const two2( two, two );
+	Vec8 const one2( one, one );
+	Vec8 const onethird_onethird2x2( onethird_onethird2, onethird_onethird2 );
+	Vec8 const twothirds_twothirds2x2( twothirds_twothirds2, twothirds_twothirds2 );
+	Vec8 const twonineths2( twonineths, twonineths );
+	Vec8 const zero2( zero, zero );
+	Vec8 const half2( half, half );
+	Vec8 const grid2( grid, grid );
+	Vec8 const gridrcp2( gridrcp, gridrcp );
+	Vec8 const metric2( metric, metric );
+	Vec8 const xsum_wsum2( xsum_wsum, xsum_wsum );
+#endif
+
+	// check all possible clusters for this total order
+	Vec4 beststart = Load( search.beststart );
+	Vec4 bestend = Load( search.bestend );
+	Vec4 besterror = Vec4( search.besterror );
+	int besti = search.besti, bestj = search.bestj, bestk = search.bestk;
+	bool improved = false;
+
+	// get the bounds for skipping the partitions that cannot win
+	ClusterBounds const bounds( search );
+	double limit = bounds.GetLimit( besterror );
+
+	// sweep the partitions [0,i) [i,j) [j,k) [k,count) in order
+	int partitionCount;
+	u8 const* partitions = GetClusterPartitions4( count, partitionCount );
+#if SQUISH_USE_AVX
+	for( int n = 0; n < partitionCount; n += 2, partitions += 6 )
+	{
+		// score one partition in the low half and the next in the high half (or the same one at the end)
+		bool const paired = ( n + 1 < partitionCount );
+		u8 const* next = paired ? partitions + 3 : partitions;
+		int const i = partitions[0], j = partitions[1], k = partitions[2];
+		int const i2 = next[0], j2 = next[1], k2 = next[2];
+
+		// stop once the first cluster is over, as it only grows from here
+		if( bounds.First( i ) > limit )
+			break;
+		if( bounds.Get( i, j, k ) > limit && bounds.Get( i2, j2, k2 ) > limit )
+			continue;
+
+		// the clusters are at the start, one third along, two thirds along and at the end
+		Vec8 const part0( runs[0][i], runs[0][i2] );
+		Vec8 const part1( runs[i][j], runs[i2][j2] );
+		Vec8 const part2( runs[j][k], runs[j2][k2] );
+		Vec8 const part3 = xsum_wsum2 - part2 - part1 - part0;
+
+		// compute least squares terms directly
+		Vec8 const alphax_sum = MultiplyAdd( part2, onethird_onethird2x2, MultiplyAdd( part1, twothirds_twothirds2x2, part0 ) );
+		Vec8 const alpha2_sum = alphax_sum.SplatW();
+		
+		Vec8 const betax_sum = MultiplyAdd( part1, onethird_onethird2x2, MultiplyAdd( part2, twothirds_twothirds2x2, part3 ) );
+		Vec8 const beta2_sum = betax_sum.SplatW();
+		
+		Vec8 const alphabeta_sum = twonineths2*( part1 + part2 ).SplatW();
+
+		// compute the least-squares optimal points
+		Vec8 factor = Reciprocal( NegativeMultiplySubtract( alphabeta_sum, alphabeta_sum, alpha2_sum*beta2_sum ) );
+		Vec8 a = NegativeMultiplySubtract( betax_sum, alphabeta_sum, alphax_sum*beta2_sum )*factor;
+		Vec8 b = NegativeMultiplySubtract( alphax_sum, alphabeta_sum, betax_sum*alpha2_sum )*factor;
+
+		// clamp to the grid
+		a = Min( one2, Max( zero2, a ) );
+		b = Min( one2, Max( zero2, b ) );
+		a = Truncate( MultiplyAdd( grid2, a, half2 ) )*gridrcp2;
+		b = Truncate( MultiplyAdd( grid2, b, half2 ) )*gridrcp2;
+		
+		// compute the error (we skip the constant xxsum)
+		Vec8 e1 = MultiplyAdd( a*a, alpha2_sum, b*b*beta2_sum );
+		Vec8 e2 = NegativeMultiplySubtract( a, alphax_sum, a*b*alphabeta_sum );
+		Vec8 e3 = NegativeMultiplySubtract( b, betax_sum, e2 );
+		Vec8 e4 = MultiplyAdd( two2, e3, e1 );
+
+		// apply the metric to the error term
+		Vec8 e5 = e4*metric2;
+		Vec8 error = e5.SplatX() + e5.SplatY() + e5.SplatZ();
+
+		// keep the solutions that win, taking the halves in order
+		if( CompareLessThanMask( error, Vec8( besterror, besterror ) ) != 0 )
+		{
+			if( CompareAnyLessThan( error.Lo(), besterror ) )
+			{
+				beststart = a.Lo();
+				bestend = b.Lo();
+				besterror = error.Lo();
+				besti = i;
+				bestj = j;
+				bestk = k;
+				improved = true;
+			}
+			if( paired && CompareAnyLessThan( error.Hi(), besterror ) )
+			{
+				beststart = a.Hi();
+				bestend = b.Hi();
+				besterror = error.Hi();
+				besti = i2;
+				bestj = j2;
+				bestk = k2;
+				improved = true;
+			}
+			limit = bounds.GetLimit( besterror );
+		}
+	}
+#else
+	for( int n = 0; n < partitionCount; ++n, partitions += 3 )
+	{
+		int const i = partitions[0];
+		int const j = partitions[1];
+		int const k = partitions[2];
+
+		// stop once the first cluster is over, as it only grows from here
+		if( bounds.First( i ) > limit )
+			break;
+		if( bounds.Get( i, j, k ) > limit )
+			continue;
+
+		// the clusters are at the start, one third along, two thirds along and at the end
+		Vec4 const part0 = runs[0][i];
+		Vec4 const part1 = runs[i][j];
+		Vec4 const part2 = runs[j][k];
+		Vec4 const part3 = xsum_wsum - part2 - part1 - part0;
+
+		// compute least squares terms directly
+		Vec4 const alphax_sum = MultiplyAdd( part2, onethird_onethird2, MultiplyAdd( part1, twothirds_twothirds2, part0 ) );
+		Vec4 const alpha2_sum = alphax_sum.SplatW();
+		
+		Vec4 const betax_sum = MultiplyAdd( part1, onethird_onethird2, MultiplyAdd( part2, twothirds_twothirds2, part3 ) );
+		Vec4 const beta2_sum = betax_sum.SplatW();
+		
+		Vec4 const alphabeta_sum = twonineths*( part1 + part2 ).SplatW();
+
+		// compute the least-squares optimal points
+		Vec4 factor = Reciprocal( NegativeMultiplySubtract( alphabeta_sum, alphabeta_sum, alpha2_sum*beta2_sum ) );
+		Vec4 a = NegativeMultiplySubtract( betax_sum, alphabeta_sum, alphax_sum*beta2_sum )*factor;
+		Vec4 b = NegativeMultiplySubtract( alphax_sum, alphabeta_sum, betax_sum*alpha2_sum )*factor;
+
+		// clamp to the grid
+		a = Min( one, Max( zero, a ) );
+		b = Min( one, Max( zero, b ) );
+		a = Truncate( MultiplyAdd( grid, a, half ) )*gridrcp;
+		b = Truncate( MultiplyAdd( grid, b, half ) )*gridrcp;
+		
+		// compute the error (we skip the constant xxsum)
+		Vec4 e1 = MultiplyAdd( a*a, alpha2_sum, b*b*beta2_sum );
+		Vec4 e2 = NegativeMultiplySubtract( a, alphax_sum, a*b*alphabeta_sum );
+		Vec4 e3 = NegativeMultiplySubtract( b, betax_sum, e2 );
+		Vec4 e4 = MultiplyAdd( two, e3, e1 );
+
+		// apply the metric to the error term
+		Vec4 e5 = e4*metric;
+		Vec4 error = e5.SplatX() + e5.SplatY() + e5.SplatZ();
+
+		// keep the solution if it wins
+		if( CompareAnyLessThan( error, besterror ) )
+		{
+			beststart = a;
+			bestend = b;
+			besterror = error;
+			besti = i;
+			bestj = j;
+			bestk = k;
+			improved = true;
+			limit = bounds.GetLimit( besterror );
+		}
+	}
+#endif
+
+	// store the best solution
+	if( improved )
+	{
+		float errors[4];
+		besterror.Store( errors );
+		beststart.Store( search.beststart );
+		bestend.Store( search.bestend );
+		search.besterror = errors[0];
+		search.besti = besti;
+		search.bestj = bestj;
+		search.bestk = bestk;
+	}
+	search.improved = improved;
+}
+
+/*! @brief Sums every run of the ordered integer points.
+
+	The integer sums are exact, so unlike SumRuns the order does not matter.
+*/
+static void SumFixedRuns( int const ( *points_weights )[4], int count, int ( *runs )[17][4] )
+{
+	for( int a = 0; a <= count; ++a )
+	{
+		int sum[4] = { 0, 0, 0, 0 };
+		for( int c = 0; c < 4; ++c )
+			runs[a][a][c] = 0;
+		for( int b = a + 1; b <= count; ++b )
+		{
+			for( int c = 0; c < 4; ++c )
+			{
+				sum[c] += points_weights[b - 1][c];
+				runs[a][b][c] = sum[c];
+			}
+		}
+	}
+}
+
+/*! @brief Rounds factor*num/det from [0,255] to the nearest grid value.
+
+	The factor is 3 when the end points are in thirds and 2 when they are in 
+	halves. Large systems are scaled down so that the rounding stays within 
+	32 bits, which only happens for totals of weight beyond kMaxVectorWeight.
+*/
+static int QuantiseFixed( int num, int det, int factor, int grid )
+{
+	// clamp outside the range first, which also bounds num by det
+	if( num <= 0 )
+		return 0;
+	if( factor*num >= 255*det )
+		return grid;
+
+	// keep the rounding sums below 2^31
+	while( det > 0x7fff )
+	{
+		num >>= 1;
+		det >>= 1;
+	}
+	int const q = ( 2*factor*grid*num + 255*det )/( 510*det );
+	return ( q < grid ) ? q : grid;
+}
+
+//! Expands a 5 or 6 bit grid value to 8 bits as the decoder does.
+static int ExpandFixed( int q, int grid )
+{
+	return ( grid == 31 ) ? ( ( q << 3 ) | ( q >> 2 ) ) : ( ( q << 2 ) | ( q >> 4 ) );
+}
+
+/*! @brief The largest total weight that the vector partition code handles.
+
+	At this weight every sum and product the code packs into 16-bit lanes 
+	fits, and the quotient estimates are well within one of exact.
+*/
+enum { kMaxVectorWeight = 16 };
+
+#if SQUISH_USE_SSE >= 2
+
+//! Sets every 32-bit lane to the 16-bit pair ( lo, hi ) for pmaddwd.
+static __m128i SetPairs( int lo, int hi )
+{
+	return _mm_set1_epi32( ( int )( ( ( unsigned int )lo & 0xffff ) | ( ( unsigned int )hi << 16 ) ) );
+}
+
+//! Packs the low 16 bits of each lo and hi lane pair into one 32-bit lane for pmaddwd.
+static __m128i PackPairs( __m128i lo, __m128i hi )
+{
+	return _mm_or_si128( _mm_and_si128( lo, _mm_set1_epi32( 0xffff ) ), _mm_slli_epi32( hi, 16 ) );
+}
+
+//! Swaps the 16-bit halves of every 32-bit lane.
+static __m128i SwapPairs( __m128i pairs )
+{
+	return _mm_shufflehi_epi16( _mm_shufflelo_epi16( pairs, _MM_SHUFFLE( 2, 3, 0, 1 ) ), _MM_SHUFFLE( 2, 3, 0, 1 ) );
+}
+
+/*! @brief Rounds each lane as QuantiseFixed does, given twice the factor times num.
+
+	The quotient is estimated with a reciprocal then corrected with the exact 
+	integer remainder. The estimate is within one either way, so the result 
+	is the same on every machine even though the reciprocal is not.
+*/
+static __m128i QuantiseFixed( __m128i num, __m128i det, __m128i det255, __m128i det510, __m128 rcp )
+{
+	// multiply by the grid, as 32 - 1 for red and blue and 64 - 1 for green
+	__m128i const num32 = _mm_slli_epi32( num, 5 );
+	__m128i const scaled = _mm_add_epi32( _mm_sub_epi32( num32, num ), _mm_and_si128( num32, _mm_setr_epi32( 0, -1, 0, 0 ) ) );
+	__m128i const total = _mm_add_epi32( scaled, det255 );
+
+	// estimate the quotient, clamped to just outside the grid
+	__m128 estimate = _mm_mul_ps( _mm_cvtepi32_ps( total ), rcp );
+	estimate = _mm_max_ps( estimate, _mm_set1_ps( -1.0f ) );
+	estimate = _mm_min_ps( estimate, _mm_setr_ps( 32.0f, 64.0f, 32.0f, 0.0f ) );
+	__m128i q = _mm_cvttps_epi32( estimate );
+
+	// correct the estimate using the remainder, with 510*q in the low half for pmaddwd
+	__m128i const remainder = _mm_sub_epi32( total, _mm_madd_epi16( det, _mm_mullo_epi16( q, _mm_set1_epi32( 510 ) ) ) );
+	q = _mm_add_epi32( q, _mm_srai_epi32( remainder, 31 ) );
+	q = _mm_sub_epi32( q, _mm_cmpgt_epi32( remainder, _mm_sub_epi32( det510, _mm_set1_epi32( 1 ) ) ) );
+
+	// clamp to the grid
+	q = _mm_max_epi16( q, _mm_setzero_si128() );
+	return _mm_min_epi16( q, _mm_setr_epi32( 31, 63, 31, 0 ) );
+}
+
+//! Expands each 5 or 6 bit lane to 8 bits as the decoder does.
+static __m128i ExpandFixed( __m128i q )
+{
+	return _mm_srli_epi32( _mm_mullo_epi16( q, _mm_setr_epi32( 132, 65, 132, 0 ) ), 4 );
+}
+
+//! Gets n*p - 2*x for each channel of a cluster, with n in the last lane of its sum.
+static __m128i GetFixedClusterTerm( __m128i part, __m128i palette )
+{
+	__m128i const n = _mm_shuffle_epi32( part, _MM_SHUFFLE( 3, 3, 3, 3 ) );
+	return _mm_sub_epi32( _mm_mullo_epi16( n, palette ), _mm_add_epi32( part, part ) );
+}
+
+//! Applies the metric to the per channel errors in the first three lanes.
+static int SumFixedError( __m128i error, int const* metric )
+{
+	int errors[4];
+	_mm_storeu_si128( ( __m128i* )errors, error );
+	return metric[0]*errors[0] + metric[1]*errors[1] + metric[2]*errors[2];
+}
+
+#endif
+
+/*! @brief Gets the end points and exact error of a 3 cluster partition.
+
+	The clusters are at the start, half along and at the end, and the end 
+	points are the least squares fit rounded to the grid. Partitions that
+	are all one cluster have no fit and get the largest error.
+*/
+static int GetFixedError3( FixedClusterFitSearch const& search, int const* part0, int const* part1, int* start, int* end )
+{
+	// get the least squares system in halves
+	int const* total = search.xsum_wsum;
+	int const n0 = part0[3], n1 = part1[3], n2 = total[3] - n0 - n1;
+	int const alpha2 = 4*n0 + n1;
+	int const beta2 = n1 + 4*n2;
+	int const alphabeta = n1;
+	int const det = alpha2*beta2 - alphabeta*alphabeta;
+	if( det == 0 )
+		return INT_MAX;
+
+#if SQUISH_USE_SSE >= 2
+	if( total[3] <= kMaxVectorWeight )
+	{
+		__m128i const x0 = _mm_loadu_si128( ( __m128i const* )part0 );
+		__m128i const x1 = _mm_loadu_si128( ( __m128i const* )part1 );
+		__m128i const x2 = _mm_sub_epi32( _mm_sub_epi32( _mm_loadu_si128( ( __m128i const* )total ), x0 ), x1 );
+
+		// solve for the end points in every channel at once, with the factor of 4 in the pairs
+		__m128i const alphax = _mm_add_epi32( _mm_add_epi32( x0, x0 ), x1 );
+		__m128i const betax = _mm_add_epi32( _mm_add_epi32( x2, x2 ), x1 );
+		__m128i const pairs = PackPairs( alphax, betax );
+		__m128i const numa = _mm_madd_epi16( pairs, SetPairs( 4*beta2, -4*alphabeta ) );
+		__m128i const numb = _mm_madd_epi16( SwapPairs( pairs ), SetPairs( 4*alpha2, -4*alphabeta ) );
+		__m128i const dets = _mm_set1_epi32( det );
+		__m128i const det255 = _mm_set1_epi32( 255*det );
+		__m128i const det510 = _mm_set1_epi32( 510*det );
+		__m128 const rcp = _mm_rcp_ps( _mm_cvtepi32_ps( det510 ) );
+		__m128i const a = QuantiseFixed( numa, dets, det255, det510, rcp );
+		__m128i const b = QuantiseFixed( numb, dets, det255, det510, rcp );
+		_mm_storeu_si128( ( __m128i* )start, a );
+		_mm_storeu_si128( ( __m128i* )end, b );
+
+		// sum the error of each cluster against the decoded palette, two clusters per pmaddwd
+		__m128i const ea = ExpandFixed( a );
+		__m128i const eb = ExpandFixed( b );
+		__m128i const em = _mm_srli_epi32( _mm_add_epi32( ea, eb ), 1 );
+		__m128i const t0 = GetFixedClusterTerm( x0, ea );
+		__m128i const t1 = GetFixedClusterTerm( x1, em );
+		__m128i const t2 = GetFixedClusterTerm( x2, eb );
+		__m128i error = _mm_loadu_si128( ( __m128i const* )search.xxsum );
+		error = _mm_add_epi32( error, _mm_madd_epi16( _mm_or_si128( ea, _mm_slli_epi32( em, 16 ) ), PackPairs( t0, t1 ) ) );
+		error = _mm_add_epi32( error, _mm_madd_epi16( eb, _mm_and_si128( t2, _mm_set1_epi32( 0xffff ) ) ) );
+		return SumFixedError( error, search.metric );
+	}
+#endif
+
+	int error = 0;
+	for( int c = 0; c < 3; ++c )
+	{
+		// solve for the end points of this channel
+		int const grid = ( c == 1 ) ? 63 : 31;
+		int const x0 = part0[c], x1 = part1[c], x2 = total[c] - x0 - x1;
+		int const alphax = 2*x0 + x1;
+		int const betax = x1 + 2*x2;
+		start[c] = QuantiseFixed( alphax*beta2 - betax*alphabeta, det, 2, grid );
+		end[c] = QuantiseFixed( betax*alpha2 - alphax*alphabeta, det, 2, grid );
+
+		// sum the error of each cluster against the decoded palette
+		int const ea = ExpandFixed( start[c], grid );
+		int const eb = ExpandFixed( end[c], grid );
+		int const em = ( ea + eb )/2;
+		int const channel = search.xxsum[c] 
+			+ n0*ea*ea + n1*em*em + n2*eb*eb 
+			- 2*( ea*x0 + em*x1 + eb*x2 );
+		error += search.metric[c]*channel;
+	}
+	return error;
+}
+
+/*! @brief Gets the end points and exact error of a 4 cluster partition.
+
+	The clusters are at the start, a third along, two thirds along and at 
+	the end, otherwise as GetFixedError3.
+*/
+static int GetFixedError4( FixedClusterFitSearch const& search, int const* part0, int const* part1, int const* part2, int* start, int* end )
+{
+	// get the least squares system in thirds
+	int const* total = search.xsum_wsum;
+	int const n0 = part0[3], n1 = part1[3], n2 = part2[3], n3 = total[3] - n0 - n1 - n2;
+	int const alpha2 = 9*n0 + 4*n1 + n2;
+	int const beta2 = n1 + 4*n2 + 9*n3;
+	int const alphabeta = 2*( n1 + n2 );
+	int const det = alpha2*beta2 - alphabeta*alphabeta;
+	if( det == 0 )
+		return INT_MAX;
+
+#if SQUISH_USE_SSE >= 2
+	if( total[3] <= kMaxVectorWeight )
+	{
+		__m128i const x0 = _mm_loadu_si128( ( __m128i const* )part0 );
+		__m128i const x1 = _mm_loadu_si128( ( __m128i const* )part1 );
+		__m128i const x2 = _mm_loadu_si128( ( __m128i const* )part2 );
+		__m128i const x3 = _mm_sub_epi32( _mm_sub_epi32( _mm_sub_epi32( _mm_loadu_si128( ( __m128i const* )total ), x0 ), x1 ), x2 );
+
+		// solve for the end points in every channel at once, with the factor of 6 in the pairs
+		__m128i const alphax = _mm_add_epi32( _mm_add_epi32( _mm_add_epi32( x0, x0 ), _mm_add_epi32( x0, x1 ) ), _mm_add_epi32( x1, x2 ) );
+		__m128i const betax = _mm_add_epi32( _mm_add_epi32( _mm_add_epi32( x3, x3 ), _mm_add_epi32( x3, x2 ) ), _mm_add_epi32( x2, x1 ) );
+		__m128i const pairs = PackPairs( alphax, betax );
+		__m128i const numa = _mm_madd_epi16( pairs, SetPairs( 6*beta2, -6*alphabeta ) );
+		__m128i const numb = _mm_madd_epi16( SwapPairs( pairs ), SetPairs( 6*alpha2, -6*alphabeta ) );
+		__m128i const dets = _mm_set1_epi32( det );
+		__m128i const det255 = _mm_set1_epi32( 255*det );
+		__m128i const det510 = _mm_set1_epi32( 510*det );
+		__m128 const rcp = _mm_rcp_ps( _mm_cvtepi32_ps( det510 ) );
+		__m128i const a = QuantiseFixed( numa, dets, det255, det510, rcp );
+		__m128i const b = QuantiseFixed( numb, dets, det255, det510, rcp );
+		_mm_storeu_si128( ( __m128i* )start, a );
+		_mm_storeu_si128( ( __m128i* )end, b );
+
+		// sum the error of each cluster against the decoded palette, dividing by 3 as 21846/65536
+		__m128i const third = _mm_set1_epi32( 21846 );
+		__m128i const ea = ExpandFixed( a );
+		__m128i const eb = ExpandFixed( b );
+		__m128i const e1 = _mm_mulhi_epu16( _mm_add_epi32( _mm_add_epi32( ea, ea ), eb ), third );
+		__m128i const e2 = _mm_mulhi_epu16( _mm_add_epi32( _mm_add_epi32( eb, eb ), ea ), third );
+		__m128i const t0 = GetFixedClusterTerm( x0, ea );
+		__m128i const t1 = GetFixedClusterTerm( x1, e1 );
+		__m128i const t2 = GetFixedClusterTerm( x2, e2 );
+		__m128i const t3 = GetFixedClusterTerm( x3, eb );
+		__m128i error = _mm_loadu_si128( ( __m128i const* )search.xxsum );
+		error = _mm_add_epi32( error, _mm_madd_epi16( _mm_or_si128( ea, _mm_slli_epi32( e1, 16 ) ), PackPairs( t0, t1 ) ) );
+		error = _mm_add_epi32( error, _mm_madd_epi16( _mm_or_si128( e2, _mm_slli_epi32( eb, 16 ) ), PackPairs( t2, t3 ) ) );
+		return SumFixedError( error, search.metric );
+	}
+#endif
+
+	int error = 0;
+	for( int c = 0; c < 3; ++c )
+	{
+		// solve for the end points of this channel
+		int const grid = ( c == 1 ) ? 63 : 31;
+		int const x0 = part0[c], x1 = part1[c], x2 = part2[c], x3 = total[c] - x0 - x1 - x2;
+		int const alphax = 3*x0 + 2*x1 + x2;
+		int const betax = x1 + 2*x2 + 3*x3;
+		start[c] = QuantiseFixed( alphax*beta2 - betax*alphabeta, det, 3, grid );
+		end[c] = QuantiseFixed( betax*alpha2 - alphax*alphabeta, det, 3, grid );
+
+		// sum the error of each cluster against the decoded palette
+		int const ea = ExpandFixed( start[c], grid );
+		int const eb = ExpandFixed( end[c], grid );
+		int const e1 = ( 2*ea + eb )/3;
+		int const e2 = ( ea + 2*eb )/3;
+		int const channel = search.xxsum[c] 
+			+ n0*ea*ea + n1*e1*e1 + n2*e2*e2 + n3*eb*eb 
+			- 2*( ea*x0 + e1*x1 + e2*x2 + eb*x3 );
+		error += search.metric[c]*channel;
+	}
+	return error;
+}
+
+static void FixedClusterFitSearch3( FixedClusterFitSearch& search )
+{
+	// sum the runs of the ordered points
+	int const count = search.count;
+	int runs[17][17][4];
+	SumFixedRuns( search.points_weights, count, runs );
+
+	// get the bounds for skipping the partitions that cannot win
+	ClusterBounds const bounds( search );
+	double limit = bounds.GetLimit( search.besterror );
+	bool improved = false;
+
+	// sweep the partitions [0,i) [i,j) [j,count) in order
+	int partitionCount;
+	u8 const* partitions = GetClusterPartitions3( count, partitionCount );
+	for( int n = 0; n < partitionCount; ++n, partitions += 2 )
+	{
+		int const i = partitions[0];
+		int const j = partitions[1];
+
+		// stop once the first cluster is over, as it only grows from here
+		if( bounds.First( i ) > limit )
+			break;
+		if( bounds.Get( i, j ) > limit )
+			continue;
+
+		// keep the solution if it wins
+		int start[4], end[4];
+		int const error = GetFixedError3( search, runs[0][i], runs[i][j], start, end );
+		if( error < search.besterror )
+		{
+			for( int c = 0; c < 3; ++c )
+			{
+				search.beststart[c] = start[c];
+				search.bestend[c] = end[c];
+			}
+			search.besterror = error;
+			search.besti = i;
+			search.bestj = j;
+			improved = true;
+			limit = bounds.GetLimit( error );
+		}
+	}
+	search.improved = improved;
+}
+
+static void FixedClusterFitSearch4( FixedClusterFitSearch& search )
+{
+	// sum the runs of the ordered points
+	int const count = search.count;
+	int runs[17][17][4];
+	SumFixedRuns( search.points_weights, count, runs );
+
+	// get the bounds for skipping the partitions that cannot win
+	ClusterBounds const bounds( search );
+	double limit = bounds.GetLimit( search.besterror );
+	bool improved = false;
+
+	// sweep the partitions [0,i) [i,j) [j,k) [k,count) in order
+	int partitionCount;
+	u8 const* partitions = GetClusterPartitions4( count, partitionCount );
+	for( int n = 0; n < partitionCount; ++n, partitions += 3 )
+	{
+		int const i = partitions[0];
+		int const j = partitions[1];
+		int const k = partitions[2];
+
+		// stop once the first cluster is over, as it only grows from here
+		if( bounds.First( i ) > limit )
+			break;
+		if( bounds.Get( i, j, k ) > limit )
+			continue;
+
+		// keep the solution if it wins
+		int start[4], end[4];
+		int const error = GetFixedError4( search, runs[0][i], runs[i][j], runs[j][k], start, end );
+		if( error < search.besterror )
+		{
+			for( int c = 0; c < 3; ++c )
+			{
+				search.beststart[c] = start[c];
+				search.bestend[c] = end[c];
+			}
+			search.besterror = error;
+			search.besti = i;
+			search.bestj = j;
+			search.bestk = k;
+			improved = true;
+			limit = bounds.GetLimit( error );
+		}
+	}
+	search.improved = improved;
+}
+
+#if SQUISH_USE_SSE >= 2
+
+static void MatchColours( u8 const* rgba, int valid, int* firsts )
+{
+	// the lowest bit of a power of two by de Bruijn multiplication
+	static int const lowest[32] = {
+		0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8, 
+		31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+	};
+
+	// load the colours without alpha
+	__m128i const colour = _mm_set1_epi32( 0x00ffffff );
+	__m128i quads[4];
+	for( int i = 0; i < 4; ++i )
+		quads[i] = _mm_and_si128( _mm_loadu_si128( ( __m128i const* )( rgba + 16*i ) ), colour );
+
+	// compare each pixel against all 16 at once, and take the first valid match
+	for( int i = 0; i < 4; ++i )
+	{
+		__m128i const pixels[4] = {
+			_mm_shuffle_epi32( quads[i], _MM_SHUFFLE( 0, 0, 0, 0 ) ), 
+			_mm_shuffle_epi32( quads[i], _MM_SHUFFLE( 1, 1, 1, 1 ) ), 
+			_mm_shuffle_epi32( quads[i], _MM_SHUFFLE( 2, 2, 2, 2 ) ), 
+			_mm_shuffle_epi32( quads[i], _MM_SHUFFLE( 3, 3, 3, 3 ) )
+		};
+		for( int j = 0; j < 4; ++j )
+		{
+			__m128i const lo = _mm_packs_epi32( _mm_cmpeq_epi32( pixels[j], quads[0] ), _mm_cmpeq_epi32( pixels[j], quads[1] ) );
+			__m128i const hi = _mm_packs_epi32( _mm_cmpeq_epi32( pixels[j], quads[2] ), _mm_cmpeq_epi32( pixels[j], quads[3] ) );
+			unsigned int const matches = ( unsigned int )( _mm_movemask_epi8( _mm_packs_epi16( lo, hi ) ) & valid ) | ( 1u << ( 4*i + j ) );
+			firsts[4*i + j] = lowest[( ( matches & ( 0u - matches ) )*0x077cb531u ) >> 27];
+		}
+	}
+}
+
+static void UnpackColours( u8 const* bytes, int const* weights, int count, float weightScale, float* points, float* roots )
+{
+	// the division and root are exact in every lane, so this matches the scalar code
+	__m128i const zero = _mm_setzero_si128();
+	__m128 const unit = _mm_set1_ps( 255.0f );
+	__m128 const scale = _mm_set1_ps( weightScale );
+	for( int i = 0; i < count; i += 4 )
+	{
+		__m128i const quad = _mm_loadu_si128( ( __m128i const* )( bytes + 4*i ) );
+		__m128i const lo = _mm_unpacklo_epi8( quad, zero );
+		__m128i const hi = _mm_unpackhi_epi8( quad, zero );
+		_mm_storeu_ps( points + 4*i, _mm_div_ps( _mm_cvtepi32_ps( _mm_unpacklo_epi16( lo, zero ) ), unit ) );
+		_mm_storeu_ps( points + 4*i + 4, _mm_div_ps( _mm_cvtepi32_ps( _mm_unpackhi_epi16( lo, zero ) ), unit ) );
+		_mm_storeu_ps( points + 4*i + 8, _mm_div_ps( _mm_cvtepi32_ps( _mm_unpacklo_epi16( hi, zero ) ), unit ) );
+		_mm_storeu_ps( points + 4*i + 12, _mm_div_ps( _mm_cvtepi32_ps( _mm_unpackhi_epi16( hi, zero ) ), unit ) );
+
+		__m128 const weight = _mm_cvtepi32_ps( _mm_loadu_si128( ( __m128i const* )( weights + i ) ) );
+		_mm_storeu_ps( roots + i, _mm_sqrt_ps( _mm_mul_ps( weight, scale ) ) );
+	}
+}
+
+static bool GetSolidColour( u8 const* rgba, int mask, u8* colour )
+{
+	// find the first valid pixel
+	mask &= 0xffff;
+	if( mask == 0 )
+		return false;
+	int first = 0;
+	while( ( mask & ( 1 << first ) ) == 0 )
+		++first;
+	int value;
+	std::memcpy( &value, rgba + 4*first, 4 );
+
+	// compare all 16 pixels with it
+	int same;
+#if SQUISH_USE_AVX
+	__m256i const target = _mm256_set1_epi32( value );
+	__m256i const lo = _mm256_cmpeq_epi32( _mm256_loadu_si256( ( __m256i const* )rgba ), target );
+	__m256i const hi = _mm256_cmpeq_epi32( _mm256_loadu_si256( ( __m256i const* )( rgba + 32 ) ), target );
+	same = _mm256_movemask_ps( _mm256_castsi256_ps( lo ) ) | ( _mm256_movemask_ps( _mm256_castsi256_ps( hi ) ) << 8 );
+#else
+	__m128i const target = _mm_set1_epi32( value );
+	same = 0;
+	for( int i = 0; i < 4; ++i )
+	{
+		__m128i const quad = _mm_loadu_si128( ( __m128i const* )( rgba + 16*i ) );
+		same |= _mm_movemask_ps( _mm_castsi128_ps( _mm_cmpeq_epi32( quad, target ) ) ) << 4*i;
+	}
+#endif
+	if( ( same & mask ) != mask )
+		return false;
+	std::memcpy( colour, &value, 4 );
+	return true;
+}
+
+static int MatchPixels( u8 const* pixels, int count, u8 const* colour )
+{
+	int value;
+	std::memcpy( &value, colour, 4 );
+	int i = 0;
+#if SQUISH_USE_AVX
+	// compare 8 pixels at a time
+	__m256i const target8 = _mm256_set1_epi32( value );
+	for( ; i + 8 <= count; i += 8 )
+	{
+		__m256i const same = _mm256_cmpeq_epi32( _mm256_loadu_si256( ( __m256i const* )( pixels + 4*i ) ), target8 );
+		if( _mm256_movemask_ps( _mm256_castsi256_ps( same ) ) != 0xff )
+			break;
+	}
+#endif
+
+	// compare 4 pixels at a time
+	__m128i const target = _mm_set1_epi32( value );
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128i const same = _mm_cmpeq_epi32( _mm_loadu_si128( ( __m128i const* )( pixels + 4*i ) ), target );
+		if( _mm_movemask_ps( _mm_castsi128_ps( same ) ) != 0xf )
+			break;
+	}
+
+	// then find the first pixel that differs
+	for( ; i < count; ++i )
+	{
+		if( std::memcmp( pixels + 4*i, colour, 4 ) != 0 )
+			break;
+	}
+	return i;
+}
+
+#else
+
+static void MatchColours( u8 const* rgba, int valid, int* firsts )
+{
+	// compare each valid pixel against the first pixels of the colours so far
+	int colours[16];
+	int pixels[16];
+	int count = 0;
+	for( int i = 0; i < 16; ++i )
+	{
+		int const value = rgba[4*i] | ( rgba[4*i + 1] << 8 ) | ( rgba[4*i + 2] << 16 );
+		firsts[i] = i;
+		if( ( valid & ( 1 << i ) ) == 0 )
+			continue;
+		int j = 0;
+		while( j < count && colours[j] != value )
+			++j;
+		if( j == count )
+		{
+			colours[count] = value;
+			pixels[count++] = i;
+		}
+		else
+			firsts[i] = pixels[j];
+	}
+}
+
+static void UnpackColours( u8 const* bytes, int const* weights, int count, float weightScale, float* points, float* roots )
+{
+	for( int i = 0; i < count; ++i )
+	{
+		for( int c = 0; c < 4; ++c )
+			points[4*i + c] = ( float )bytes[4*i + c] / 255.0f;
+		roots[i] = std::sqrt( ( float )weights[i]*weightScale );
+	}
+}
+
+static bool GetSolidColour( u8 const* rgba, int mask, u8* colour )
+{
+	// compare every valid pixel with the first one
+	int first = -1;
+	for( int i = 0; i < 16; ++i )
+	{
+		if( ( mask & ( 1 << i ) ) == 0 )
+			continue;
+		if( first < 0 )
+			first = i;
+		else if( std::memcmp( rgba + 4*i, rgba + 4*first, 4 ) != 0 )
+			return false;
+	}
+	if( first < 0 )
+		return false;
+	std::memcpy( colour, rgba + 4*first, 4 );
+	return true;
+}
+
+static int MatchPixels( u8 const* pixels, int count, u8 const* colour )
+{
+	int i = 0;
+	while( i < count && std::memcmp( pixels + 4*i, colour, 4 ) == 0 )
+		++i;
+	return i;
+}
+
+#endif
+
+#if SQUISH_USE_SSE >= 2
+
+static int GetFastIndices( u8 const* rgba, int valid, u8 const* palette, int paletteCount, u8* indices )
+{
+	// widen the pixels to 16 bits without their alpha, two pixels per register
+	__m128i const zero = _mm_setzero_si128();
+	__m128i pixels[8];
+	for( int i = 0; i < 4; ++i )
+	{
+		__m128i const quad = _mm_and_si128( _mm_loadu_si128( ( __m128i const* )( rgba + 16*i ) ), _mm_set1_epi32( 0x00ffffff ) );
+		pixels[2*i] = _mm_unpacklo_epi8( quad, zero );
+		pixels[2*i + 1] = _mm_unpackhi_epi8( quad, zero );
+	}
+
+	// keep the first nearest entry of each pixel, four pixels per register
+	__m128i best[4];
+	__m128i index[4];
+	for( int k = 0; k < paletteCount; ++k )
+	{
+		int entry;
+		std::memcpy( &entry, palette + 4*k, 4 );
+		__m128i const colour = _mm_unpacklo_epi8( _mm_set1_epi32( entry ), zero );
+		__m128i const code = _mm_set1_epi32( k );
+		for( int i = 0; i < 4; ++i )
+		{
+			// get the squared distances as r^2 + g^2 and b^2 per pixel, then add the halves
+			__m128i const d0 = _mm_sub_epi16( pixels[2*i], colour );
+			__m128i const d1 = _mm_sub_epi16( pixels[2*i + 1], colour );
+			__m128 const s0 = _mm_castsi128_ps( _mm_madd_epi16( d0, d0 ) );
+			__m128 const s1 = _mm_castsi128_ps( _mm_madd_epi16( d1, d1 ) );
+			__m128i const distance = _mm_add_epi32( 
+				_mm_castps_si128( _mm_shuffle_ps( s0, s1, _MM_SHUFFLE( 2, 0, 2, 0 ) ) ), 
+				_mm_castps_si128( _mm_shuffle_ps( s0, s1, _MM_SHUFFLE( 3, 1, 3, 1 ) ) ) 
+			);
+			if( k == 0 )
+			{
+				best[i] = distance;
+				index[i] = zero;
+				continue;
+			}
+			__m128i const closer = _mm_cmplt_epi32( distance, best[i] );
+			best[i] = _mm_or_si128( _mm_and_si128( closer, distance ), _mm_andnot_si128( closer, best[i] ) );
+			index[i] = _mm_or_si128( _mm_and_si128( closer, code ), _mm_andnot_si128( closer, index[i] ) );
+		}
+	}
+
+	// narrow the indices to bytes
+	__m128i const packed = _mm_packus_epi16( _mm_packs_epi32( index[0], index[1] ), _mm_packs_epi32( index[2], index[3] ) );
+	_mm_storeu_si128( ( __m128i* )indices, packed );
+
+	// sum the distances of the valid pixels
+	__m128i const bits = _mm_setr_epi32( 1, 2, 4, 8 );
+	__m128i error = zero;
+	for( int i = 0; i < 4; ++i )
+	{
+		__m128i const select = _mm_cmpeq_epi32( _mm_and_si128( _mm_set1_epi32( valid >> 4*i ), bits ), bits );
+		error = _mm_add_epi32( error, _mm_and_si128( select, best[i] ) );
+	}
+	error = _mm_add_epi32( error, _mm_shuffle_epi32( error, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+	error = _mm_add_epi32( error, _mm_shuffle_epi32( error, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+	return _mm_cvtsi128_si32( error );
+}
+
+static int GetFastBox( u8 const* rgba, int valid, u8* low, u8* high )
+{
+	// take the valid pixels into the box, and get the alpha bits as the opaque pixels
+	__m128i const bits = _mm_setr_epi32( 1, 2, 4, 8 );
+	__m128i const ones = _mm_set1_epi32( -1 );
+	__m128i lo = ones;
+	__m128i hi = _mm_setzero_si128();
+	int opaque = 0;
+	for( int i = 0; i < 4; ++i )
+	{
+		__m128i const quad = _mm_loadu_si128( ( __m128i const* )( rgba + 16*i ) );
+		__m128i const select = _mm_cmpeq_epi32( _mm_and_si128( _mm_set1_epi32( valid >> 4*i ), bits ), bits );
+		lo = _mm_min_epu8( lo, _mm_or_si128( quad, _mm_andnot_si128( select, ones ) ) );
+		hi = _mm_max_epu8( hi, _mm_and_si128( quad, select ) );
+		opaque |= _mm_movemask_ps( _mm_castsi128_ps( quad ) ) << 4*i;
+	}
+
+	// reduce the lanes
+	lo = _mm_min_epu8( lo, _mm_shuffle_epi32( lo, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+	lo = _mm_min_epu8( lo, _mm_shuffle_epi32( lo, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+	hi = _mm_max_epu8( hi, _mm_shuffle_epi32( hi, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+	hi = _mm_max_epu8( hi, _mm_shuffle_epi32( hi, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+	int const lowBytes = _mm_cvtsi128_si32( lo );
+	int const highBytes = _mm_cvtsi128_si32( hi );
+	std::memcpy( low, &lowBytes, 4 );
+	std::memcpy( high, &highBytes, 4 );
+	return opaque;
+}
+
+//! Sets each byte where the bit of the mask for that pixel is set.
+static __m128i GetValidBytes( int mask )
+{
+	__m128i const bits = _mm_setr_epi8( 1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128 );
+	__m128i const bytes = _mm_unpacklo_epi64( _mm_set1_epi8( ( char )mask ), _mm_set1_epi8( ( char )( mask >> 8 ) ) );
+	return _mm_cmpeq_epi8( _mm_and_si128( bytes, bits ), bits );
+}
+
+static int GetMinByte( __m128i bytes )
+{
+	bytes = _mm_min_epu8( bytes, _mm_srli_si128( bytes, 8 ) );
+	bytes = _mm_min_epu8( bytes, _mm_srli_si128( bytes, 4 ) );
+	bytes = _mm_min_epu8( bytes, _mm_srli_si128( bytes, 2 ) );
+	bytes = _mm_min_epu8( bytes, _mm_srli_si128( bytes, 1 ) );
+	return _mm_cvtsi128_si32( bytes ) & 0xff;
+}
+
+static int GetMaxByte( __m128i bytes )
+{
+	bytes = _mm_max_epu8( bytes, _mm_srli_si128( bytes, 8 ) );
+	bytes = _mm_max_epu8( bytes, _mm_srli_si128( bytes, 4 ) );
+	bytes = _mm_max_epu8( bytes, _mm_srli_si128( bytes, 2 ) );
+	bytes = _mm_max_epu8( bytes, _mm_srli_si128( bytes, 1 ) );
+	return _mm_cvtsi128_si32( bytes ) & 0xff;
+}
+
+static void GetAlphaRanges( u8 const* rgba, int mask, u8* alphas, int* ranges )
+{
+	// gather the alpha values into bytes
+	__m128i quads[4];
+	for( int i = 0; i < 4; ++i )
+		quads[i] = _mm_srli_epi32( _mm_loadu_si128( ( __m128i const* )( rgba + 16*i ) ), 24 );
+	__m128i const values = _mm_packus_epi16( _mm_packs_epi32( quads[0], quads[1] ), _mm_packs_epi32( quads[2], quads[3] ) );
+	_mm_storeu_si128( ( __m128i* )alphas, values );
+
+	// push the masked values out of the ranges, and 0 and 255 out of the 5-alpha range
+	__m128i const zero = _mm_setzero_si128();
+	__m128i const ones = _mm_cmpeq_epi8( zero, zero );
+	__m128i const valid = GetValidBytes( mask );
+	__m128i const low = _mm_or_si128( values, _mm_andnot_si128( valid, ones ) );
+	__m128i const high = _mm_and_si128( values, valid );
+	ranges[0] = GetMinByte( _mm_or_si128( low, _mm_cmpeq_epi8( values, zero ) ) );
+	ranges[1] = GetMaxByte( _mm_andnot_si128( _mm_cmpeq_epi8( values, ones ), high ) );
+	ranges[2] = GetMinByte( low );
+	ranges[3] = GetMaxByte( high );
+}
+
+static int FitAlphaCodes( u8 const* alphas, int mask, u8 const* codes, u8* indices )
+{
+	// keep the first nearest code of each pixel, all 16 pixels at once
+	__m128i const values = _mm_loadu_si128( ( __m128i const* )alphas );
+	__m128i const zero = _mm_setzero_si128();
+	__m128i const ones = _mm_cmpeq_epi8( zero, zero );
+	__m128i best = ones;
+	__m128i index = zero;
+	for( int k = 0; k < 8; ++k )
+	{
+		__m128i const code = _mm_set1_epi8( ( char )codes[k] );
+		__m128i const distance = _mm_or_si128( _mm_subs_epu8( values, code ), _mm_subs_epu8( code, values ) );
+		__m128i const closer = _mm_xor_si128( _mm_cmpeq_epi8( _mm_subs_epu8( best, distance ), zero ), ones );
+		best = _mm_min_epu8( best, distance );
+		index = _mm_or_si128( _mm_and_si128( closer, _mm_set1_epi8( ( char )k ) ), _mm_andnot_si128( closer, index ) );
+	}
+
+	// masked pixels use the first code and add no error
+	__m128i const valid = GetValidBytes( mask );
+	_mm_storeu_si128( ( __m128i* )indices, _mm_and_si128( index, valid ) );
+	best = _mm_and_si128( best, valid );
+
+	// sum the squared errors
+	__m128i const lo = _mm_unpacklo_epi8( best, zero );
+	__m128i const hi = _mm_unpackhi_epi8( best, zero );
+	__m128i sums = _mm_add_epi32( _mm_madd_epi16( lo, lo ), _mm_madd_epi16( hi, hi ) );
+	sums = _mm_add_epi32( sums, _mm_shuffle_epi32( sums, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+	sums = _mm_add_epi32( sums, _mm_shuffle_epi32( sums, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+	return _mm_cvtsi128_si32( sums );
+}
+
+#else
+
+static int GetFastIndices( u8 const* rgba, int valid, u8 const* palette, int paletteCount, u8* indices )
+{
+	int error = 0;
+	for( int i = 0; i < 16; ++i )
+	{
+		// keep the first nearest entry by squared distance
+		u8 const* pixel = rgba + 4*i;
+		int best = INT_MAX;
+		int index = 0;
+		for( int k = 0; k < paletteCount; ++k )
+		{
+			u8 const* colour = palette + 4*k;
+			int distance = 0;
+			for( int c = 0; c < 3; ++c )
+				distance += ( pixel[c] - colour[c] )*( pixel[c] - colour[c] );
+			if( distance < best )
+			{
+				best = distance;
+				index = k;
+			}
+		}
+		indices[i] = ( u8 )index;
+
+		// sum the distances of the valid pixels
+		if( ( valid & ( 1 << i ) ) != 0 )
+			error += best;
+	}
+	return error;
+}
+
+static int GetFastBox( u8 const* rgba, int valid, u8* low, u8* high )
+{
+	// take the valid pixels into the box, and get the alpha bits as the opaque pixels
+	int opaque = 0;
+	for( int c = 0; c < 4; ++c )
+	{
+		low[c] = 255;
+		high[c] = 0;
+	}
+	for( int i = 0; i < 16; ++i )
+	{
+		u8 const* pixel = rgba + 4*i;
+		if( ( valid & ( 1 << i ) ) != 0 )
+		{
+			for( int c = 0; c < 4; ++c )
+			{
+				low[c] = std::min( low[c], pixel[c] );
+				high[c] = std::max( high[c], pixel[c] );
+			}
+		}
+		if( pixel[3] >= 128 )
+			opaque |= 1 << i;
+	}
+	return opaque;
+}
+
+static void GetAlphaRanges( u8 const* rgba, int mask, u8* alphas, int* ranges )
+{
+	// get the range for 5-alpha and 7-alpha interpolation
+	ranges[0] = ranges[2] = 255;
+	ranges[1] = ranges[3] = 0;
+	for( int i = 0; i < 16; ++i )
+	{
+		// check this pixel is valid
+		int const value = rgba[4*i + 3];
+		alphas[i] = ( u8 )value;
+		if( ( mask & ( 1 << i ) ) == 0 )
+			continue;
+
+		// incorporate into the min/max
+		ranges[2] = std::min( ranges[2], value );
+		ranges[3] = std::max( ranges[3], value );
+		if( value != 0 )
+			ranges[0] = std::min( ranges[0], value );
+		if( value != 255 )
+			ranges[1] = std::max( ranges[1], value );
+	}
+}
+
+static int FitAlphaCodes( u8 const* alphas, int mask, u8 const* codes, u8* indices )
+{
+	// fit each alpha value to the codebook
+	int error = 0;
+	for( int i = 0; i < 16; ++i )
+	{
+		// masked pixels use the first code and add no error
+		if( ( mask & ( 1 << i ) ) == 0 )
+		{
+			indices[i] = 0;
+			continue;
+		}
+
+		// keep the first nearest code
+		int const value = alphas[i];
+		int least = INT_MAX;
+		int index = 0;
+		for( int k = 0; k < 8; ++k )
+		{
+			int const distance = ( value - codes[k] )*( value - codes[k] );
+			if( distance < least )
+			{
+				least = distance;
+				index = k;
+			}
+		}
+		indices[i] = ( u8 )index;
+		error += least;
+	}
+	return error;
+}
+
+#endif
+
+//! Expands a 5:6:5 colour to bytes as the decoder does.
+static void UnpackFast565( int value, u8* colour )
+{
+	int const r = ( value >> 11 ) & 0x1f;
+	int const g = ( value >> 5 ) & 0x3f;
+	int const b = value & 0x1f;
+	colour[0] = ( u8 )( ( r << 3 ) | ( r >> 2 ) );
+	colour[1] = ( u8 )( ( g << 2 ) | ( g >> 4 ) );
+	colour[2] = ( u8 )( ( b << 3 ) | ( b >> 2 ) );
+}
+
+/*! @brief Gets the end points and palette of the fast fit of a block.
+
+	The end points are the corners of the bounding box of the valid pixels,
+	inset by a 16th of its size to pull them in off outliers. They are 
+	ordered for the three colour mode when it is needed for transparency. 
+	Returns the number of palette entries to choose from, which is 1 when 
+	both end points are the same colour.
+*/
+static int GetFastPalette( u8 const* low, u8 const* high, bool threeColour, int* endPoints, u8* palette )
+{
+	// inset the box and round the corners to the grid
+	int const grid[3] = { 31, 63, 31 };
+	int const shift[3] = { 11, 5, 0 };
+	int a = 0;
+	int b = 0;
+	for( int c = 0; c < 3; ++c )
+	{
+		int const inset = ( high[c] - low[c] ) >> 4;
+		a |= ( ( grid[c]*( high[c] - inset ) + 127 )/255 ) << shift[c];
+		b |= ( ( grid[c]*( low[c] + inset ) + 127 )/255 ) << shift[c];
+	}
+
+	// the four colour mode needs the larger end point first and the three colour mode the smaller
+	if( threeColour ? ( a > b ) : ( a < b ) )
+		std::swap( a, b );
+	endPoints[0] = a;
+	endPoints[1] = b;
+
+	// build the palette as the decoder does, with zero alphas for the vector distances
+	std::memset( palette, 0, 16 );
+	UnpackFast565( a, palette );
+	UnpackFast565( b, palette + 4 );
+	if( a == b )
+		return 1;
+	for( int c = 0; c < 3; ++c )
+	{
+		int const x = palette[c];
+		int const y = palette[4 + c];
+		if( threeColour )
+			palette[8 + c] = ( u8 )( ( x + y )/2 );
+		else
+		{
+			palette[8 + c] = ( u8 )( ( 2*x + y )/3 );
+			palette[12 + c] = ( u8 )( ( x + 2*y )/3 );
+		}
+	}
+	return threeColour ? 3 : 4;
+}
+
+static void FastFitColours( u8 const* rgba, int const* masks, int count, bool dxt1, u8* blocks, int stride, int* errors )
+{
+	for( int n = 0; n < count; ++n, rgba += 64, blocks += stride )
+	{
+		// leave out the masked pixels, and the transparent ones when using dxt1
+		int valid = masks[n] & 0xffff;
+		int transparent = 0;
+		u8 low[4];
+		u8 high[4];
+		int const opaque = GetFastBox( rgba, valid, low, high );
+		if( dxt1 && ( valid & ~opaque ) != 0 )
+		{
+			transparent = valid & ~opaque;
+			valid &= opaque;
+			GetFastBox( rgba, valid, low, high );
+		}
+		if( valid == 0 )
+		{
+			for( int c = 0; c < 4; ++c )
+				low[c] = high[c] = 0;
+		}
+
+		// fit the palette and pick the nearest entry for every pixel
+		int endPoints[2];
+		u8 palette[4*4];
+		int const paletteCount = GetFastPalette( low, high, transparent != 0, endPoints, palette );
+		u8 indices[16];
+		int const error = GetFastIndices( rgba, valid, palette, paletteCount, indices );
+		if( errors != NULL )
+			errors[n] = error;
+		for( int i = 0; transparent != 0 && i < 16; ++i )
+		{
+			if( ( transparent & ( 1 << i ) ) != 0 )
+				indices[i] = 3;
+		}
+
+		// write the end points and the indices with 2 bits each
+		blocks[0] = ( u8 )( endPoints[0] & 0xff );
+		blocks[1] = ( u8 )( endPoints[0] >> 8 );
+		blocks[2] = ( u8 )( endPoints[1] & 0xff );
+		blocks[3] = ( u8 )( endPoints[1] >> 8 );
+		for( int i = 0; i < 4; ++i )
+		{
+			u8 const* row = indices + 4*i;
+			blocks[4 + i] = ( u8 )( row[0] | ( row[1] << 2 ) | ( row[2] << 4 ) | ( row[3] << 6 ) );
+		}
+	}
+}
+
+static void FastFitAlphas( u8 const* rgba, int const* masks, int count, u8* blocks, int stride )
+{
+	for( int n = 0; n < count; ++n, rgba += 64, blocks += stride )
+	{
+		// get the range of the valid alpha values
+		u8 alphas[16];
+		int ranges[4];
+		GetAlphaRanges( rgba, masks[n], alphas, ranges );
+		int const lo = ( ranges[2] <= ranges[3] ) ? ranges[2] : 0;
+		int const hi = ( ranges[2] <= ranges[3] ) ? ranges[3] : 0;
+
+		// use the 8 code mode, which has the larger end point first
+		u8 codes[8];
+		codes[0] = ( u8 )hi;
+		codes[1] = ( u8 )lo;
+		for( int i = 1; i < 7; ++i )
+			codes[1 + i] = ( u8 )( ( ( 7 - i )*hi + i*lo )/7 );
+		u8 indices[16];
+		FitAlphaCodes( alphas, masks[n], codes, indices );
+
+		// write the end points and the indices with 3 bits each
+		blocks[0] = ( u8 )hi;
+		blocks[1] = ( u8 )lo;
+		for( int i = 0; i < 2; ++i )
+		{
+			int value = 0;
+			for( int j = 0; j < 8; ++j )
+				value |= indices[8*i + j] << 3*j;
+			for( int j = 0; j < 3; ++j )
+				blocks[2 + 3*i + j] = ( u8 )( value >> 8*j );
+		}
+	}
+}
+
+// the alpha refinement rarely improves after a few passes
+enum { kAlphaRefinePasses = 4 };
+
+//! Divides rounding to the nearest, for a positive denominator.
+static int DivideRounded( int numerator, int denominator )
+{
+	if( numerator < 0 )
+		return -( ( denominator/2 - numerator )/denominator );
+	return ( numerator + denominator/2 )/denominator;
+}
+
+/*! @brief Refines the end points of a DXT5 alpha code book by least squares.
+
+	Each pass solves for the end points that best fit the values with the
+	current indices, leaving out the fixed 0 and 255 codes, then fits the 
+	indices to the new code book. It stops once the error does not fall.
+*/
+static int RefineAlphaCodes( u8 const* alphas, int mask, int steps, u8* codes, u8* indices, int error )
+{
+	for( int pass = 0; pass < kAlphaRefinePasses; ++pass )
+	{
+		// accumulate the normal equations in whole numbers, with the codes scaled by steps
+		int aa = 0;
+		int ab = 0;
+		int bb = 0;
+		int ax = 0;
+		int bx = 0;
+		for( int i = 0; i < 16; ++i )
+		{
+			int const index = indices[i];
+			if( ( mask & ( 1 << i ) ) == 0 || index > steps )
+				continue;
+			int const b = ( index == 0 ) ? 0 : ( index == 1 ) ? steps : index - 1;
+			int const a = steps - b;
+			int const x = steps*alphas[i];
+			aa += a*a;
+			ab += a*b;
+			bb += b*b;
+			ax += a*x;
+			bx += b*x;
+		}
+		int const det = aa*bb - ab*ab;
+		if( det <= 0 )
+			break;
+
+		// solve for the end points
+		int min = std::max( 0, std::min( DivideRounded( bb*ax - ab*bx, det ), 255 ) );
+		int max = std::max( 0, std::min( DivideRounded( aa*bx - ab*ax, det ), 255 ) );
+		if( min > max )
+			std::swap( min, max );
+
+		// keep the new code book only if it fits better
+		u8 trialCodes[8];
+		u8 trialIndices[16];
+		SetAlphaCodebook( min, max, steps, trialCodes );
+		if( trialCodes[0] == codes[0] && trialCodes[1] == codes[1] )
+			break;
+		int const trialError = FitAlphaCodes( alphas, mask, trialCodes, trialIndices );
+		if( trialError >= error )
+			break;
+		std::memcpy( codes, trialCodes, 8 );
+		std::memcpy( indices, trialIndices, 16 );
+		error = trialError;
+	}
+	return error;
+}
+
+static void FitAlphas( u8 const* rgba, int const* masks, int count, bool refine, u8* blocks, int stride )
+{
+	for( int n = 0; n < count; ++n, rgba += 64, blocks += stride )
+	{
+		// get the 5-alpha and 7-alpha code books, which start with their ranges
+		int const mask = masks[n];
+		u8 alphas[16];
+		int ranges[4];
+		u8 codes5[8];
+		u8 codes7[8];
+		GetAlphaRanges( rgba, mask, alphas, ranges );
+		SetAlphaCodebook( ranges[0], ranges[1], 5, codes5 );
+		SetAlphaCodebook( ranges[2], ranges[3], 7, codes7 );
+
+		// fit the data to both code books
+		u8 indices5[16];
+		u8 indices7[16];
+		int err5 = FitAlphaCodes( alphas, mask, codes5, indices5 );
+		int err7 = FitAlphaCodes( alphas, mask, codes7, indices7 );
+		if( refine )
+		{
+			err5 = RefineAlphaCodes( alphas, mask, 5, codes5, indices5, err5 );
+			err7 = RefineAlphaCodes( alphas, mask, 7, codes7, indices7, err7 );
+		}
+
+		// save the block with least error
+		if( err5 <= err7 )
+			WriteAlphaBlock5( codes5[0], codes5[1], indices5, blocks );
+		else
+			WriteAlphaBlock7( codes7[0], codes7[1], indices7, blocks );
+	}
+}
+
+static void RangeFitCovariance( RangeFitBatch& batch )
+{
+	int const count = batch.count;
+	Vec4 const zero = VEC4_CONST( 0.0f );
+
+	// compute the centroids
+	Vec4 total = zero;
+	Vec4 centroid[3] = { zero, zero, zero };
+	for( int i = 0; i < count; ++i )
+	{
+		Vec4 const weight = Load( batch.weights[i] );
+		total += weight;
+		for( int c = 0; c < 3; ++c )
+			centroid[c] += weight*Load( batch.points[i][c] );
+	}
+
+	// divide through by the totals (empty lanes are left at zero)
+	float totals[4];
+	float scales[4];
+	total.Store( totals );
+	for( int lane = 0; lane < 4; ++lane )
+		scales[lane] = ( totals[lane] != 0.0f ) ? 1.0f/totals[lane] : 0.0f;
+	Vec4 const scale = Load( scales );
+	for( int c = 0; c < 3; ++c )
+		centroid[c] *= scale;
+
+	// accumulate the covariance matrices
+	Vec4 covariance[6] = { zero, zero, zero, zero, zero, zero };
+	for( int i = 0; i < count; ++i )
+	{
+		Vec4 const weight = Load( batch.weights[i] );
+		Vec4 const ax = Load( batch.points[i][0] ) - centroid[0];
+		Vec4 const ay = Load( batch.points[i][1] ) - centroid[1];
+		Vec4 const az = Load( batch.points[i][2] ) - centroid[2];
+		Vec4 const bx = weight*ax;
+		Vec4 const by = weight*ay;
+		Vec4 const bz = weight*az;
+
+		covariance[0] += ax*bx;
+		covariance[1] += ax*by;
+		covariance[2] += ax*bz;
+		covariance[3] += ay*by;
+		covariance[4] += ay*bz;
+		covariance[5] += az*bz;
+	}
+
+	// save them
+	for( int k = 0; k < 6; ++k )
+		covariance[k].Store( batch.covariance[k] );
+}
+
+static void RangeFitPrinciple( RangeFitBatch& batch )
+{
+	// scale the matrices by their traces as EstimatePrincipleComponent does
+	Vec4 const zero = VEC4_CONST( 0.0f );
+	Vec4 const trace = Load( batch.covariance[0] ) + Load( batch.covariance[3] ) + Load( batch.covariance[5] );
+	float traces[4];
+	float scales[4];
+	trace.Store( traces );
+	for( int lane = 0; lane < 4; ++lane )
+		scales[lane] = ( 0.0f < traces[lane] ) ? 1.0f/traces[lane] : 0.0f;
+	Vec4 const scale = Load( scales );
+	Vec4 m[6];
+	for( int i = 0; i < 6; ++i )
+		m[i] = scale*Load( batch.covariance[i] );
+
+	// square them
+	for( int i = 0; i < kPrincipleSquarings; ++i )
+	{
+		Vec4 const s[6] = {
+			m[0]*m[0] + m[1]*m[1] + m[2]*m[2], 
+			m[0]*m[1] + m[1]*m[3] + m[2]*m[4], 
+			m[0]*m[2] + m[1]*m[4] + m[2]*m[5], 
+			m[1]*m[1] + m[3]*m[3] + m[4]*m[4], 
+			m[1]*m[2] + m[3]*m[4] + m[4]*m[5], 
+			m[2]*m[2] + m[4]*m[4] + m[5]*m[5]
+		};
+		for( int j = 0; j < 6; ++j )
+			m[j] = s[j];
+	}
+
+	// start from the columns with the largest diagonals
+	Vec4 diagonal = m[0];
+	Vec4 x = m[0];
+	Vec4 y = m[1];
+	Vec4 z = m[2];
+	Vec4 less = CompareLessThan( diagonal, m[3] );
+	diagonal = Select( less, m[3], diagonal );
+	x = Select( less, m[1], x );
+	y = Select( less, m[3], y );
+	z = Select( less, m[4], z );
+	less = CompareLessThan( diagonal, m[5] );
+	x = Select( less, m[2], x );
+	y = Select( less, m[4], y );
+	z = Select( less, m[5], z );
+
+	// iterate
+	for( int i = 0; i < kPrincipleIterations; ++i )
+	{
+		Vec4 const nx = m[0]*x + m[1]*y + m[2]*z;
+		Vec4 const ny = m[1]*x + m[3]*y + m[4]*z;
+		Vec4 const nz = m[2]*x + m[4]*y + m[5]*z;
+		x = nx;
+		y = ny;
+		z = nz;
+	}
+
+	// lanes without any spread take the default axis
+	Vec4 const one = VEC4_CONST( 1.0f );
+	Vec4 const valid = CompareLessThan( zero, trace );
+	Select( valid, x, one ).Store( batch.principle[0] );
+	Select( valid, y, one ).Store( batch.principle[1] );
+	Select( valid, z, one ).Store( batch.principle[2] );
+}
+
+static Vec4 FitRangeCodes( RangeFitBatch const& batch, Vec4 const ( *codes )[3], int codeCount, u8 ( *closest )[4] )
+{
+	Vec4 const zero = VEC4_CONST( 0.0f );
+	Vec4 const counts = Load( batch.counts );
+	Vec4 const metricx( batch.metric[0] );
+	Vec4 const metricy( batch.metric[1] );
+	Vec4 const metricz( batch.metric[2] );
+
+	// match each point to the closest code
+	Vec4 error = zero;
+	for( int i = 0; i < batch.count; ++i )
+	{
+		Vec4 const x = Load( batch.points[i][0] );
+		Vec4 const y = Load( batch.points[i][1] );
+		Vec4 const z = Load( batch.points[i][2] );
+
+		// find the closest code
+		Vec4 dist = VEC4_CONST( FLT_MAX );
+		Vec4 idx = zero;
+		for( int j = 0; j < codeCount; ++j )
+		{
+			Vec4 const dx = metricx*( x - codes[j][0] );
+			Vec4 const dy = metricy*( y - codes[j][1] );
+			Vec4 const dz = metricz*( z - codes[j][2] );
+			Vec4 const d = dx*dx + dy*dy + dz*dz;
+			Vec4 const less = CompareLessThan( d, dist );
+			dist = Select( less, d, dist );
+			idx = Select( less, Vec4( ( float )j ), idx );
+		}
+
+		// save the index
+		float indices[4];
+		idx.Store( indices );
+		for( int lane = 0; lane < 4; ++lane )
+			closest[i][lane] = ( u8 )indices[lane];
+
+		// accumulate the error of the points that are present
+		Vec4 const valid = CompareLessThan( Vec4( ( float )i ), counts );
+		error += Select( valid, dist, zero );
+	}
+	return error;
+}
+
+static void RangeFitCodes( RangeFitBatch& batch )
+{
+	int const count = batch.count;
+	Vec4 const zero = VEC4_CONST( 0.0f );
+	Vec4 const one = VEC4_CONST( 1.0f );
+	Vec4 const half = VEC4_CONST( 0.5f );
+	Vec4 const counts = Load( batch.counts );
+	Vec4 const principlex = Load( batch.principle[0] );
+	Vec4 const principley = Load( batch.principle[1] );
+	Vec4 const principlez = Load( batch.principle[2] );
+
+	// compute the range (every lane has at least one point)
+	Vec4 start[3];
+	Vec4 end[3];
+	for( int c = 0; c < 3; ++c )
+		start[c] = end[c] = Load( batch.points[0][c] );
+	Vec4 min = start[0]*principlex + start[1]*principley + start[2]*principlez;
+	Vec4 max = min;
+	for( int i = 1; i < count; ++i )
+	{
+		Vec4 const x = Load( batch.points[i][0] );
+		Vec4 const y = Load( batch.points[i][1] );
+		Vec4 const z = Load( batch.points[i][2] );
+		Vec4 const val = x*principlex + y*principley + z*principlez;
+
+		// only points that are present may extend the range
+		Vec4 const valid = CompareLessThan( Vec4( ( float )i ), counts );
+		Vec4 const less = Select( valid, CompareLessThan( val, min ), zero );
+		Vec4 const greater = Select( less, zero, Select( valid, CompareLessThan( max, val ), zero ) );
+
+		start[0] = Select( less, x, start[0] );
+		start[1] = Select( less, y, start[1] );
+		start[2] = Select( less, z, start[2] );
+		min = Select( less, val, min );
+		end[0] = Select( greater, x, end[0] );
+		end[1] = Select( greater, y, end[1] );
+		end[2] = Select( greater, z, end[2] );
+		max = Select( greater, val, max );
+	}
+
+	// clamp the output to [0, 1] and then to the grid
+	float const grid[3] = { 31.0f, 63.0f, 31.0f };
+	float const gridrcp[3] = { 1.0f/31.0f, 1.0f/63.0f, 1.0f/31.0f };
+	for( int c = 0; c < 3; ++c )
+	{
+		start[c] = Min( one, Max( zero, start[c] ) );
+		end[c] = Min( one, Max( zero, end[c] ) );
+		start[c] = Truncate( Vec4( grid[c] )*start[c] + half )*Vec4( gridrcp[c] );
+		end[c] = Truncate( Vec4( grid[c] )*end[c] + half )*Vec4( gridrcp[c] );
+		start[c].Store( batch.start[c] );
+		end[c].Store( batch.end[c] );
+	}
+
+	// fit the points to the 3-colour codebook
+	if( batch.dxt1 )
+	{
+		Vec4 codes[3][3];
+		for( int c = 0; c < 3; ++c )
+		{
+			codes[0][c] = start[c];
+			codes[1][c] = end[c];
+			codes[2][c] = VEC4_CONST( 0.5f )*start[c] + VEC4_CONST( 0.5f )*end[c];
+		}
+		FitRangeCodes( batch, codes, 3, batch.closest3 ).Store( batch.error3 );
+	}
+
+	// fit the points to the 4-colour codebook
+	Vec4 codes[4][3];
+	for( int c = 0; c < 3; ++c )
+	{
+		codes[0][c] = start[c];
+		codes[1][c] = end[c];
+		codes[2][c] = VEC4_CONST( 2.0f/3.0f )*start[c] + VEC4_CONST( 1.0f/3.0f )*end[c];
+		codes[3][c] = VEC4_CONST( 1.0f/3.0f )*start[c] + VEC4_CONST( 2.0f/3.0f )*end[c];
+	}
+	FitRangeCodes( batch, codes, 4, batch.closest4 ).Store( batch.error4 );
+}
+
+static int WidenChannel( unsigned int value, int bits )
+{
+	// repeat the top bits below the value so the largest one becomes 255
+	return ( value << ( 8 - bits ) ) | ( value >> ( 2*bits - 8 ) );
+}
+
+static void PackPixel( u8 const* pixel, int pixelFormat, int format, u8* packed )
+{
+	// get the channels from either layout
+	bool const bgra = ( ( pixelFormat & kPixelBgra ) != 0 );
+	unsigned int const red = pixel[bgra ? 2 : 0];
+	unsigned int const green = pixel[1];
+	unsigned int const blue = pixel[bgra ? 0 : 2];
+	unsigned int const alpha = pixel[3];
+
+	// keep the top bits of each channel
+	unsigned int value;
+	switch( format )
+	{
+	case kFormatX8R8G8B8:
+		value = ( red << 16 ) | ( green << 8 ) | blue;
+		break;
+
+	case kFormatA8B8G8R8:
+		value = ( alpha << 24 ) | ( blue << 16 ) | ( green << 8 ) | red;
+		break;
+
+	case kFormatX8B8G8R8:
+		value = ( blue << 16 ) | ( green << 8 ) | red;
+		break;
+
+	case kFormatA1R5G5B5:
+		value = ( ( alpha != 0 ) ? 0x8000 : 0 ) | ( ( red >> 3 ) << 10 ) | ( ( green >> 3 ) << 5 ) | ( blue >> 3 );
+		break;
+
+	case kFormatA4R4G4B4:
+		value = ( ( alpha >> 4 ) << 12 ) | ( ( red >> 4 ) << 8 ) | ( ( green >> 4 ) << 4 ) | ( blue >> 4 );
+		break;
+
+	case kFormatR8G8B8:
+		value = ( red << 16 ) | ( green << 8 ) | blue;
+		break;
+
+	case kFormatR5G6B5:
+		value = ( ( red >> 3 ) << 11 ) | ( ( green >> 2 ) << 5 ) | ( blue >> 3 );
+		break;
+
+	default:
+		value = ( alpha << 24 ) | ( red << 16 ) | ( green << 8 ) | blue;
+		break;
+	}
+
+	// write it little endian
+	int const size = GetFormatPixelSize( format );
+	for( int i = 0; i < size; ++i )
+		packed[i] = ( u8 )( value >> 8*i );
+}
+
+static void UnpackPixel( u8* pixel, int pixelFormat, int format, u8 const* packed )
+{
+	// read the little endian value
+	int const size = GetFormatPixelSize( format );
+	unsigned int value = 0;
+	for( int i = 0; i < size; ++i )
+		value |= ( unsigned int )packed[i] << 8*i;
+
+	// widen each channel to 8 bits
+	unsigned int red, green, blue;
+	unsigned int alpha = 255;
+	switch( format )
+	{
+	case kFormatA8B8G8R8:
+	case kFormatX8B8G8R8:
+		red = value & 0xff;
+		green = ( value >> 8 ) & 0xff;
+		blue = ( value >> 16 ) & 0xff;
+		if( format == kFormatA8B8G8R8 )
+			alpha = ( value >> 24 ) & 0xff;
+		break;
+
+	case kFormatA1R5G5B5:
+		red = WidenChannel( ( value >> 10 ) & 0x1f, 5 );
+		green = WidenChannel( ( value >> 5 ) & 0x1f, 5 );
+		blue = WidenChannel( value & 0x1f, 5 );
+		alpha = ( value >> 15 )*255;
+		break;
+
+	case kFormatA4R4G4B4:
+		red = WidenChannel( ( value >> 8 ) & 0xf, 4 );
+		green = WidenChannel( ( value >> 4 ) & 0xf, 4 );
+		blue = WidenChannel( value & 0xf, 4 );
+		alpha = WidenChannel( ( value >> 12 ) & 0xf, 4 );
+		break;
+
+	case kFormatR5G6B5:
+		red = WidenChannel( ( value >> 11 ) & 0x1f, 5 );
+		green = WidenChannel( ( value >> 5 ) & 0x3f, 6 );
+		blue = WidenChannel( value & 0x1f, 5 );
+		break;
+
+	default:
+		red = ( value >> 16 ) & 0xff;
+		green = ( value >> 8 ) & 0xff;
+		blue = value & 0xff;
+		if( format == kFormatA8R8G8B8 )
+			alpha = ( value >> 24 ) & 0xff;
+		break;
+	}
+
+	// write the channels in either layout
+	bool const bgra = ( ( pixelFormat & kPixelBgra ) != 0 );
+	pixel[bgra ? 2 : 0] = ( u8 )red;
+	pixel[1] = ( u8 )green;
+	pixel[bgra ? 0 : 2] = ( u8 )blue;
+	pixel[3] = ( u8 )alpha;
+}
+
+#if SQUISH_USE_SSE >= 2
+
+static void GetAlphaDxt3( u8 const* bytes, u8* alphas )
+{
+	// expand each 4 bit value to 8 bits
+	for( int i = 0; i < 8; ++i )
+	{
+		int const lo = bytes[i] & 0x0f;
+		int const hi = bytes[i] & 0xf0;
+		alphas[2*i] = ( u8 )( lo | ( lo << 4 ) );
+		alphas[2*i + 1] = ( u8 )( hi | ( hi >> 4 ) );
+	}
+}
+
+static void GetAlphaDxt5( u8 const* bytes, u8* alphas )
+{
+	// build the codebook exactly as DecompressAlphaDxt5 does
+	int const alpha0 = bytes[0];
+	int const alpha1 = bytes[1];
+	u8 codes[8];
+	codes[0] = ( u8 )alpha0;
+	codes[1] = ( u8 )alpha1;
+	if( alpha0 <= alpha1 )
+	{
+		for( int i = 1; i < 5; ++i )
+			codes[1 + i] = ( u8 )( ( ( 5 - i )*alpha0 + i*alpha1 )/5 );
+		codes[6] = 0;
+		codes[7] = 255;
+	}
+	else
+	{
+		for( int i = 1; i < 7; ++i )
+			codes[1 + i] = ( u8 )( ( ( 7 - i )*alpha0 + i*alpha1 )/7 );
+	}
+
+	// look up the 3 bit indices, 8 to each group of 3 bytes
+	for( int i = 0; i < 2; ++i )
+	{
+		u8 const* src = bytes + 2 + 3*i;
+		int const value = src[0] | ( src[1] << 8 ) | ( src[2] << 16 );
+		for( int j = 0; j < 8; ++j )
+			alphas[8*i + j] = codes[( value >> 3*j ) & 0x7];
+	}
+}
+
+static int UnpackColour( u8 const* packed )
+{
+	// expand 565 to 8 bits per channel with opaque alpha
+	int const value = packed[0] | ( packed[1] << 8 );
+	int const red = ( value >> 11 ) & 0x1f;
+	int const green = ( value >> 5 ) & 0x3f;
+	int const blue = value & 0x1f;
+	return ( ( red << 3 ) | ( red >> 2 ) ) 
+		| ( ( ( green << 2 ) | ( green >> 4 ) ) << 8 ) 
+		| ( ( ( blue << 3 ) | ( blue >> 2 ) ) << 16 ) 
+		| ( 0xff << 24 );
+}
+
+static void DecompressBlocks( u8 const* blocks, int count, int flags, u8* rgba, int stride )
+{
+	bool const isDxt1 = ( ( flags & kDxt1 ) != 0 );
+	int const bytesPerBlock = isDxt1 ? 8 : 16;
+	__m128i const zero = _mm_setzero_si128();
+	__m128i const third = _mm_set1_epi16( 21846 );
+	__m128i const colourMask = _mm_set1_epi32( 0x00ffffff );
+	__m128i const ones = _mm_set_epi32( 1 << 6, 1 << 4, 1 << 2, 1 );
+	__m128i const twos = _mm_set_epi32( 2 << 6, 2 << 4, 2 << 2, 2 );
+	__m128i const threes = _mm_set_epi32( 3 << 6, 3 << 4, 3 << 2, 3 );
+
+	for( int b = 0; b < count; ++b, blocks += bytesPerBlock, rgba += 16 )
+	{
+		u8 const* colourBlock = isDxt1 ? blocks : blocks + 8;
+
+		// build the palette as 16 bit lanes, dividing by 3 with a multiply that is exact up to 765
+		int const a = colourBlock[0] | ( colourBlock[1] << 8 );
+		int const c = colourBlock[2] | ( colourBlock[3] << 8 );
+		__m128i const ends = _mm_unpacklo_epi8( _mm_set_epi32( 0, 0, UnpackColour( colourBlock + 2 ), UnpackColour( colourBlock ) ), zero );
+		__m128i const swapped = _mm_shuffle_epi32( ends, _MM_SHUFFLE( 1, 0, 3, 2 ) );
+		__m128i mids;
+		if( isDxt1 && a <= c )
+			mids = _mm_unpacklo_epi64( _mm_srli_epi16( _mm_add_epi16( ends, swapped ), 1 ), zero );
+		else
+			mids = _mm_mulhi_epu16( _mm_add_epi16( _mm_add_epi16( ends, ends ), swapped ), third );
+		__m128i const codes = _mm_packus_epi16( ends, mids );
+
+		// keep the differences from the first code to select with
+		__m128i const code0 = _mm_shuffle_epi32( codes, _MM_SHUFFLE( 0, 0, 0, 0 ) );
+		__m128i const diff1 = _mm_xor_si128( code0, _mm_shuffle_epi32( codes, _MM_SHUFFLE( 1, 1, 1, 1 ) ) );
+		__m128i const diff2 = _mm_xor_si128( code0, _mm_shuffle_epi32( codes, _MM_SHUFFLE( 2, 2, 2, 2 ) ) );
+		__m128i const diff3 = _mm_xor_si128( code0, _mm_shuffle_epi32( codes, _MM_SHUFFLE( 3, 3, 3, 3 ) ) );
+
+		// get the separate alpha values
+		u8 alphas[16];
+		if( ( flags & kDxt3 ) != 0 )
+			GetAlphaDxt3( blocks, alphas );
+		else if( ( flags & kDxt5 ) != 0 )
+			GetAlphaDxt5( blocks, alphas );
+
+		// expand the 4 indices of each row into a 16 byte row of pixels
+		int const packed = colourBlock[4] | ( colourBlock[5] << 8 ) | ( colourBlock[6] << 16 ) | ( colourBlock[7] << 24 );
+		__m128i indices = _mm_set1_epi32( packed );
+		for( int row = 0; row < 4; ++row, indices = _mm_srli_epi32( indices, 8 ) )
+		{
+			__m128i const lanes = _mm_and_si128( indices, threes );
+			__m128i pixels = code0;
+			pixels = _mm_xor_si128( pixels, _mm_and_si128( diff1, _mm_cmpeq_epi32( lanes, ones ) ) );
+			pixels = _mm_xor_si128( pixels, _mm_and_si128( diff2, _mm_cmpeq_epi32( lanes, twos ) ) );
+			pixels = _mm_xor_si128( pixels, _mm_and_si128( diff3, _mm_cmpeq_epi32( lanes, threes ) ) );
+			if( !isDxt1 )
+			{
+				int alpha;
+				std::memcpy( &alpha, alphas + 4*row, 4 );
+				__m128i const alpha8 = _mm_unpacklo_epi8( _mm_cvtsi32_si128( alpha ), zero );
+				__m128i const alpha32 = _mm_slli_epi32( _mm_unpacklo_epi16( alpha8, zero ), 24 );
+				pixels = _mm_or_si128( _mm_and_si128( pixels, colourMask ), alpha32 );
+			}
+			_mm_storeu_si128( reinterpret_cast< __m128i* >( rgba + stride*row ), pixels );
+		}
+	}
+}
+
+static void FilterRows( float const* const* rows, float const* weights, int rowCount, int count, float* output )
+{
+	int i = 0;
+#if SQUISH_USE_AVX
+	// sum 8 values at a time
+	for( ; i + 8 <= count; i += 8 )
+	{
+		__m256 sum = _mm256_setzero_ps();
+		for( int r = 0; r < rowCount; ++r )
+			sum = _mm256_add_ps( sum, _mm256_mul_ps( _mm256_set1_ps( weights[r] ), _mm256_loadu_ps( rows[r] + i ) ) );
+		_mm256_storeu_ps( output + i, sum );
+	}
+#endif
+
+	// sum 4 values at a time, which is one rgba pixel
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128 sum = _mm_setzero_ps();
+		for( int r = 0; r < rowCount; ++r )
+			sum = _mm_add_ps( sum, _mm_mul_ps( _mm_set1_ps( weights[r] ), _mm_loadu_ps( rows[r] + i ) ) );
+		_mm_storeu_ps( output + i, sum );
+	}
+	for( ; i < count; ++i )
+	{
+		float sum = 0.0f;
+		for( int r = 0; r < rowCount; ++r )
+			sum += weights[r]*rows[r][i];
+		output[i] = sum;
+	}
+}
+
+static void FilterPixels( float const* input, int const* starts, float const* weights, int tapCount, int count, float* output )
+{
+	int i = 0;
+#if SQUISH_USE_AVX
+	// filter 2 pixels at a time, one in each half
+	for( ; i + 2 <= count; i += 2 )
+	{
+		float const* source0 = input + 4*starts[i];
+		float const* source1 = input + 4*starts[i + 1];
+		float const* weights0 = weights + tapCount*i;
+		float const* weights1 = weights0 + tapCount;
+		__m256 sum = _mm256_setzero_ps();
+		for( int t = 0; t < tapCount; ++t )
+		{
+			__m256 const pixels = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( source0 + 4*t ) ), _mm_loadu_ps( source1 + 4*t ), 1 );
+			__m256 const weight = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_set1_ps( weights0[t] ) ), _mm_set1_ps( weights1[t] ), 1 );
+			sum = _mm256_add_ps( sum, _mm256_mul_ps( weight, pixels ) );
+		}
+		_mm256_storeu_ps( output + 4*i, sum );
+	}
+#endif
+
+	// filter the rest a pixel at a time
+	for( ; i < count; ++i )
+	{
+		float const* source = input + 4*starts[i];
+		float const* pixelWeights = weights + tapCount*i;
+		__m128 sum = _mm_setzero_ps();
+		for( int t = 0; t < tapCount; ++t )
+			sum = _mm_add_ps( sum, _mm_mul_ps( _mm_set1_ps( pixelWeights[t] ), _mm_loadu_ps( source + 4*t ) ) );
+		_mm_storeu_ps( output + 4*i, sum );
+	}
+}
+
+static __m128i SwapRedBlue( __m128i pixels )
+{
+#if SQUISH_USE_AVX
+	// swap the bytes with one shuffle
+	return _mm_shuffle_epi8( pixels, _mm_set_epi8( 15, 12, 13, 14, 11, 8, 9, 10, 7, 4, 5, 6, 3, 0, 1, 2 ) );
+#else
+	// swap the 16 bit halves holding red and blue
+	__m128i const mask = _mm_set1_epi32( 0x00ff00ff );
+	__m128i const redBlue = _mm_and_si128( pixels, mask );
+	__m128i const swapped = _mm_shufflehi_epi16( _mm_shufflelo_epi16( redBlue, _MM_SHUFFLE( 2, 3, 0, 1 ) ), _MM_SHUFFLE( 2, 3, 0, 1 ) );
+	return _mm_or_si128( _mm_andnot_si128( mask, pixels ), swapped );
+#endif
+}
+
+static int CopyPixels( u8 const* source, int count, bool swap, int keep, int set, u8* target )
+{
+	__m128i const keep4 = _mm_set1_epi32( keep );
+	__m128i const set4 = _mm_set1_epi32( set );
+	int i = 0;
+#if SQUISH_USE_AVX
+	// copy 8 pixels at a time, swapping within each half
+	__m128i const order = swap 
+		? _mm_set_epi8( 15, 12, 13, 14, 11, 8, 9, 10, 7, 4, 5, 6, 3, 0, 1, 2 ) 
+		: _mm_set_epi8( 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 );
+	__m256i const order8 = _mm256_inserti128_si256( _mm256_castsi128_si256( order ), order, 1 );
+	__m256i const keep8 = _mm256_set1_epi32( keep );
+	__m256i const set8 = _mm256_set1_epi32( set );
+	for( ; i + 8 <= count; i += 8 )
+	{
+		__m256i const pixels = _mm256_shuffle_epi8( _mm256_loadu_si256( reinterpret_cast< __m256i const* >( source + 4*i ) ), order8 );
+		_mm256_storeu_si256( reinterpret_cast< __m256i* >( target + 4*i ), _mm256_or_si256( _mm256_and_si256( pixels, keep8 ), set8 ) );
+	}
+#endif
+
+	// copy 4 pixels at a time
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128i pixels = _mm_loadu_si128( reinterpret_cast< __m128i const* >( source + 4*i ) );
+		if( swap )
+			pixels = SwapRedBlue( pixels );
+		_mm_storeu_si128( reinterpret_cast< __m128i* >( target + 4*i ), _mm_or_si128( _mm_and_si128( pixels, keep4 ), set4 ) );
+	}
+	return i;
+}
+
+static __m128i PackValues16( __m128i argb, int format )
+{
+	// move the top bits of each channel into place
+	__m128i packed;
+	if( format == kFormatA1R5G5B5 )
+	{
+		__m128i const transparent = _mm_cmpeq_epi32( _mm_srli_epi32( argb, 24 ), _mm_setzero_si128() );
+		packed = _mm_andnot_si128( transparent, _mm_set1_epi32( 0x8000 ) );
+		packed = _mm_or_si128( packed, _mm_and_si128( _mm_srli_epi32( argb, 9 ), _mm_set1_epi32( 0x7c00 ) ) );
+		packed = _mm_or_si128( packed, _mm_and_si128( _mm_srli_epi32( argb, 6 ), _mm_set1_epi32( 0x03e0 ) ) );
+		packed = _mm_or_si128( packed, _mm_and_si128( _mm_srli_epi32( argb, 3 ), _mm_set1_epi32( 0x001f ) ) );
+	}
+	else if( format == kFormatA4R4G4B4 )
+	{
+		packed = _mm_and_si128( _mm_srli_epi32( argb, 16 ), _mm_set1_epi32( 0xf000 ) );
+		packed = _mm_or_si128( packed, _mm_and_si128( _mm_srli_epi32( argb, 12 ), _mm_set1_epi32( 0x0f00 ) ) );
+		packed = _mm_or_si128( packed, _mm_and_si128( _mm_srli_epi32( argb, 8 ), _mm_set1_epi32( 0x00f0 ) ) );
+		packed = _mm_or_si128( packed, _mm_and_si128( _mm_srli_epi32( argb, 4 ), _mm_set1_epi32( 0x000f ) ) );
+	}
+	else
+	{
+		packed = _mm_and_si128( _mm_srli_epi32( argb, 8 ), _mm_set1_epi32( 0xf800 ) );
+		packed = _mm_or_si128( packed, _mm_and_si128( _mm_srli_epi32( argb, 5 ), _mm_set1_epi32( 0x07e0 ) ) );
+		packed = _mm_or_si128( packed, _mm_and_si128( _mm_srli_epi32( argb, 3 ), _mm_set1_epi32( 0x001f ) ) );
+	}
+
+	// sign extend the low halves so that packing them cannot saturate
+	return _mm_srai_epi32( _mm_slli_epi32( packed, 16 ), 16 );
+}
+
+static __m128i UnpackValues16( __m128i packed, int format )
+{
+	// widen each channel in place by repeating its top bits below it
+	__m128i argb;
+	if( format == kFormatA1R5G5B5 )
+	{
+		__m128i const opaque = _mm_srai_epi32( _mm_slli_epi32( packed, 16 ), 31 );
+		argb = _mm_and_si128( opaque, _mm_set1_epi32( ( int )0xff000000 ) );
+		argb = _mm_or_si128( argb, _mm_slli_epi32( _mm_and_si128( packed, _mm_set1_epi32( 0x7c00 ) ), 9 ) );
+		argb = _mm_or_si128( argb, _mm_slli_epi32( _mm_and_si128( packed, _mm_set1_epi32( 0x7000 ) ), 4 ) );
+		argb = _mm_or_si128( argb, _mm_slli_epi32( _mm_and_si128( packed, _mm_set1_epi32( 0x03e0 ) ), 6 ) );
+		argb = _mm_or_si128( argb, _mm_slli_epi32( _mm_and_si128( packed, _mm_set1_epi32( 0x0380 ) ), 1 ) );
+	}
+	else if( format == kFormatA4R4G4B4 )
+	{
+		// spread the nibbles to the low half of each byte, then copy them to the high half
+		argb = _mm_slli_epi32( _mm_and_si128( packed, _mm_set1_epi32( 0xf000 ) ), 12 );
+		argb = _mm_or_si128( argb, _mm_slli_epi32( _mm_and_si128( packed, _mm_set1_epi32( 0x0f00 ) ), 8 ) );
+		argb = _mm_or_si128( argb, _mm_slli_epi32( _mm_and_si128( packed, _mm_set1_epi32( 0x00f0 ) ), 4 ) );
+		argb = _mm_or_si128( argb, _mm_and_si128( packed, _mm_set1_epi32( 0x000f ) ) );
+		return _mm_or_si128( argb, _mm_slli_epi32( argb, 4 ) );
+	}
+	else
+	{
+		argb = _mm_set1_epi32( ( int )0xff000000 );
+		argb = _mm_or_si128( argb, _mm_slli_epi32( _mm_and_si128( packed, _mm_set1_epi32( 0xf800 ) ), 8 ) );
+		argb = _mm_or_si128( argb, _mm_slli_epi32( _mm_and_si128( packed, _mm_set1_epi32( 0xe000 ) ), 3 ) );
+		argb = _mm_or_si128( argb, _mm_slli_epi32( _mm_and_si128( packed, _mm_set1_epi32( 0x07e0 ) ), 5 ) );
+		argb = _mm_or_si128( argb, _mm_srli_epi32( _mm_and_si128( packed, _mm_set1_epi32( 0x0600 ) ), 1 ) );
+	}
+
+	// blue is in the same place in both 5 bit layouts
+	argb = _mm_or_si128( argb, _mm_slli_epi32( _mm_and_si128( packed, _mm_set1_epi32( 0x001f ) ), 3 ) );
+	return _mm_or_si128( argb, _mm_srli_epi32( _mm_and_si128( packed, _mm_set1_epi32( 0x001c ) ), 2 ) );
+}
+
+static int PackPixels16( u8 const* pixels, int count, bool bgra, int format, u8* packed )
+{
+	// pack 8 pixels at a time from A8R8G8B8 values
+	int i = 0;
+	for( ; i + 8 <= count; i += 8 )
+	{
+		__m128i lo = _mm_loadu_si128( reinterpret_cast< __m128i const* >( pixels + 4*i ) );
+		__m128i hi = _mm_loadu_si128( reinterpret_cast< __m128i const* >( pixels + 4*i + 16 ) );
+		if( !bgra )
+		{
+			lo = SwapRedBlue( lo );
+			hi = SwapRedBlue( hi );
+		}
+		__m128i const values = _mm_packs_epi32( PackValues16( lo, format ), PackValues16( hi, format ) );
+		_mm_storeu_si128( reinterpret_cast< __m128i* >( packed + 2*i ), values );
+	}
+	return i;
+}
+
+static int UnpackPixels16( u8* pixels, int count, bool bgra, int format, u8 const* packed )
+{
+	// unpack 8 pixels at a time to A8R8G8B8 values
+	__m128i const zero = _mm_setzero_si128();
+	int i = 0;
+	for( ; i + 8 <= count; i += 8 )
+	{
+		__m128i const values = _mm_loadu_si128( reinterpret_cast< __m128i const* >( packed + 2*i ) );
+		__m128i lo = UnpackValues16( _mm_unpacklo_epi16( values, zero ), format );
+		__m128i hi = UnpackValues16( _mm_unpackhi_epi16( values, zero ), format );
+		if( !bgra )
+		{
+			lo = SwapRedBlue( lo );
+			hi = SwapRedBlue( hi );
+		}
+		_mm_storeu_si128( reinterpret_cast< __m128i* >( pixels + 4*i ), lo );
+		_mm_storeu_si128( reinterpret_cast< __m128i* >( pixels + 4*i + 16 ), hi );
+	}
+	return i;
+}
+
+static int PackPixels24( u8 const* pixels, int count, bool bgra, u8* packed )
+{
+	int i = 0;
+#if SQUISH_USE_AVX
+	// drop the alpha bytes with a shuffle, keeping blue, green and red in that order
+	__m128i const order = bgra 
+		? _mm_set_epi8( -1, -1, -1, -1, 14, 13, 12, 10, 9, 8, 6, 5, 4, 2, 1, 0 ) 
+		: _mm_set_epi8( -1, -1, -1, -1, 12, 13, 14, 8, 9, 10, 4, 5, 6, 0, 1, 2 );
+
+	// pack 8 pixels at a time, gathering the 24 bytes at the bottom
+	__m256i const order8 = _mm256_inserti128_si256( _mm256_castsi128_si256( order ), order, 1 );
+	__m256i const gather = _mm256_set_epi32( 7, 3, 6, 5, 4, 2, 1, 0 );
+	for( ; i + 16 <= count; i += 8 )
+	{
+		__m256i const values = _mm256_shuffle_epi8( _mm256_loadu_si256( reinterpret_cast< __m256i const* >( pixels + 4*i ) ), order8 );
+		_mm256_storeu_si256( reinterpret_cast< __m256i* >( packed + 3*i ), _mm256_permutevar8x32_epi32( values, gather ) );
+	}
+
+	// pack 4 pixels at a time, the 4 bytes written past them are overwritten by the next ones
+	for( ; i + 8 <= count; i += 4 )
+	{
+		__m128i const values = _mm_shuffle_epi8( _mm_loadu_si128( reinterpret_cast< __m128i const* >( pixels + 4*i ) ), order );
+		_mm_storeu_si128( reinterpret_cast< __m128i* >( packed + 3*i ), values );
+	}
+#else
+	// copy the colour bytes without the shuffle
+	int const red = bgra ? 2 : 0;
+	for( ; i < count; ++i )
+	{
+		packed[3*i] = pixels[4*i + 2 - red];
+		packed[3*i + 1] = pixels[4*i + 1];
+		packed[3*i + 2] = pixels[4*i + red];
+	}
+#endif
+	return i;
+}
+
+static int UnpackPixels24( u8* pixels, int count, bool bgra, u8 const* packed )
+{
+	int i = 0;
+#if SQUISH_USE_AVX
+	// spread out the 3 byte pixels with a shuffle, then make them opaque
+	__m128i const order = bgra 
+		? _mm_set_epi8( -1, 11, 10, 9, -1, 8, 7, 6, -1, 5, 4, 3, -1, 2, 1, 0 ) 
+		: _mm_set_epi8( -1, 9, 10, 11, -1, 6, 7, 8, -1, 3, 4, 5, -1, 0, 1, 2 );
+	__m128i const opaque = _mm_set1_epi32( ( int )0xff000000 );
+
+	// unpack 8 pixels at a time, moving the top 12 bytes to the high half first
+	__m256i const order8 = _mm256_inserti128_si256( _mm256_castsi128_si256( order ), order, 1 );
+	__m256i const opaque8 = _mm256_set1_epi32( ( int )0xff000000 );
+	__m256i const scatter = _mm256_set_epi32( 7, 5, 4, 3, 7, 2, 1, 0 );
+	for( ; i + 16 <= count; i += 8 )
+	{
+		__m256i const values = _mm256_permutevar8x32_epi32( _mm256_loadu_si256( reinterpret_cast< __m256i const* >( packed + 3*i ) ), scatter );
+		_mm256_storeu_si256( reinterpret_cast< __m256i* >( pixels + 4*i ), _mm256_or_si256( _mm256_shuffle_epi8( values, order8 ), opaque8 ) );
+	}
+
+	// unpack 4 pixels at a time, reading no further than the next ones
+	for( ; i + 8 <= count; i += 4 )
+	{
+		__m128i const values = _mm_shuffle_epi8( _mm_loadu_si128( reinterpret_cast< __m128i const* >( packed + 3*i ) ), order );
+		_mm_storeu_si128( reinterpret_cast< __m128i* >( pixels + 4*i ), _mm_or_si128( values, opaque ) );
+	}
+#else
+	// copy the colour bytes without the shuffle
+	int const red = bgra ? 2 : 0;
+	for( ; i < count; ++i )
+	{
+		pixels[4*i + 2 - red] = packed[3*i];
+		pixels[4*i + 1] = packed[3*i + 1];
+		pixels[4*i + red] = packed[3*i + 2];
+		pixels[4*i + 3] = 255;
+	}
+#endif
+	return i;
+}
+
+static void PackPixels( u8 const* pixels, int count, int pixelFormat, int format, u8* packed )
+{
+	// the ARGB formats are stored as bgra bytes and the ABGR formats as rgba bytes
+	bool const bgra = ( ( pixelFormat & kPixelBgra ) != 0 );
+	bool const argb = ( format == kFormatA8R8G8B8 || format == kFormatX8R8G8B8 );
+	int i;
+	switch( format )
+	{
+	case kFormatA8R8G8B8:
+	case kFormatX8R8G8B8:
+	case kFormatA8B8G8R8:
+	case kFormatX8B8G8R8:
+		i = CopyPixels( pixels, count, bgra != argb, ( format == kFormatX8R8G8B8 || format == kFormatX8B8G8R8 ) ? 0x00ffffff : -1, 0, packed );
+		break;
+
+	case kFormatR8G8B8:
+		i = PackPixels24( pixels, count, bgra, packed );
+		break;
+
+	default:
+		i = PackPixels16( pixels, count, bgra, format, packed );
+		break;
+	}
+
+	// pack the rest a pixel at a time
+	int const size = GetFormatPixelSize( format );
+	for( ; i < count; ++i )
+		PackPixel( pixels + 4*i, pixelFormat, format, packed + size*i );
+}
+
+static void UnpackPixels( u8* pixels, int count, int pixelFormat, int format, u8 const* packed )
+{
+	bool const bgra = ( ( pixelFormat & kPixelBgra ) != 0 );
+	bool const argb = ( format == kFormatA8R8G8B8 || format == kFormatX8R8G8B8 );
+	int i;
+	switch( format )
+	{
+	case kFormatA8R8G8B8:
+	case kFormatX8R8G8B8:
+	case kFormatA8B8G8R8:
+	case kFormatX8B8G8R8:
+		i = CopyPixels( packed, count, bgra != argb, -1, ( format == kFormatX8R8G8B8 || format == kFormatX8B8G8R8 ) ? ( int )0xff000000 : 0, pixels );
+		break;
+
+	case kFormatR8G8B8:
+		i = UnpackPixels24( pixels, count, bgra, packed );
+		break;
+
+	default:
+		i = UnpackPixels16( pixels, count, bgra, format, packed );
+		break;
+	}
+
+	// unpack the rest a pixel at a time
+	int const size = GetFormatPixelSize( format );
+	for( ; i < count; ++i )
+		UnpackPixel( pixels + 4*i, pixelFormat, format, packed + size*i );
+}
+
+#else
+
+static void DecompressBlocks( u8 const* blocks, int count, int flags, u8* rgba, int stride )
+{
+	int const bytesPerBlock = ( ( flags & kDxt1 ) != 0 ) ? 8 : 16;
+	for( int b = 0; b < count; ++b, blocks += bytesPerBlock, rgba += 16 )
+	{
+		// decompress the block then copy out its rows
+		u8 block[16*4];
+		Decompress( block, blocks, flags );
+		for( int row = 0; row < 4; ++row )
+			std::memcpy( rgba + stride*row, block + 16*row, 16 );
+	}
+}
+
+static void FilterRows( float const* const* rows, float const* weights, int rowCount, int count, float* output )
+{
+	for( int i = 0; i < count; ++i )
+	{
+		float sum = 0.0f;
+		for( int r = 0; r < rowCount; ++r )
+			sum += weights[r]*rows[r][i];
+		output[i] = sum;
+	}
+}
+
+static void FilterPixels( float const* input, int const* starts, float const* weights, int tapCount, int count, float* output )
+{
+	for( int i = 0; i < count; ++i )
+	{
+		float const* source = input + 4*starts[i];
+		float const* pixelWeights = weights + tapCount*i;
+		for( int c = 0; c < 4; ++c )
+		{
+			float sum = 0.0f;
+			for( int t = 0; t < tapCount; ++t )
+				sum += pixelWeights[t]*source[4*t + c];
+			output[4*i + c] = sum;
+		}
+	}
+}
+
+
+static void PackPixels( u8 const* pixels, int count, int pixelFormat, int format, u8* packed )
+{
+	int const size = GetFormatPixelSize( format );
+	for( int i = 0; i < count; ++i )
+		PackPixel( pixels + 4*i, pixelFormat, format, packed + size*i );
+}
+
+static void UnpackPixels( u8* pixels, int count, int pixelFormat, int format, u8 const* packed )
+{
+	int const size = GetFormatPixelSize( format );
+	for( int i = 0; i < count; ++i )
+		UnpackPixel( pixels + 4*i, pixelFormat, format, packed + size*i );
+}
+
+#endif
+
+void InitialiseKernels( Kernels& kernels )
+{
+	kernels.ClusterFitSearch3 = &ClusterFitSearch3;
+	kernels.ClusterFitSearch4 = &ClusterFitSearch4;
+	kernels.FixedClusterFitSearch3 = &FixedClusterFitSearch3;
+	kernels.FixedClusterFitSearch4 = &FixedClusterFitSearch4;
+	kernels.MatchColours = &MatchColours;
+	kernels.UnpackColours = &UnpackColours;
+	kernels.GetSolidColour = &GetSolidColour;
+	kernels.MatchPixels = &MatchPixels;
+	kernels.FastFitColours = &FastFitColours;
+	kernels.FastFitAlphas = &FastFitAlphas;
+	kernels.FitAlphas = &FitAlphas;
+	kernels.RangeFitCovariance = &RangeFitCovariance;
+	kernels.RangeFitPrinciple = &RangeFitPrinciple;
+	kernels.RangeFitCodes = &RangeFitCodes;
+	kernels.DecompressBlocks = &DecompressBlocks;
+	kernels.FilterRows = &FilterRows;
+	kernels.FilterPixels = &FilterPixels;
+	kernels.PackPixels = &PackPixels;
+	kernels.UnpackPixels = &UnpackPixels;
+}
+
+} // namespace SQUISH_KERNEL_NAMESPACE
+} // namespace squish
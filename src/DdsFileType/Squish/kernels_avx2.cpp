@@ -0,0 +1,59 @@
+/* -----------------------------------------------------------------------------
+
+	Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files (the 
+	"Software"), to	deal in the Software without restriction, including
+	without limitation the rights to use, copy, modify, merge, publish,
+	distribute, sublicense, and/or sell copies of the Software, and to 
+	permit persons to whom the Software is furnished to do so, subject to 
+	the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+	
+   -------------------------------------------------------------------------- */
+   
+// build the kernels with AVX2 instructions
+#undef SQUISH_USE_ALTIVEC
+#define SQUISH_USE_ALTIVEC 0
+#undef SQUISH_USE_SSE
+#define SQUISH_USE_SSE 2
+#undef SQUISH_USE_AVX
+#define SQUISH_USE_AVX 1
+#define SQUISH_KERNEL_NAMESPACE avx2
+
+#include "config.h"
+
+#if SQUISH_USE_AVX2_KERNEL
+#include "kernels.inl"
+
+namespace squish {
+namespace avx2 {
+
+bool IsStateEnabled()
+{
+	// the OS must save the upper halves of the registers (XCR0 bits 1 and 2)
+#ifdef _MSC_VER
+	unsigned __int64 xcr0 = _xgetbv( 0 );
+#else
+	unsigned int lo, hi;
+	__asm__ __volatile__( "xgetbv" : "=a"( lo ), "=d"( hi ) : "c"( 0 ) );
+	unsigned long long xcr0 = lo | ( ( unsigned long long )hi << 32 );
+#endif
+	return ( xcr0 & 0x6 ) == 0x6;
+}
+
+} // namespace avx2
+} // namespace squish
+
+#endif
@@ -224,4 +224,51 @@ Vec3 ComputePrincipleComponent( Sym3x3 const& matrix )
 	}
 }
 
+Vec3 EstimatePrincipleComponent( Sym3x3 const& matrix )
+{
+	// scale the matrix by its trace so the largest eigenvalue is in [1/3,1]
+	float const trace = matrix[0] + matrix[3] + matrix[5];
+	if( !( 0.0f < trace ) )
+		return Vec3( 1.0f );
+	float const scale = 1.0f/trace;
+	Sym3x3 m;
+	for( int i = 0; i < 6; ++i )
+		m[i] = scale*matrix[i];
+
+	// square it so that each power iteration goes further
+	for( int i = 0; i < kPrincipleSquarings; ++i )
+	{
+		Sym3x3 s;
+		s[0] = m[0]*m[0] + m[1]*m[1] + m[2]*m[2];
+		s[1] = m[0]*m[1] + m[1]*m[3] + m[2]*m[4];
+		s[2] = m[0]*m[2] + m[1]*m[4] + m[2]*m[5];
+		s[3] = m[1]*m[1] + m[3]*m[3] + m[4]*m[4];
+		s[4] = m[1]*m[2] + m[3]*m[4] + m[4]*m[5];
+		s[5] = m[2]*m[2] + m[4]*m[4] + m[5]*m[5];
+		m = s;
+	}
+
+	// start from the column with the largest diagonal
+	float diagonal = m[0];
+	Vec3 v( m[0], m[1], m[2] );
+	if( diagonal < m[3] )
+	{
+		diagonal = m[3];
+		v = Vec3( m[1], m[3], m[4] );
+	}
+	if( diagonal < m[5] )
+		v = Vec3( m[2], m[4], m[5] );
+
+	// the eigenvalues are at most 1, so the vector only shrinks a little
+	for( int i = 0; i < kPrincipleIterations; ++i )
+	{
+		v = Vec3( 
+			m[0]*v.X() + m[1]*v.Y() + m[2]*v.Z(), 
+			m[1]*v.X() + m[3]*v.Y() + m[4]*v.Z(), 
+			m[2]*v.X() + m[4]*v.Y() + m[5]*v.Z()
+		);
+	}
+	return v;
+}
+
 } // namespace squish
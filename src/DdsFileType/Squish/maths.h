@@ -228,6 +228,23 @@ private:
 Sym3x3 ComputeWeightedCovariance( int n, Vec3 const* points, float const* weights );
 Vec3 ComputePrincipleComponent( Sym3x3 const& matrix );
 
+//! The steps of EstimatePrincipleComponent, which raise the matrix to the power 4*( 2 + 1 ).
+enum
+{
+	kPrincipleSquarings = 2,
+	kPrincipleIterations = 2
+};
+
+/*! @brief Estimates the principle component with a fixed number of power iterations.
+
+	This needs no trigonometry or roots, so it is cheaper than the exact 
+	solution and gives the same result for each lane of the range fit batch 
+	kernel. The result is not normalised. The matrix is squared 
+	kPrincipleSquarings times, and the iterations then start from its
+	column with the largest diagonal.
+*/
+Vec3 EstimatePrincipleComponent( Sym3x3 const& matrix );
+
 } // namespace squish
 
 #endif // ndef SQUISH_MATHS_H
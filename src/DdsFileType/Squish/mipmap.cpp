@@ -0,0 +1,181 @@
+/* -----------------------------------------------------------------------------
+
+	Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files (the 
+	"Software"), to	deal in the Software without restriction, including
+	without limitation the rights to use, copy, modify, merge, publish,
+	distribute, sublicense, and/or sell copies of the Software, and to 
+	permit persons to whom the Software is furnished to do so, subject to 
+	the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+	
+   -------------------------------------------------------------------------- */
+   
+#include "mipmap.h"
+#include <algorithm>
+#include <cmath>
+
+namespace squish {
+
+// the radius of the windowed sinc filters in target pixels, and the shape of the kaiser window
+static double const kSincRadius = 3.0;
+static double const kKaiserAlpha = 4.0;
+
+static double Sinc( double x )
+{
+	if( std::fabs( x ) < 1.0e-6 )
+		return 1.0;
+	double const px = 3.14159265358979323846*x;
+	return std::sin( px )/px;
+}
+
+static double BesselI0( double x )
+{
+	// sum the power series until the terms stop mattering
+	double sum = 1.0;
+	double term = 1.0;
+	for( int k = 1; k < 50; ++k )
+	{
+		double const half = x/( 2.0*k );
+		term *= half*half;
+		sum += term;
+		if( term < sum*1.0e-12 )
+			break;
+	}
+	return sum;
+}
+
+static double GetWeight( int filter, double x )
+{
+	// x is the distance from the target pixel centre in target pixels
+	double const ax = std::fabs( x );
+	if( ax >= kSincRadius )
+		return 0.0;
+	if( filter == kMipmapLanczos )
+		return Sinc( x )*Sinc( x/kSincRadius );
+	double const window = ax/kSincRadius;
+	return Sinc( x )*BesselI0( kKaiserAlpha*std::sqrt( 1.0 - window*window ) )/BesselI0( kKaiserAlpha );
+}
+
+MipmapTaps::MipmapTaps( int filter, int sourceSize, int targetSize )
+  : m_starts( targetSize )
+{
+	// find the source pixels that each target pixel reaches
+	double const scale = std::max( ( double )sourceSize/( double )targetSize, 1.0 );
+	double const radius = ( ( filter == kMipmapBox ) ? 0.5 : kSincRadius )*scale;
+	m_tapCount = 1;
+	for( int i = 0; i < targetSize; ++i )
+	{
+		double const centre = ( i + 0.5 )*sourceSize/( double )targetSize;
+		int const first = std::max( ( int )std::floor( centre - radius ), 0 );
+		int const end = std::min( ( int )std::ceil( centre + radius ), sourceSize );
+		m_tapCount = std::max( m_tapCount, end - first );
+	}
+	m_tapCount = std::min( m_tapCount, sourceSize );
+
+	// weight the taps, folding the ones off the edges onto the edge pixels
+	m_weights.resize( m_tapCount*targetSize, 0.0f );
+	std::vector< double > weights( m_tapCount );
+	for( int i = 0; i < targetSize; ++i )
+	{
+		double const centre = ( i + 0.5 )*sourceSize/( double )targetSize;
+		int const first = ( int )std::floor( centre - radius );
+		int const end = ( int )std::ceil( centre + radius );
+		int const start = std::min( std::max( first, 0 ), sourceSize - m_tapCount );
+		m_starts[i] = start;
+
+		std::fill( weights.begin(), weights.end(), 0.0 );
+		double total = 0.0;
+		for( int j = first; j < end; ++j )
+		{
+			double weight;
+			if( filter == kMipmapBox )
+			{
+				// the overlap of the source pixel with the target pixel
+				double const left = std::max( ( double )j, centre - radius );
+				double const right = std::min( ( double )( j + 1 ), centre + radius );
+				weight = std::max( right - left, 0.0 );
+			}
+			else
+				weight = GetWeight( filter, ( j + 0.5 - centre )/scale );
+
+			int const tap = std::min( std::max( j, 0 ), sourceSize - 1 ) - start;
+			weights[tap] += weight;
+			total += weight;
+		}
+		for( int t = 0; t < m_tapCount; ++t )
+			m_weights[m_tapCount*i + t] = ( float )( weights[t]/total );
+	}
+}
+
+static double SrgbToLinear( double value )
+{
+	if( value <= 0.04045 )
+		return value/12.92;
+	return std::pow( ( value + 0.055 )/1.055, 2.4 );
+}
+
+MipmapPixels::MipmapPixels( int mipmapFlags )
+  : m_gammaCorrect( ( mipmapFlags & kMipmapGammaCorrect ) != 0 ), 
+	m_weightByAlpha( ( mipmapFlags & kMipmapWeightByAlpha ) != 0 )
+{
+	// build the tables to and from linear light
+	for( int i = 0; i < 256; ++i )
+	{
+		double const value = i/255.0;
+		m_toLinear[i] = ( float )( 255.0*( m_gammaCorrect ? SrgbToLinear( value ) : value ) );
+	}
+	for( int i = 0; i < 255; ++i )
+	{
+		double const value = ( i + 0.5 )/255.0;
+		m_thresholds[i] = ( float )( 255.0*( m_gammaCorrect ? SrgbToLinear( value ) : value ) );
+	}
+}
+
+int MipmapPixels::FromLinear( float value ) const
+{
+	// count the codes that the value is past the middle of
+	return ( int )( std::upper_bound( m_thresholds, m_thresholds + 255, value ) - m_thresholds );
+}
+
+void MipmapPixels::ToValues( u8 const* rgba, int count, float* values ) const
+{
+	for( int i = 0; i < count; ++i, rgba += 4, values += 4 )
+	{
+		float const alpha = ( float )rgba[3];
+		float const weight = m_weightByAlpha ? alpha/255.0f : 1.0f;
+		for( int c = 0; c < 3; ++c )
+			values[c] = weight*m_toLinear[rgba[c]];
+		values[3] = alpha;
+	}
+}
+
+void MipmapPixels::ToRgba( float const* values, int count, u8* rgba ) const
+{
+	for( int i = 0; i < count; ++i, values += 4, rgba += 4 )
+	{
+		// undo the alpha weighting where there is any colour to recover
+		float const alpha = std::min( std::max( values[3], 0.0f ), 255.0f );
+		float const scale = ( m_weightByAlpha && alpha > 0.0f ) ? 255.0f/alpha : 1.0f;
+		for( int c = 0; c < 3; ++c )
+		{
+			float const value = std::min( std::max( scale*values[c], 0.0f ), 255.0f );
+			rgba[c] = ( u8 )( m_gammaCorrect ? FromLinear( value ) : ( int )( value + 0.5f ) );
+		}
+		rgba[3] = ( u8 )( int )( alpha + 0.5f );
+	}
+}
+
+} // namespace squish
@@ -0,0 +1,90 @@
+/* -----------------------------------------------------------------------------
+
+	Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files (the 
+	"Software"), to	deal in the Software without restriction, including
+	without limitation the rights to use, copy, modify, merge, publish,
+	distribute, sublicense, and/or sell copies of the Software, and to 
+	permit persons to whom the Software is furnished to do so, subject to 
+	the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+	
+   -------------------------------------------------------------------------- */
+   
+#ifndef SQUISH_MIPMAP_H
+#define SQUISH_MIPMAP_H
+
+#include <squish.h>
+#include <vector>
+
+namespace squish {
+
+/*! @brief The weights of a filter that resizes one axis of an image.
+
+	Each target pixel is a weighted sum of the same number of consecutive 
+	source pixels. Taps that fall off the edge of the image are folded back
+	onto the edge pixel, and the weights of each target pixel add up to 1.
+*/
+class MipmapTaps
+{
+public:
+	MipmapTaps( int filter, int sourceSize, int targetSize );
+
+	//! Gets the number of source pixels that each target pixel uses.
+	int GetTapCount() const { return m_tapCount; }
+	
+	//! Gets the first source pixel of each target pixel.
+	int const* GetStarts() const { return &m_starts[0]; }
+	
+	//! Gets the weights of each target pixel, GetTapCount() apart.
+	float const* GetWeights() const { return &m_weights[0]; }
+
+private:
+	int m_tapCount;
+	std::vector< int > m_starts;
+	std::vector< float > m_weights;
+};
+
+/*! @brief Converts between rgba pixels and the values mipmaps are filtered in.
+
+	The values are 4 floats per pixel in the range [0, 255], so that a box
+	filter of whole pixels sums them exactly. With gamma correction the 
+	colours are converted from sRGB to linear light and back again, and when
+	weighting by alpha the colours are multiplied by alpha for filtering 
+	then divided by it again afterwards.
+*/
+class MipmapPixels
+{
+public:
+	explicit MipmapPixels( int mipmapFlags );
+
+	//! Converts count rgba pixels to values.
+	void ToValues( u8 const* rgba, int count, float* values ) const;
+	
+	//! Converts count pixels of values back to rgba, rounding to the nearest.
+	void ToRgba( float const* values, int count, u8* rgba ) const;
+
+private:
+	int FromLinear( float value ) const;
+
+	bool m_gammaCorrect;
+	bool m_weightByAlpha;
+	float m_toLinear[256];
+	float m_thresholds[255];
+};
+
+} // namespace squish
+
+#endif // ndef SQUISH_MIPMAP_H
@@ -0,0 +1,181 @@
+/* -----------------------------------------------------------------------------
+
+	Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files (the 
+	"Software"), to	deal in the Software without restriction, including
+	without limitation the rights to use, copy, modify, merge, publish,
+	distribute, sublicense, and/or sell copies of the Software, and to 
+	permit persons to whom the Software is furnished to do so, subject to 
+	the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+	
+   -------------------------------------------------------------------------- */
+   
+#include <squish.h>
+
+#include "threadpool.h"
+#include "kernels.h"
+#include <algorithm>
+
+namespace squish {
+
+// the number of rows packed or unpacked at a time
+enum { kPackBandRows = 16 };
+
+int GetFormatPixelSize( int format )
+{
+	switch( format )
+	{
+	case kFormatA8R8G8B8:
+	case kFormatX8R8G8B8:
+	case kFormatA8B8G8R8:
+	case kFormatX8B8G8R8:
+		return 4;
+
+	case kFormatR8G8B8:
+		return 3;
+
+	case kFormatA1R5G5B5:
+	case kFormatA4R4G4B4:
+	case kFormatR5G6B5:
+		return 2;
+
+	default:
+		return 0;
+	}
+}
+
+class PackImageTask : public ParallelTask
+{
+public:
+	PackImageTask( u8* pixels, int width, int height, int stride, int pixelFormat, u8* packed, int pitch, int format, bool unpack, ProgressFn progressFn, int const volatile* cancel )
+	  : m_pixels( pixels ), 
+		m_width( width ), 
+		m_height( height ), 
+		m_stride( stride ), 
+		m_pixelFormat( pixelFormat ), 
+		m_packed( packed ), 
+		m_pitch( pitch ), 
+		m_format( format ), 
+		m_unpack( unpack ), 
+		m_progress( progressFn, height, height ), 
+		m_cancel( cancel ), 
+		m_cancelled( 0 )
+	{
+	}
+
+	int GetBandCount() const
+	{
+		return ( m_height + kPackBandRows - 1 )/kPackBandRows;
+	}
+
+	//! Returns true if any bands were skipped because of the cancel flag.
+	bool IsCancelled() const
+	{
+		return m_cancelled != 0;
+	}
+
+	virtual void Run( int band, int /*worker*/ )
+	{
+		// skip the band once the caller has given up
+		if( m_cancel != NULL && *m_cancel != 0 )
+		{
+			m_cancelled = 1;
+			return;
+		}
+
+		// convert the rows of this band
+		Kernels const& kernels = GetKernels();
+		int const y = kPackBandRows*band;
+		int const rows = std::min( ( int )kPackBandRows, m_height - y );
+		for( int row = y; row < y + rows; ++row )
+		{
+			u8* pixels = m_pixels + m_stride*row;
+			u8* packed = m_packed + m_pitch*row;
+			if( m_unpack )
+				kernels.UnpackPixels( pixels, m_width, m_pixelFormat, m_format, packed );
+			else
+				kernels.PackPixels( pixels, m_width, m_pixelFormat, m_format, packed );
+		}
+
+		// count the rows for the progress reports
+		m_progress.Add( rows );
+	}
+
+	virtual void Poll()
+	{
+		m_progress.Poll();
+	}
+
+private:
+	u8* m_pixels;
+	int m_width;
+	int m_height;
+	int m_stride;
+	int m_pixelFormat;
+	u8* m_packed;
+	int m_pitch;
+	int m_format;
+	bool m_unpack;
+	ProgressReporter m_progress;
+	int const volatile* m_cancel;
+	long volatile m_cancelled;
+};
+
+static int RunPackImageTask( PackImageTask& task, int height, ProgressFn progressFn )
+{
+	// keep the same kernels for every row of the image
+	KernelScope kernelScope;
+
+	if (progressFn != NULL)
+	{
+		progressFn(0, height);
+	}
+
+	// convert the bands on the pool
+	ParallelFor( task, task.GetBandCount(), GetWorkerCount() );
+	if( task.IsCancelled() )
+		return kStatusCancelled;
+
+	if (progressFn != NULL)
+	{
+		progressFn(height, height);
+	}
+	return kStatusOk;
+}
+
+int PackImage( u8 const* pixels, int width, int height, int stride, int pixelFormat, void* packed, int pitch, int format, ProgressFn progressFn, int const volatile* cancel )
+{
+	// fix any bad formats
+	if( GetFormatPixelSize( format ) == 0 )
+		format = kFormatA8R8G8B8;
+
+	// the task only reads the pixels when packing
+	PackImageTask task( const_cast< u8* >( pixels ), width, height, stride, pixelFormat, reinterpret_cast< u8* >( packed ), pitch, format, false, progressFn, cancel );
+	return RunPackImageTask( task, height, progressFn );
+}
+
+int UnpackImage( u8* pixels, int width, int height, int stride, int pixelFormat, void const* packed, int pitch, int format, ProgressFn progressFn, int const volatile* cancel )
+{
+	// fix any bad formats
+	if( GetFormatPixelSize( format ) == 0 )
+		format = kFormatA8R8G8B8;
+
+	// the task only reads the packed rows when unpacking
+	PackImageTask task( pixels, width, height, stride, pixelFormat, const_cast< u8* >( reinterpret_cast< u8 const* >( packed ) ), pitch, format, true, progressFn, cancel );
+	return RunPackImageTask( task, height, progressFn );
+}
+
+} // namespace squish
@@ -52,7 +52,8 @@ RangeFit::RangeFit( ColourSet const* colours, int flags )
 	Sym3x3 covariance = ComputeWeightedCovariance( count, values, weights );
 	
 	// compute the principle component
-	Vec3 principle = ComputePrincipleComponent( covariance );
+	Vec3 principle = ( ( m_flags & kColourPowerIteration ) != 0 ) 
+		? EstimatePrincipleComponent( covariance ) : ComputePrincipleComponent( covariance );
 
 	// get the min and max range as the codebook endpoints
 	Vec3 start( 0.0f );
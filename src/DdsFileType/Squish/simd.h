@@ -32,6 +32,9 @@
 #include "simd_ve.h"
 #elif SQUISH_USE_SSE
 #include "simd_sse.h"
+#if SQUISH_USE_AVX
+#include "simd_avx.h"
+#endif
 #else
 #include "simd_float.h"
 #endif
@@ -0,0 +1,131 @@
+/* -----------------------------------------------------------------------------
+
+	Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files (the 
+	"Software"), to	deal in the Software without restriction, including
+	without limitation the rights to use, copy, modify, merge, publish,
+	distribute, sublicense, and/or sell copies of the Software, and to 
+	permit persons to whom the Software is furnished to do so, subject to 
+	the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+	
+   -------------------------------------------------------------------------- */
+   
+#ifndef SQUISH_SIMD_AVX_H
+#define SQUISH_SIMD_AVX_H
+
+#include <immintrin.h>
+
+namespace squish {
+#ifdef SQUISH_KERNEL_NAMESPACE
+namespace SQUISH_KERNEL_NAMESPACE {
+#endif
+
+/*! @brief Two Vec4 values side by side in one AVX register.
+
+	Every operation works on both halves independently, with exactly the
+	same arithmetic as Vec4, so two candidate solutions can be scored per
+	instruction stream with bit-identical results.
+*/
+class Vec8
+{
+public:
+	typedef Vec8 const& Arg;
+
+	Vec8() {}
+		
+	explicit Vec8( __m256 v ) : m_v( v ) {}
+	
+	explicit Vec8( float s ) : m_v( _mm256_set1_ps( s ) ) {}
+	
+	Vec8( Vec4::Arg lo, Vec4::Arg hi ) 
+	  : m_v( _mm256_insertf128_ps( _mm256_castps128_ps256( lo.m_v ), hi.m_v, 1 ) ) {}
+	
+	Vec4 Lo() const { return Vec4( _mm256_castps256_ps128( m_v ) ); }
+	Vec4 Hi() const { return Vec4( _mm256_extractf128_ps( m_v, 1 ) ); }
+
+	Vec8 SplatX() const { return Vec8( _mm256_shuffle_ps( m_v, m_v, SQUISH_SSE_SPLAT( 0 ) ) ); }
+	Vec8 SplatY() const { return Vec8( _mm256_shuffle_ps( m_v, m_v, SQUISH_SSE_SPLAT( 1 ) ) ); }
+	Vec8 SplatZ() const { return Vec8( _mm256_shuffle_ps( m_v, m_v, SQUISH_SSE_SPLAT( 2 ) ) ); }
+	Vec8 SplatW() const { return Vec8( _mm256_shuffle_ps( m_v, m_v, SQUISH_SSE_SPLAT( 3 ) ) ); }
+
+	friend Vec8 operator+( Vec8::Arg left, Vec8::Arg right  )
+	{
+		return Vec8( _mm256_add_ps( left.m_v, right.m_v ) );
+	}
+	
+	friend Vec8 operator-( Vec8::Arg left, Vec8::Arg right  )
+	{
+		return Vec8( _mm256_sub_ps( left.m_v, right.m_v ) );
+	}
+	
+	friend Vec8 operator*( Vec8::Arg left, Vec8::Arg right  )
+	{
+		return Vec8( _mm256_mul_ps( left.m_v, right.m_v ) );
+	}
+	
+	//! Returns a*b + c (deliberately not fused, to match Vec4)
+	friend Vec8 MultiplyAdd( Vec8::Arg a, Vec8::Arg b, Vec8::Arg c )
+	{
+		return Vec8( _mm256_add_ps( _mm256_mul_ps( a.m_v, b.m_v ), c.m_v ) );
+	}
+	
+	//! Returns -( a*b - c )
+	friend Vec8 NegativeMultiplySubtract( Vec8::Arg a, Vec8::Arg b, Vec8::Arg c )
+	{
+		return Vec8( _mm256_sub_ps( c.m_v, _mm256_mul_ps( a.m_v, b.m_v ) ) );
+	}
+	
+	friend Vec8 Reciprocal( Vec8::Arg v )
+	{
+		// get the reciprocal estimate
+		__m256 estimate = _mm256_rcp_ps( v.m_v );
+
+		// one round of Newton-Rhaphson refinement
+		__m256 diff = _mm256_sub_ps( _mm256_set1_ps( 1.0f ), _mm256_mul_ps( estimate, v.m_v ) );
+		return Vec8( _mm256_add_ps( _mm256_mul_ps( diff, estimate ), estimate ) );
+	}
+	
+	friend Vec8 Min( Vec8::Arg left, Vec8::Arg right )
+	{
+		return Vec8( _mm256_min_ps( left.m_v, right.m_v ) );
+	}
+	
+	friend Vec8 Max( Vec8::Arg left, Vec8::Arg right )
+	{
+		return Vec8( _mm256_max_ps( left.m_v, right.m_v ) );
+	}
+	
+	friend Vec8 Truncate( Vec8::Arg v )
+	{
+		return Vec8( _mm256_cvtepi32_ps( _mm256_cvttps_epi32( v.m_v ) ) );
+	}
+	
+	//! Returns a bit per component that is set where left < right.
+	friend int CompareLessThanMask( Vec8::Arg left, Vec8::Arg right ) 
+	{
+		return _mm256_movemask_ps( _mm256_cmp_ps( left.m_v, right.m_v, _CMP_LT_OQ ) );
+	}
+	
+private:
+	__m256 m_v;
+};
+
+#ifdef SQUISH_KERNEL_NAMESPACE
+} // namespace SQUISH_KERNEL_NAMESPACE
+#endif
+} // namespace squish
+
+#endif // ndef SQUISH_SIMD_AVX_H
@@ -29,6 +29,9 @@
 #include <algorithm>
 
 namespace squish {
+#ifdef SQUISH_KERNEL_NAMESPACE
+namespace SQUISH_KERNEL_NAMESPACE {
+#endif
 
 #define VEC4_CONST( X ) Vec4( X )
 
@@ -60,6 +63,14 @@ public:
 		return Vec3( m_x, m_y, m_z );
 	}
 	
+	void Store( float* values ) const
+	{
+		values[0] = m_x;
+		values[1] = m_y;
+		values[2] = m_z;
+		values[3] = m_w;
+	}
+	
 	Vec4 SplatX() const { return Vec4( m_x ); }
 	Vec4 SplatY() const { return Vec4( m_y ); }
 	Vec4 SplatZ() const { return Vec4( m_z ); }
@@ -170,6 +181,26 @@ public:
 			|| left.m_w < right.m_w;
 	}
 	
+	friend Vec4 CompareLessThan( Vec4::Arg left, Vec4::Arg right ) 
+	{
+		return Vec4( 
+			left.m_x < right.m_x ? 1.0f : 0.0f, 
+			left.m_y < right.m_y ? 1.0f : 0.0f, 
+			left.m_z < right.m_z ? 1.0f : 0.0f, 
+			left.m_w < right.m_w ? 1.0f : 0.0f 
+		);
+	}
+	
+	friend Vec4 Select( Vec4::Arg mask, Vec4::Arg a, Vec4::Arg b ) 
+	{
+		return Vec4( 
+			mask.m_x != 0.0f ? a.m_x : b.m_x, 
+			mask.m_y != 0.0f ? a.m_y : b.m_y, 
+			mask.m_z != 0.0f ? a.m_z : b.m_z, 
+			mask.m_w != 0.0f ? a.m_w : b.m_w 
+		);
+	}
+	
 private:
 	float m_x;
 	float m_y;
@@ -177,6 +208,9 @@ private:
 	float m_w;
 };
 
+#ifdef SQUISH_KERNEL_NAMESPACE
+} // namespace SQUISH_KERNEL_NAMESPACE
+#endif
 } // namespace squish
 
 #endif // ndef SQUISH_SIMD_FLOAT_H
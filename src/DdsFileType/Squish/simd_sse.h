@@ -38,6 +38,9 @@
 	( ( x ) | ( ( y ) << 2 ) | ( ( z ) << 4 ) | ( ( w ) << 6 ) )
 
 namespace squish {
+#ifdef SQUISH_KERNEL_NAMESPACE
+namespace SQUISH_KERNEL_NAMESPACE {
+#endif
 
 #define VEC4_CONST( X ) Vec4( X )
 
@@ -73,6 +76,11 @@ public:
 		return Vec3( c[0], c[1], c[2] );
 	}
 	
+	void Store( float* values ) const
+	{
+		_mm_storeu_ps( values, m_v );
+	}
+	
 	Vec4 SplatX() const { return Vec4( _mm_shuffle_ps( m_v, m_v, SQUISH_SSE_SPLAT( 0 ) ) ); }
 	Vec4 SplatY() const { return Vec4( _mm_shuffle_ps( m_v, m_v, SQUISH_SSE_SPLAT( 1 ) ) ); }
 	Vec4 SplatZ() const { return Vec4( _mm_shuffle_ps( m_v, m_v, SQUISH_SSE_SPLAT( 2 ) ) ); }
@@ -171,10 +179,25 @@ public:
 		return value != 0;
 	}
 	
+	friend Vec4 CompareLessThan( Vec4::Arg left, Vec4::Arg right ) 
+	{
+		return Vec4( _mm_cmplt_ps( left.m_v, right.m_v ) );
+	}
+	
+	friend Vec4 Select( Vec4::Arg mask, Vec4::Arg a, Vec4::Arg b ) 
+	{
+		return Vec4( _mm_or_ps( _mm_and_ps( mask.m_v, a.m_v ), _mm_andnot_ps( mask.m_v, b.m_v ) ) );
+	}
+	
 private:
+	friend class Vec8;
+
 	__m128 m_v;
 };
 
+#ifdef SQUISH_KERNEL_NAMESPACE
+} // namespace SQUISH_KERNEL_NAMESPACE
+#endif
 } // namespace squish
 
 #endif // ndef SQUISH_SIMD_SSE_H
@@ -30,6 +30,9 @@
 #undef bool
 
 namespace squish {
+#ifdef SQUISH_KERNEL_NAMESPACE
+namespace SQUISH_KERNEL_NAMESPACE {
+#endif
 
 #define VEC4_CONST( X ) Vec4( ( vector float )( X ) )
 
@@ -77,6 +80,14 @@ public:
 		return Vec3( u.c[0], u.c[1], u.c[2] );
 	}
 	
+	void Store( float* values ) const
+	{
+		union { vector float v; float c[4]; } u;
+		u.v = m_v;
+		for( int i = 0; i < 4; ++i )
+			values[i] = u.c[i];
+	}
+	
 	Vec4 SplatX() const { return Vec4( vec_splat( m_v, 0 ) ); }
 	Vec4 SplatY() const { return Vec4( vec_splat( m_v, 1 ) ); }
 	Vec4 SplatZ() const { return Vec4( vec_splat( m_v, 2 ) ); }
@@ -157,10 +168,23 @@ public:
 		return vec_any_lt( left.m_v, right.m_v ) != 0;
 	}
 	
+	friend Vec4 CompareLessThan( Vec4::Arg left, Vec4::Arg right ) 
+	{
+		return Vec4( ( vector float )vec_cmplt( left.m_v, right.m_v ) );
+	}
+	
+	friend Vec4 Select( Vec4::Arg mask, Vec4::Arg a, Vec4::Arg b ) 
+	{
+		return Vec4( vec_sel( b.m_v, a.m_v, ( vector bool int )mask.m_v ) );
+	}
+	
 private:
 	vector float m_v;
 };
 
+#ifdef SQUISH_KERNEL_NAMESPACE
+} // namespace SQUISH_KERNEL_NAMESPACE
+#endif
 } // namespace squish
 
 #endif // ndef SQUISH_SIMD_VE_H
@@ -0,0 +1,259 @@
+static SingleAlphaLookup const lookup_alpha[] = 
+{
+	{ 0, 5, 0 },
+	{ 1, 6, 0 },
+	{ 2, 7, 0 },
+	{ 3, 8, 0 },
+	{ 4, 9, 0 },
+	{ 5, 10, 0 },
+	{ 6, 11, 0 },
+	{ 7, 12, 0 },
+	{ 8, 13, 0 },
+	{ 9, 14, 0 },
+	{ 10, 15, 0 },
+	{ 11, 16, 0 },
+	{ 12, 17, 0 },
+	{ 13, 18, 0 },
+	{ 14, 19, 0 },
+	{ 15, 20, 0 },
+	{ 16, 21, 0 },
+	{ 17, 22, 0 },
+	{ 18, 23, 0 },
+	{ 19, 24, 0 },
+	{ 20, 25, 0 },
+	{ 21, 26, 0 },
+	{ 22, 27, 0 },
+	{ 23, 28, 0 },
+	{ 24, 29, 0 },
+	{ 25, 30, 0 },
+	{ 26, 31, 0 },
+	{ 27, 32, 0 },
+	{ 28, 33, 0 },
+	{ 29, 34, 0 },
+	{ 30, 35, 0 },
+	{ 31, 36, 0 },
+	{ 32, 37, 0 },
+	{ 33, 38, 0 },
+	{ 34, 39, 0 },
+	{ 35, 40, 0 },
+	{ 36, 41, 0 },
+	{ 37, 42, 0 },
+	{ 38, 43, 0 },
+	{ 39, 44, 0 },
+	{ 40, 45, 0 },
+	{ 41, 46, 0 },
+	{ 42, 47, 0 },
+	{ 43, 48, 0 },
+	{ 44, 49, 0 },
+	{ 45, 50, 0 },
+	{ 46, 51, 0 },
+	{ 47, 52, 0 },
+	{ 48, 53, 0 },
+	{ 49, 54, 0 },
+	{ 50, 55, 0 },
+	{ 51, 56, 0 },
+	{ 52, 57, 0 },
+	{ 53, 58, 0 },
+	{ 54, 59, 0 },
+	{ 55, 60, 0 },
+	{ 56, 61, 0 },
+	{ 57, 62, 0 },
+	{ 58, 63, 0 },
+	{ 59, 64, 0 },
+	{ 60, 65, 0 },
+	{ 61, 66, 0 },
+	{ 62, 67, 0 },
+	{ 63, 68, 0 },
+	{ 64, 69, 0 },
+	{ 65, 70, 0 },
+	{ 66, 71, 0 },
+	{ 67, 72, 0 },
+	{ 68, 73, 0 },
+	{ 69, 74, 0 },
+	{ 70, 75, 0 },
+	{ 71, 76, 0 },
+	{ 72, 77, 0 },
+	{ 73, 78, 0 },
+	{ 74, 79, 0 },
+	{ 75, 80, 0 },
+	{ 76, 81, 0 },
+	{ 77, 82, 0 },
+	{ 78, 83, 0 },
+	{ 79, 84, 0 },
+	{ 80, 85, 0 },
+	{ 81, 86, 0 },
+	{ 82, 87, 0 },
+	{ 83, 88, 0 },
+	{ 84, 89, 0 },
+	{ 85, 90, 0 },
+	{ 86, 91, 0 },
+	{ 87, 92, 0 },
+	{ 88, 93, 0 },
+	{ 89, 94, 0 },
+	{ 90, 95, 0 },
+	{ 91, 96, 0 },
+	{ 92, 97, 0 },
+	{ 93, 98, 0 },
+	{ 94, 99, 0 },
+	{ 95, 100, 0 },
+	{ 96, 101, 0 },
+	{ 97, 102, 0 },
+	{ 98, 103, 0 },
+	{ 99, 104, 0 },
+	{ 100, 105, 0 },
+	{ 101, 106, 0 },
+	{ 102, 107, 0 },
+	{ 103, 108, 0 },
+	{ 104, 109, 0 },
+	{ 105, 110, 0 },
+	{ 106, 111, 0 },
+	{ 107, 112, 0 },
+	{ 108, 113, 0 },
+	{ 109, 114, 0 },
+	{ 110, 115, 0 },
+	{ 111, 116, 0 },
+	{ 112, 117, 0 },
+	{ 113, 118, 0 },
+	{ 114, 119, 0 },
+	{ 115, 120, 0 },
+	{ 116, 121, 0 },
+	{ 117, 122, 0 },
+	{ 118, 123, 0 },
+	{ 119, 124, 0 },
+	{ 120, 125, 0 },
+	{ 121, 126, 0 },
+	{ 122, 127, 0 },
+	{ 123, 128, 0 },
+	{ 124, 129, 0 },
+	{ 125, 130, 0 },
+	{ 126, 131, 0 },
+	{ 127, 132, 0 },
+	{ 128, 133, 0 },
+	{ 129, 134, 0 },
+	{ 130, 135, 0 },
+	{ 131, 136, 0 },
+	{ 132, 137, 0 },
+	{ 133, 138, 0 },
+	{ 134, 139, 0 },
+	{ 135, 140, 0 },
+	{ 136, 141, 0 },
+	{ 137, 142, 0 },
+	{ 138, 143, 0 },
+	{ 139, 144, 0 },
+	{ 140, 145, 0 },
+	{ 141, 146, 0 },
+	{ 142, 147, 0 },
+	{ 143, 148, 0 },
+	{ 144, 149, 0 },
+	{ 145, 150, 0 },
+	{ 146, 151, 0 },
+	{ 147, 152, 0 },
+	{ 148, 153, 0 },
+	{ 149, 154, 0 },
+	{ 150, 155, 0 },
+	{ 151, 156, 0 },
+	{ 152, 157, 0 },
+	{ 153, 158, 0 },
+	{ 154, 159, 0 },
+	{ 155, 160, 0 },
+	{ 156, 161, 0 },
+	{ 157, 162, 0 },
+	{ 158, 163, 0 },
+	{ 159, 164, 0 },
+	{ 160, 165, 0 },
+	{ 161, 166, 0 },
+	{ 162, 167, 0 },
+	{ 163, 168, 0 },
+	{ 164, 169, 0 },
+	{ 165, 170, 0 },
+	{ 166, 171, 0 },
+	{ 167, 172, 0 },
+	{ 168, 173, 0 },
+	{ 169, 174, 0 },
+	{ 170, 175, 0 },
+	{ 171, 176, 0 },
+	{ 172, 177, 0 },
+	{ 173, 178, 0 },
+	{ 174, 179, 0 },
+	{ 175, 180, 0 },
+	{ 176, 181, 0 },
+	{ 177, 182, 0 },
+	{ 178, 183, 0 },
+	{ 179, 184, 0 },
+	{ 180, 185, 0 },
+	{ 181, 186, 0 },
+	{ 182, 187, 0 },
+	{ 183, 188, 0 },
+	{ 184, 189, 0 },
+	{ 185, 190, 0 },
+	{ 186, 191, 0 },
+	{ 187, 192, 0 },
+	{ 188, 193, 0 },
+	{ 189, 194, 0 },
+	{ 190, 195, 0 },
+	{ 191, 196, 0 },
+	{ 192, 197, 0 },
+	{ 193, 198, 0 },
+	{ 194, 199, 0 },
+	{ 195, 200, 0 },
+	{ 196, 201, 0 },
+	{ 197, 202, 0 },
+	{ 198, 203, 0 },
+	{ 199, 204, 0 },
+	{ 200, 205, 0 },
+	{ 201, 206, 0 },
+	{ 202, 207, 0 },
+	{ 203, 208, 0 },
+	{ 204, 209, 0 },
+	{ 205, 210, 0 },
+	{ 206, 211, 0 },
+	{ 207, 212, 0 },
+	{ 208, 213, 0 },
+	{ 209, 214, 0 },
+	{ 210, 215, 0 },
+	{ 211, 216, 0 },
+	{ 212, 217, 0 },
+	{ 213, 218, 0 },
+	{ 214, 219, 0 },
+	{ 215, 220, 0 },
+	{ 216, 221, 0 },
+	{ 217, 222, 0 },
+	{ 218, 223, 0 },
+	{ 219, 224, 0 },
+	{ 220, 225, 0 },
+	{ 221, 226, 0 },
+	{ 222, 227, 0 },
+	{ 223, 228, 0 },
+	{ 224, 229, 0 },
+	{ 225, 230, 0 },
+	{ 226, 231, 0 },
+	{ 227, 232, 0 },
+	{ 228, 233, 0 },
+	{ 229, 234, 0 },
+	{ 230, 235, 0 },
+	{ 231, 236, 0 },
+	{ 232, 237, 0 },
+	{ 233, 238, 0 },
+	{ 234, 239, 0 },
+	{ 235, 240, 0 },
+	{ 236, 241, 0 },
+	{ 237, 242, 0 },
+	{ 238, 243, 0 },
+	{ 239, 244, 0 },
+	{ 240, 245, 0 },
+	{ 241, 246, 0 },
+	{ 242, 247, 0 },
+	{ 243, 248, 0 },
+	{ 244, 249, 0 },
+	{ 245, 250, 0 },
+	{ 246, 251, 0 },
+	{ 247, 252, 0 },
+	{ 248, 253, 0 },
+	{ 249, 254, 0 },
+	{ 250, 255, 0 },
+	{ 250, 255, 2 },
+	{ 250, 255, 3 },
+	{ 250, 255, 4 },
+	{ 250, 255, 5 },
+	{ 0, 5, 7 }
+};
@@ -169,4 +169,94 @@ void SingleColourFit::ComputeEndPoints( SingleColourLookup const* const* lookups
 	}
 }
 
+static int GetSingleColourEndPoints( u8 const* colour, SingleColourLookup const* const* lookups, int* endPoints, int& index )
+{
+	// pick the codebook index as ComputeEndPoints does, with the end points packed as 5:6:5
+	int const shifts[3] = { 11, 5, 0 };
+	int besterror = INT_MAX;
+	for( int i = 0; i < 2; ++i )
+	{
+		int start = 0;
+		int end = 0;
+		int error = 0;
+		for( int channel = 0; channel < 3; ++channel )
+		{
+			SourceBlock const& source = lookups[channel][colour[channel]].sources[i];
+			start |= source.start << shifts[channel];
+			end |= source.end << shifts[channel];
+			error += source.error*source.error;
+		}
+		if( error < besterror )
+		{
+			endPoints[0] = start;
+			endPoints[1] = end;
+			index = 2*i;
+			besterror = error;
+		}
+	}
+	return besterror;
+}
+
+void CompressSingleColour( u8 const* colour, int mask, int flags, void* block )
+{
+	u8* bytes = reinterpret_cast< u8* >( block );
+	bool const isDxt1 = ( ( flags & kDxt1 ) != 0 );
+	int a = 0;
+	int b = 0;
+	int index = 3;
+	int masked = 3;
+	if( !( isDxt1 && colour[3] < 128 ) )
+	{
+		// get the end points of both modes, the three colour one only for dxt1
+		SingleColourLookup const* const lookups3[] = { lookup_5_3, lookup_6_3, lookup_5_3 };
+		SingleColourLookup const* const lookups4[] = { lookup_5_4, lookup_6_4, lookup_5_4 };
+		int endPoints3[2];
+		int endPoints4[2];
+		int index3 = 0;
+		int index4 = 0;
+		int const error3 = isDxt1 ? GetSingleColourEndPoints( colour, lookups3, endPoints3, index3 ) : INT_MAX;
+		int const error4 = GetSingleColourEndPoints( colour, lookups4, endPoints4, index4 );
+
+		// order the end points as WriteColourBlock3 and WriteColourBlock4 do
+		if( error3 <= error4 )
+		{
+			a = endPoints3[0];
+			b = endPoints3[1];
+			index = index3;
+			if( a > b )
+			{
+				std::swap( a, b );
+				index = ( index == 0 ) ? 1 : index;
+			}
+		}
+		else
+		{
+			a = endPoints4[0];
+			b = endPoints4[1];
+			index = index4;
+			if( a < b )
+			{
+				std::swap( a, b );
+				index ^= 1;
+				masked ^= 1;
+			}
+			else if( a == b )
+				index = masked = 0;
+		}
+	}
+
+	// write the end points and the indices with 2 bits each
+	bytes[0] = ( u8 )( a & 0xff );
+	bytes[1] = ( u8 )( a >> 8 );
+	bytes[2] = ( u8 )( b & 0xff );
+	bytes[3] = ( u8 )( b >> 8 );
+	for( int i = 0; i < 4; ++i )
+	{
+		int value = 0;
+		for( int j = 0; j < 4; ++j )
+			value |= ( ( ( mask & ( 1 << ( 4*i + j ) ) ) != 0 ) ? index : masked ) << 2*j;
+		bytes[4 + i] = ( u8 )value;
+	}
+}
+
 } // namespace squish
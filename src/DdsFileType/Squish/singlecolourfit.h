@@ -53,6 +53,14 @@ private:
 	int m_besterror;
 };
 
+/*! @brief Compresses a block whose valid pixels all have the same colour.
+
+	Writes the block that a SingleColourFit of the colour set would, straight
+	from the lookup tables. In DXT1 a colour with alpha below 128 leaves no
+	colours to fit, so the block is written as transparent.
+*/
+void CompressSingleColour( u8 const* colour, int mask, int flags, void* block );
+
 } // namespace squish
 
 #endif // ndef SQUISH_SINGLECOLOURFIT_H
@@ -25,60 +25,82 @@
    
 #include <squish.h>
 
-#ifdef SQUISH_USE_OPENMP
-#include <omp.h>
-#endif
-
 #include "colourset.h"
 #include "maths.h"
 #include "rangefit.h"
 #include "clusterfit.h"
+#include "fixedclusterfit.h"
 #include "colourblock.h"
 #include "alpha.h"
 #include "singlecolourfit.h"
+#include "threadpool.h"
+#include "kernels.h"
+#include "blockcache.h"
+#include "mipmap.h"
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
 
 namespace squish {
 
+// the effort level of kColourAdaptiveFit is stored from this bit up
+enum { kEffortShift = 12, kMaxEffort = 5 };
+
 static int FixFlags( int flags )
 {
 	// grab the flag bits
 	int method = flags & ( kDxt1 | kDxt3 | kDxt5 );
-	int fit = flags & ( kColourIterativeClusterFit | kColourClusterFit | kColourRangeFit );
+	int fit = flags & ( kColourIterativeClusterFit | kColourClusterFit | kColourRangeFit | kColourAdaptiveFit | kColourFastFit );
 	int metric = flags & ( kColourMetricPerceptual | kColourMetricUniform );
-	int extra = flags & kWeightColourByAlpha;
+	int extra = flags & ( kWeightColourByAlpha | kColourFixedPoint | kColourPowerIteration | kAlphaIterativeFit );
 	
 	// set defaults
 	if( method != kDxt3 && method != kDxt5 )
 		method = kDxt1;
-	if( ( fit != kColourRangeFit ) && ( fit != kColourIterativeClusterFit ) ) 
+	if( ( fit != kColourRangeFit ) && ( fit != kColourIterativeClusterFit ) && ( fit != kColourAdaptiveFit ) && ( fit != kColourFastFit ) ) 
 		fit = kColourClusterFit;
 	if( metric != kColourMetricUniform )
 		metric = kColourMetricPerceptual;
+
+	// keep the effort level of an adaptive fit
+	if( fit == kColourAdaptiveFit )
+		fit |= std::min( ( flags & kColourEffortMask ) >> kEffortShift, ( int )kMaxEffort ) << kEffortShift;
 		
 	// done
 	return method | fit | metric | extra;
 }
 
+int GetEffortFlags( int effort )
+{
+	effort = std::max( 0, std::min( effort, ( int )kMaxEffort ) );
+	return kColourAdaptiveFit | ( effort << kEffortShift );
+}
+
 void Compress( u8 const* rgba, void* block, int flags )
 {
 	// compress with full mask
 	CompressMasked( rgba, 0xffff, block, flags );
 }
 
-void CompressMasked( u8 const* rgba, int mask, void* block, int flags )
+static void CompressClusterFit( ColourSet const& colours, int flags, void* colourBlock )
 {
-	// fix any bad flags
-	flags = FixFlags( flags );
-
-	// get the block locations
-	void* colourBlock = block;
-	void* alphaBock = block;
-	if( ( flags & ( kDxt3 | kDxt5 ) ) != 0 )
-		colourBlock = reinterpret_cast< u8* >( block ) + 8;
+	// the fixed point fit gives the same block whatever the floating point model
+	if( ( flags & kColourFixedPoint ) != 0 )
+	{
+		FixedClusterFit fit( &colours, flags );
+		fit.Compress( colourBlock );
+	}
+	else
+	{
+		ClusterFit fit( &colours, flags );
+		fit.Compress( colourBlock );
+	}
+}
 
-	// create the minimal point set
-	ColourSet colours( rgba, mask, flags );
-	
+static void CompressColour( ColourSet const& colours, int flags, void* colourBlock )
+{
 	// check the compression type and compress colour
 	if( colours.GetCount() == 1 )
 	{
@@ -95,15 +117,326 @@ void CompressMasked( u8 const* rgba, int mask, void* block, int flags )
 	else
 	{
 		// default to a cluster fit (could be iterative or not)
-		ClusterFit fit( &colours, flags );
-		fit.Compress( colourBlock );
+		CompressClusterFit( colours, flags, colourBlock );
+	}
+}
+
+static void CompressFastBlocks( u8 const* rgba, int const* masks, int count, void* blocks, int flags )
+{
+	// the fast fit works on the pixels directly, without the colour sets
+	Kernels const& kernels = GetKernels();
+	u8* bytes = reinterpret_cast< u8* >( blocks );
+	if( ( flags & kDxt1 ) != 0 )
+	{
+		kernels.FastFitColours( rgba, masks, count, true, bytes, 8, NULL );
+		return;
+	}
+	kernels.FastFitColours( rgba, masks, count, false, bytes + 8, 16, NULL );
+	if( ( flags & kDxt3 ) != 0 )
+	{
+		for( int b = 0; b < count; ++b )
+			CompressAlphaDxt3( rgba + 64*b, masks[b], bytes + 16*b );
+	}
+	else
+		kernels.FastFitAlphas( rgba, masks, count, bytes, 16 );
+}
+
+// the squared RGB error of a fast fit block over which each effort level compresses it again
+static int const g_effortThresholds[kMaxEffort + 1] = { 6400, 3200, 1600, 800, 400, 200 };
+
+// the number of blocks whose fast fit errors are kept at once
+enum { kAdaptiveBlocks = 64 };
+
+static void CompressAdaptiveBlocks( u8 const* rgba, int const* masks, int count, void* blocks, int flags )
+{
+	Kernels const& kernels = GetKernels();
+	bool const isDxt1 = ( ( flags & kDxt1 ) != 0 );
+	int const bytesPerBlock = isDxt1 ? 8 : 16;
+	u8* colourBlocks = reinterpret_cast< u8* >( blocks ) + ( isDxt1 ? 0 : 8 );
+	int const threshold = g_effortThresholds[( flags & kColourEffortMask ) >> kEffortShift];
+	int const clusterFlags = ( flags & ~( kColourAdaptiveFit | kColourEffortMask ) ) | kColourClusterFit;
+
+	// fast fit the colour, then compress the blocks it fits badly again with the cluster fit
+	int errors[kAdaptiveBlocks];
+	for( int first = 0; first < count; first += kAdaptiveBlocks )
+	{
+		int const runCount = std::min( count - first, ( int )kAdaptiveBlocks );
+		kernels.FastFitColours( rgba + 64*first, masks + first, runCount, isDxt1, colourBlocks + bytesPerBlock*first, bytesPerBlock, errors );
+		for( int b = 0; b < runCount; ++b )
+		{
+			if( errors[b] <= threshold )
+				continue;
+			int const n = first + b;
+			ColourSet colours( rgba + 64*n, masks[n], clusterFlags );
+			CompressColour( colours, clusterFlags, colourBlocks + bytesPerBlock*n );
+		}
+	}
+
+	// fit alpha as the other colour fits do
+	u8* bytes = reinterpret_cast< u8* >( blocks );
+	if( ( flags & kDxt3 ) != 0 )
+	{
+		for( int n = 0; n < count; ++n )
+			CompressAlphaDxt3( rgba + 64*n, masks[n], bytes + 16*n );
+	}
+	else if( ( flags & kDxt5 ) != 0 )
+		kernels.FitAlphas( rgba, masks, count, ( flags & kAlphaIterativeFit ) != 0, bytes, 16 );
+}
+
+static void CompressSolidBlock( u8 const* rgba, u8 const* colour, int mask, int flags, void* block )
+{
+	// write the colour and alpha of a solid block straight from the lookup tables
+	u8* bytes = reinterpret_cast< u8* >( block );
+	if( ( flags & kDxt1 ) != 0 )
+	{
+		CompressSingleColour( colour, mask, flags, bytes );
+		return;
+	}
+	CompressSingleColour( colour, mask, flags, bytes + 8 );
+	if( ( flags & kDxt3 ) != 0 )
+		CompressAlphaDxt3( rgba, mask, bytes );
+	else
+		CompressSingleAlphaDxt5( colour[3], mask, bytes );
+}
+
+void CompressMasked( u8 const* rgba, int mask, void* block, int flags )
+{
+	// fix any bad flags
+	flags = FixFlags( flags );
+	if( ( flags & kColourFastFit ) != 0 )
+	{
+		CompressFastBlocks( rgba, &mask, 1, block, flags );
+		return;
+	}
+	if( ( flags & kColourAdaptiveFit ) != 0 )
+	{
+		CompressAdaptiveBlocks( rgba, &mask, 1, block, flags );
+		return;
+	}
+
+	// solid blocks need no colour set
+	u8 colour[4];
+	if( GetKernels().GetSolidColour( rgba, mask, colour ) )
+	{
+		CompressSolidBlock( rgba, colour, mask, flags, block );
+		return;
 	}
+
+	// get the block locations
+	void* colourBlock = block;
+	void* alphaBock = block;
+	if( ( flags & ( kDxt3 | kDxt5 ) ) != 0 )
+		colourBlock = reinterpret_cast< u8* >( block ) + 8;
+
+	// create the minimal point set
+	ColourSet colours( rgba, mask, flags );
+	
+	// compress colour
+	CompressColour( colours, flags, colourBlock );
 	
 	// compress alpha separately if necessary
 	if( ( flags & kDxt3 ) != 0 )
 		CompressAlphaDxt3( rgba, mask, alphaBock );
 	else if( ( flags & kDxt5 ) != 0 )
-		CompressAlphaDxt5( rgba, mask, alphaBock );
+		CompressAlphaDxt5( rgba, mask, alphaBock, ( flags & kAlphaIterativeFit ) != 0 );
+}
+
+// the number of blocks that share the lanes of one batch
+enum { kBatchBlocks = 4 };
+
+static void CompressColourBatch( ColourSet const* colours, u8* const* colourBlocks, int count, int flags )
+{
+	Kernels const& kernels = GetKernels();
+	bool const isDxt1 = ( ( flags & kDxt1 ) != 0 );
+
+	// set up the range fit for the blocks with several colours
+	RangeFitBatch batch;
+	std::memset( &batch, 0, sizeof( batch ) );
+	batch.dxt1 = isDxt1;
+	if( ( flags & kColourMetricPerceptual ) != 0 )
+	{
+		batch.metric[0] = 0.2126f;
+		batch.metric[1] = 0.7152f;
+		batch.metric[2] = 0.0722f;
+	}
+	else
+		batch.metric[0] = batch.metric[1] = batch.metric[2] = 1.0f;
+
+	int lanes[kBatchBlocks];
+	int laneCount = 0;
+	for( int b = 0; b < count; ++b )
+	{
+		int const pointCount = colours[b].GetCount();
+		if( pointCount <= 1 )
+		{
+			// single colours and empty blocks have their own fits
+			CompressColour( colours[b], flags, colourBlocks[b] );
+			continue;
+		}
+
+		// copy the points into the next lane
+		int const lane = laneCount++;
+		lanes[lane] = b;
+		Vec3 const* points = colours[b].GetPoints();
+		float const* weights = colours[b].GetWeights();
+		for( int i = 0; i < pointCount; ++i )
+		{
+			batch.points[i][0][lane] = points[i].X();
+			batch.points[i][1][lane] = points[i].Y();
+			batch.points[i][2][lane] = points[i].Z();
+			batch.weights[i][lane] = weights[i];
+		}
+		batch.counts[lane] = ( float )pointCount;
+		batch.count = std::max( batch.count, pointCount );
+	}
+	if( laneCount == 0 )
+		return;
+
+	// compute the principle components between the covariance and fitting kernels
+	kernels.RangeFitCovariance( batch );
+	if( ( flags & kColourPowerIteration ) != 0 )
+		kernels.RangeFitPrinciple( batch );
+	else
+	{
+		for( int lane = 0; lane < laneCount; ++lane )
+		{
+			Sym3x3 covariance;
+			for( int i = 0; i < 6; ++i )
+				covariance[i] = batch.covariance[i][lane];
+			Vec3 principle = ComputePrincipleComponent( covariance );
+			batch.principle[0][lane] = principle.X();
+			batch.principle[1][lane] = principle.Y();
+			batch.principle[2][lane] = principle.Z();
+		}
+	}
+	kernels.RangeFitCodes( batch );
+
+	// save each block exactly as RangeFit would
+	for( int lane = 0; lane < laneCount; ++lane )
+	{
+		ColourSet const& set = colours[lanes[lane]];
+		void* block = colourBlocks[lanes[lane]];
+		Vec3 start( batch.start[0][lane], batch.start[1][lane], batch.start[2][lane] );
+		Vec3 end( batch.end[0][lane], batch.end[1][lane], batch.end[2][lane] );
+
+		u8 closest[16];
+		u8 indices[16];
+		float besterror = FLT_MAX;
+		if( isDxt1 && batch.error3[lane] < besterror )
+		{
+			for( int i = 0; i < 16; ++i )
+				closest[i] = batch.closest3[i][lane];
+			set.RemapIndices( closest, indices );
+			WriteColourBlock3( start, end, indices, block );
+			besterror = batch.error3[lane];
+		}
+		if( !( isDxt1 && set.IsTransparent() ) && batch.error4[lane] < besterror )
+		{
+			for( int i = 0; i < 16; ++i )
+				closest[i] = batch.closest4[i][lane];
+			set.RemapIndices( closest, indices );
+			WriteColourBlock4( start, end, indices, block );
+		}
+	}
+}
+
+static void CompressBlockBatch( u8 const* const* rgba, int const* masks, u8* const* blocks, int count, int flags )
+{
+	// get the colour block locations
+	int const colourOffset = ( ( flags & ( kDxt3 | kDxt5 ) ) != 0 ) ? 8 : 0;
+	u8* colourBlocks[kBatchBlocks];
+	for( int b = 0; b < count; ++b )
+		colourBlocks[b] = blocks[b] + colourOffset;
+
+	// create the minimal point sets
+	ColourSet colours[kBatchBlocks];
+	for( int b = 0; b < count; ++b )
+		colours[b] = ColourSet( rgba[b], masks[b], flags );
+
+	// compress colour, sharing the lanes between range fits
+	if( ( flags & kColourRangeFit ) != 0 )
+		CompressColourBatch( colours, colourBlocks, count, flags );
+	else
+	{
+		for( int b = 0; b < count; ++b )
+			CompressColour( colours[b], flags, colourBlocks[b] );
+	}
+
+	// compress alpha separately if necessary
+	if( ( flags & kDxt3 ) != 0 )
+	{
+		for( int b = 0; b < count; ++b )
+			CompressAlphaDxt3( rgba[b], masks[b], blocks[b] );
+	}
+	else if( ( flags & kDxt5 ) != 0 )
+	{
+		// the blocks are not contiguous, so fit the alpha of each on its own
+		Kernels const& kernels = GetKernels();
+		bool const refine = ( flags & kAlphaIterativeFit ) != 0;
+		for( int b = 0; b < count; ++b )
+			kernels.FitAlphas( rgba[b], masks + b, 1, refine, blocks[b], 16 );
+	}
+}
+
+void CompressMaskedBlocks( u8 const* rgba, int const* masks, int count, void* blocks, int flags )
+{
+	// fix any bad flags
+	flags = FixFlags( flags );
+	if( ( flags & kColourFastFit ) != 0 )
+	{
+		CompressFastBlocks( rgba, masks, count, blocks, flags );
+		return;
+	}
+	if( ( flags & kColourAdaptiveFit ) != 0 )
+	{
+		CompressAdaptiveBlocks( rgba, masks, count, blocks, flags );
+		return;
+	}
+	Kernels const& kernels = GetKernels();
+	int const bytesPerBlock = ( ( flags & kDxt1 ) != 0 ) ? 8 : 16;
+	u8* bytes = reinterpret_cast< u8* >( blocks );
+
+	// the last solid block, which is copied along a run of the same colour
+	u8 const* solidBlock = NULL;
+	u8 solidColour[4];
+	int solidMask = 0;
+
+	// gather the other blocks into batches
+	u8 const* batchRgba[kBatchBlocks];
+	int batchMasks[kBatchBlocks];
+	u8* batchBlocks[kBatchBlocks];
+	int batchCount = 0;
+	for( int n = 0; n < count; ++n )
+	{
+		u8 const* blockRgba = rgba + 64*n;
+		u8* block = bytes + bytesPerBlock*n;
+		u8 colour[4];
+		if( kernels.GetSolidColour( blockRgba, masks[n], colour ) )
+		{
+			// write solid blocks directly
+			if( solidBlock != NULL && masks[n] == solidMask && std::memcmp( colour, solidColour, 4 ) == 0 )
+				std::memcpy( block, solidBlock, bytesPerBlock );
+			else
+			{
+				CompressSolidBlock( blockRgba, colour, masks[n], flags, block );
+				solidBlock = block;
+				std::memcpy( solidColour, colour, 4 );
+				solidMask = masks[n];
+			}
+			continue;
+		}
+
+		batchRgba[batchCount] = blockRgba;
+		batchMasks[batchCount] = masks[n];
+		batchBlocks[batchCount] = block;
+		if( ++batchCount == kBatchBlocks )
+		{
+			CompressBlockBatch( batchRgba, batchMasks, batchBlocks, batchCount, flags );
+			batchCount = 0;
+		}
+	}
+	if( batchCount > 0 )
+		CompressBlockBatch( batchRgba, batchMasks, batchBlocks, batchCount, flags );
 }
 
 void Decompress( u8* rgba, void const* block, int flags )
@@ -138,156 +471,1614 @@ int GetStorageRequirements( int width, int height, int flags )
 	return blockcount*blocksize;	
 }
 
-void CompressImage( u8 const* rgba, int width, int height, void* blocks, int flags, ProgressFn progressFn )
+static void ConvertToRgba( u8* rgba, int count, int pixelFormat )
 {
-	// fix any bad flags
-	flags = FixFlags( flags );
+	for( int i = 0; i < count; ++i, rgba += 4 )
+	{
+		// swap red and blue
+		if( ( pixelFormat & kPixelBgra ) != 0 )
+			std::swap( rgba[0], rgba[2] );
 
-	// initialise the block output
-	u8* targetBlock = reinterpret_cast< u8* >( blocks );
-	int bytesPerBlock = ( ( flags & kDxt1 ) != 0 ) ? 8 : 16;
+		// undo the premultiplication by alpha
+		if( ( pixelFormat & kPixelPremultiplied ) != 0 )
+		{
+			int const alpha = rgba[3];
+			for( int c = 0; c < 3; ++c )
+				rgba[c] = ( alpha == 0 ) ? 0 : ( u8 )std::min( 255, ( 255*rgba[c] + alpha/2 )/alpha );
+		}
+	}
+}
+
+static void ConvertFromRgba( u8* rgba, int count, int pixelFormat )
+{
+	for( int i = 0; i < count; ++i, rgba += 4 )
+	{
+		// premultiply by alpha
+		if( ( pixelFormat & kPixelPremultiplied ) != 0 )
+		{
+			int const alpha = rgba[3];
+			for( int c = 0; c < 3; ++c )
+				rgba[c] = ( u8 )( ( rgba[c]*alpha + 127 )/255 );
+		}
 
-	int progress = 0;
+		// swap red and blue
+		if( ( pixelFormat & kPixelBgra ) != 0 )
+			std::swap( rgba[0], rgba[2] );
+	}
+}
 
-	if (progressFn != NULL)
+// the number of blocks along a row that make up a single work item
+enum { kTileBlocks = 8 };
+
+// the squared errors measured by one worker, padded to keep the workers apart
+struct ErrorTotals
+{
+	double channels[4];
+	int maxBlockError;
+	int maxBlock;
+	u8 padding[64];
+};
+
+class CompressImageTask : public ParallelTask
+{
+public:
+	CompressImageTask( u8 const* pixels, int width, int height, int stride, int pixelFormat, u8* blocks, int flags, ProgressFn progressFn )
+	  : m_pixels( pixels ), 
+		m_width( width ), 
+		m_height( height ), 
+		m_stride( stride ), 
+		m_pixelFormat( pixelFormat ), 
+		m_blocks( blocks ), 
+		m_flags( flags ), 
+		m_cache( NULL ), 
+		m_progressFn( progressFn ), 
+		m_dirty( NULL ), 
+		m_tiles( NULL ), 
+		m_blocksWide( ( width + 3 )/4 ), 
+		m_blockPitch( m_blocksWide ), 
+		m_blockCount( m_blocksWide*( ( height + 3 )/4 ) ), 
+		m_progress( progressFn, m_blockCount, height ), 
+		m_cancel( NULL ), 
+		m_cancelled( 0 ), 
+		m_measuring( false ), 
+		m_blockErrors( NULL )
 	{
-		progressFn(0, height);
+		m_tilesWide = ( m_blocksWide + kTileBlocks - 1 )/kTileBlocks;
+		m_bytesPerBlock = ( ( flags & kDxt1 ) != 0 ) ? 8 : 16;
+	}
+
+	int GetTileCount() const 
+	{ 
+		return m_tilesWide*( ( m_height + 3 )/4 ); 
+	}
+
+	int GetTilesWide() const
+	{
+		return m_tilesWide;
+	}
+
+	int GetBlocksWide() const
+	{
+		return m_blocksWide;
+	}
+
+	int GetTileBlocks( int tile ) const
+	{
+		int const bx = kTileBlocks*( tile % m_tilesWide );
+		return std::min( bx + kTileBlocks, m_blocksWide ) - bx;
+	}
+
+	void SetCache( BlockCache* cache )
+	{
+		m_cache = cache;
+	}
+
+	BlockCache* GetCache() const
+	{
+		return m_cache;
+	}
+
+	void SetCancel( int const volatile* cancel )
+	{
+		m_cancel = cancel;
 	}
 
-	// loop over blocks
-#ifdef SQUISH_USE_OPENMP
-	#pragma omp parallel for shared(progress)
-#endif
-	for( int y = 0; y < height; y += 4 )
+	//! Returns true if any tiles were skipped because of the cancel flag.
+	bool IsCancelled() const
 	{
-		for( int x = 0; x < width; x += 4 )
+		return m_cancelled != 0;
+	}
+
+	//! Measures the error of each block as it is compressed, by up to workerCount workers.
+	void SetMeasuring( int* blockErrors, int workerCount )
+	{
+		ErrorTotals none;
+		std::memset( &none, 0, sizeof( none ) );
+		none.maxBlockError = -1;
+		m_errors.assign( workerCount, none );
+		m_measuring = true;
+		m_blockErrors = blockErrors;
+	}
+
+	//! Adds up the errors measured by the workers.
+	void GetStats( CompressionStats& stats ) const
+	{
+		double channels[4] = { 0.0, 0.0, 0.0, 0.0 };
+		stats.maxBlockError = 0;
+		stats.maxBlock = 0;
+		for( int w = 0; w < ( int )m_errors.size(); ++w )
 		{
-			// build the 4x4 block of pixels
-			u8 sourceRgba[16*4];
-			u8* targetPixel = sourceRgba;
-			int mask = 0;
-			for( int py = 0; py < 4; ++py )
+			ErrorTotals const& totals = m_errors[w];
+			for( int i = 0; i < 4; ++i )
+				channels[i] += totals.channels[i];
+			if( totals.maxBlockError > stats.maxBlockError 
+				|| ( totals.maxBlockError == stats.maxBlockError && totals.maxBlock < stats.maxBlock ) )
 			{
-				for( int px = 0; px < 4; ++px )
-				{
-					// get the source pixel in the image
-					int sx = x + px;
-					int sy = y + py;
-					
-					// enable if we're in the image
-					if( sx < width && sy < height )
-					{
-						// copy the rgba value
-						u8 const* sourcePixel = rgba + 4*( width*sy + sx );
-						for( int i = 0; i < 4; ++i )
-							*targetPixel++ = *sourcePixel++;
-							
-						// enable this pixel
-						mask |= ( 1 << ( 4*py + px ) );
-					}
-					else
-					{
-						// skip this pixel as its outside the image
-						targetPixel += 4;
-					}
-				}
+				stats.maxBlockError = totals.maxBlockError;
+				stats.maxBlock = totals.maxBlock;
 			}
-			
-			// compress it into the output
-			int blockNum = (((width + 3) / 4) * (y / 4)) + (x / 4);
-			u8* outputBlock = targetBlock + (bytesPerBlock * blockNum);
-			CompressMasked( sourceRgba, mask, outputBlock, flags );
 		}
 
-#ifdef SQUISH_USE_OPENMP
-		#pragma omp atomic
-#endif
-		progress += 4;
-
-		if (progressFn != NULL)
+		// the sums are whole numbers, so they do not depend on the order of the workers
+		double const pixelCount = ( double )m_width*m_height;
+		for( int i = 0; i < 4; ++i )
 		{
-			progressFn(progress, height);
+			stats.mse[i] = ( pixelCount > 0.0 ) ? channels[i]/pixelCount : 0.0;
+			if( stats.mse[i] > 0.0 )
+				stats.psnr[i] = 10.0*std::log10( 255.0*255.0/stats.mse[i] );
+			else
+				stats.psnr[i] = std::numeric_limits< double >::infinity();
 		}
 	}
 
-    if (progressFn != NULL)
+	//! Limits the work to the given tiles and to the blocks flagged in dirty.
+	void SetDirtyBlocks( u8 const* dirty, int const* tiles, int blockCount )
 	{
-		progressFn(height, height);
+		m_dirty = dirty;
+		m_tiles = tiles;
+		m_blockCount = blockCount;
+		m_progress = ProgressReporter( m_progressFn, blockCount, m_height );
 	}
-}
 
-void DecompressImage( u8* rgba, int width, int height, void const* blocks, int flags, ProgressFn progressFn )
-{
-	// fix any bad flags
-	flags = FixFlags( flags );
+	//! Writes each row of blocks blockPitch blocks after the one before, for a part of a larger image.
+	void SetBlockPitch( int blockPitch )
+	{
+		m_blockPitch = blockPitch;
+	}
 
-	// initialise the block input
-	u8 const* source = reinterpret_cast< u8 const* >( blocks );
-	int bytesPerBlock = ( ( flags & kDxt1 ) != 0 ) ? 8 : 16;
+	//! Gets the number of blocks that the given item of the work compresses.
+	int GetItemBlocks( int item ) const
+	{
+		int const tile = ( m_tiles != NULL ) ? m_tiles[item] : item;
+		if( m_dirty == NULL )
+			return GetTileBlocks( tile );
 
-	int progress = 0;
+		int const rowStart = m_blocksWide*( tile/m_tilesWide );
+		int const bx = kTileBlocks*( tile % m_tilesWide );
+		int const bxend = std::min( bx + kTileBlocks, m_blocksWide );
+		int count = 0;
+		for( int b = bx; b < bxend; ++b )
+		{
+			if( m_dirty[rowStart + b] != 0 )
+				++count;
+		}
+		return count;
+	}
 
-	if (progressFn != NULL)
+	virtual void Poll()
 	{
-		progressFn(height, height);
+		m_progress.Poll();
 	}
 
-	// loop over blocks
-#ifdef SQUISH_USE_OPENMP
-	#pragma omp parallel for shared(progress)
-#endif
-	for( int y = 0; y < height; y += 4 )
+	virtual void Run( int item, int worker )
 	{
-		for( int x = 0; x < width; x += 4 )
+		// skip the tile once the caller has given up
+		if( m_cancel != NULL && *m_cancel != 0 )
+		{
+			m_cancelled = 1;
+			return;
+		}
+
+		// find the blocks in this tile
+		int const tile = ( m_tiles != NULL ) ? m_tiles[item] : item;
+		int const y = 4*( tile/m_tilesWide );
+		int const bx = kTileBlocks*( tile % m_tilesWide );
+		int const bxend = std::min( bx + kTileBlocks, m_blocksWide );
+		int const rowStart = m_blocksWide*( y/4 );
+		int const outputStart = m_blockPitch*( y/4 );
+
+		// pick the blocks that need compressing
+		int columns[kTileBlocks];
+		int count = 0;
+		for( int b = bx; b < bxend; ++b )
+		{
+			if( m_dirty == NULL || m_dirty[rowStart + b] != 0 )
+				columns[count++] = b;
+		}
+
+		// a tile of one colour needs only one block compressed
+		if( count == bxend - bx && !m_measuring && CompressSolidTile( y, bx, bxend, outputStart ) )
 		{
-			// decompress the block
-			int blockNum = (((width + 3) / 4) * (y / 4)) + (x / 4);
-			u8 const* sourceBlock = source + (bytesPerBlock * blockNum);
+			m_progress.Add( count );
+			return;
+		}
 
-			u8 targetRgba[4*16];
-			Decompress( targetRgba, sourceBlock, flags );
-			
-			// write the decompressed pixels to the correct image locations
-			u8 const* sourcePixel = targetRgba;
+		// build the 4x4 blocks of pixels
+		u8 sourceRgba[kTileBlocks][16*4];
+		int masks[kTileBlocks];
+		std::memset( sourceRgba, 0, sizeof( sourceRgba ) );
+		for( int c = 0; c < count; ++c )
+		{
+			int const x = 4*columns[c];
+			u8* targetPixel = sourceRgba[c];
+			int mask = 0;
 			for( int py = 0; py < 4; ++py )
 			{
 				for( int px = 0; px < 4; ++px )
 				{
-					// get the target location
+					// get the source pixel in the image
 					int sx = x + px;
 					int sy = y + py;
-					if( sx < width && sy < height )
+					
+					// enable if we're in the image
+					if( sx < m_width && sy < m_height )
 					{
-						u8* targetPixel = rgba + 4*( width*sy + sx );
-						
 						// copy the rgba value
+						u8 const* sourcePixel = m_pixels + m_stride*sy + 4*sx;
 						for( int i = 0; i < 4; ++i )
 							*targetPixel++ = *sourcePixel++;
+							
+						// enable this pixel
+						mask |= ( 1 << ( 4*py + px ) );
 					}
 					else
 					{
 						// skip this pixel as its outside the image
-						sourcePixel += 4;
+						targetPixel += 4;
 					}
 				}
 			}
-				
-#ifdef SQUISH_USE_OPENMP
-			#pragma omp atomic
-#endif
-			progress += 4;
+			masks[c] = mask;
 
-			if (progressFn != NULL)
-			{
-				progressFn(progress, height);
-			}
+			// get the pixels into plain rgba
+			if( m_pixelFormat != kPixelRgba )
+				ConvertToRgba( sourceRgba[c], 16, m_pixelFormat );
 		}
+		
+		// compress them into the output, going through a copy if any were skipped
+		u8 compressed[kTileBlocks*16];
+		u8* outputBlock = m_blocks + m_bytesPerBlock*( outputStart + bx );
+		if( count != bxend - bx )
+			outputBlock = compressed;
+		if( m_cache != NULL && m_cache->IsUseful( worker ) )
+			CompressCachedBlocks( sourceRgba, masks, count, outputBlock, worker );
+		else
+			CompressMaskedBlocks( sourceRgba[0], masks, count, outputBlock, m_flags );
+		if( m_measuring )
+			MeasureBlocks( sourceRgba, masks, columns, count, outputBlock, rowStart, worker );
+		if( outputBlock == compressed )
+		{
+			for( int c = 0; c < count; ++c )
+				std::memcpy( m_blocks + m_bytesPerBlock*( outputStart + columns[c] ), compressed + m_bytesPerBlock*c, m_bytesPerBlock );
+		}
+
+		// count the blocks for the progress reports
+		m_progress.Add( count );
+	}
+
+private:
+	bool CompressSolidTile( int y, int bx, int bxend, int outputStart )
+	{
+		// check the rows of the tile against its first pixel
+		Kernels const& kernels = GetKernels();
+		int const width = std::min( 4*bxend, m_width ) - 4*bx;
+		int const height = std::min( y + 4, m_height ) - y;
+		u8 const* first = m_pixels + m_stride*y + 16*bx;
+		for( int py = 0; py < height; ++py )
+		{
+			if( kernels.MatchPixels( first + m_stride*py, width, first ) != width )
+				return false;
+		}
+
+		// compress a block of the colour for each mask, which only changes at the edges of the image
+		u8 rgba[16*4];
+		for( int i = 0; i < 16; ++i )
+			std::memcpy( rgba + 4*i, first, 4 );
+		if( m_pixelFormat != kPixelRgba )
+			ConvertToRgba( rgba, 16, m_pixelFormat );
+		u8 block[16];
+		int blockMask = -1;
+		for( int b = bx; b < bxend; ++b )
+		{
+			int const columns = std::min( m_width - 4*b, 4 );
+			int const mask = ( ( 1 << 4*height ) - 1 ) & ( 0x1111*( ( 1 << columns ) - 1 ) );
+			if( mask != blockMask )
+			{
+				CompressMasked( rgba, mask, block, m_flags );
+				blockMask = mask;
+			}
+			std::memcpy( m_blocks + m_bytesPerBlock*( outputStart + b ), block, m_bytesPerBlock );
+		}
+		return true;
+	}
+
+	void MeasureBlocks( u8 const ( *sourceRgba )[16*4], int const* masks, int const* columns, int count, u8 const* outputBlocks, int rowStart, int worker )
+	{
+		// decode each block while the tile is still in the cache
+		ErrorTotals& totals = m_errors[worker];
+		int channels[4] = { 0, 0, 0, 0 };
+		for( int c = 0; c < count; ++c )
+		{
+			u8 decoded[16*4];
+			Decompress( decoded, outputBlocks + m_bytesPerBlock*c, m_flags );
+
+			// sum the errors of the pixels inside the image
+			int error = 0;
+			for( int i = 0; i < 16; ++i )
+			{
+				if( ( masks[c] & ( 1 << i ) ) == 0 )
+					continue;
+				for( int j = 0; j < 4; ++j )
+				{
+					int const diff = ( int )decoded[4*i + j] - ( int )sourceRgba[c][4*i + j];
+					channels[j] += diff*diff;
+					error += diff*diff;
+				}
+			}
+
+			int const block = rowStart + columns[c];
+			if( m_blockErrors != NULL )
+				m_blockErrors[block] = error;
+			if( error > totals.maxBlockError || ( error == totals.maxBlockError && block < totals.maxBlock ) )
+			{
+				totals.maxBlockError = error;
+				totals.maxBlock = block;
+			}
+		}
+		for( int j = 0; j < 4; ++j )
+			totals.channels[j] += channels[j];
+	}
+
+	void CompressCachedBlocks( u8 const ( *sourceRgba )[16*4], int const* masks, int count, u8* outputBlocks, int worker )
+	{
+		// look up each block, reusing the earlier copies within the tile too
+		u8 missRgba[kTileBlocks][16*4];
+		int missMasks[kTileBlocks];
+		unsigned int missHashes[kTileBlocks];
+		int sources[kTileBlocks];
+		int missCount = 0;
+		for( int b = 0; b < count; ++b )
+		{
+			sources[b] = -1;
+			unsigned int hash = BlockCache::Hash( sourceRgba[b], masks[b] );
+			if( m_cache->Find( worker, hash, sourceRgba[b], masks[b], outputBlocks + m_bytesPerBlock*b ) )
+				continue;
+			for( int m = 0; m < missCount && sources[b] < 0; ++m )
+			{
+				if( missHashes[m] == hash && missMasks[m] == masks[b] && std::memcmp( missRgba[m], sourceRgba[b], 16*4 ) == 0 )
+					sources[b] = m;
+			}
+			if( sources[b] >= 0 )
+			{
+				m_cache->CountHit( worker );
+				continue;
+			}
+			sources[b] = missCount;
+			std::memcpy( missRgba[missCount], sourceRgba[b], 16*4 );
+			missMasks[missCount] = masks[b];
+			missHashes[missCount] = hash;
+			++missCount;
+		}
+		if( missCount == 0 )
+			return;
+
+		// compress the new blocks together and remember them
+		u8 missBlocks[kTileBlocks*16];
+		CompressMaskedBlocks( missRgba[0], missMasks, missCount, missBlocks, m_flags );
+		for( int m = 0; m < missCount; ++m )
+			m_cache->Insert( worker, missHashes[m], missRgba[m], missMasks[m], missBlocks + m_bytesPerBlock*m );
+		for( int b = 0; b < count; ++b )
+		{
+			if( sources[b] >= 0 )
+				std::memcpy( outputBlocks + m_bytesPerBlock*b, missBlocks + m_bytesPerBlock*sources[b], m_bytesPerBlock );
+		}
+	}
+
+	u8 const* m_pixels;
+	int m_width;
+	int m_height;
+	int m_stride;
+	int m_pixelFormat;
+	u8* m_blocks;
+	int m_flags;
+	BlockCache* m_cache;
+	ProgressFn m_progressFn;
+	u8 const* m_dirty;
+	int const* m_tiles;
+	int m_blocksWide;
+	int m_blockPitch;
+	int m_blockCount;
+	ProgressReporter m_progress;
+	int const volatile* m_cancel;
+	long volatile m_cancelled;
+	int m_tilesWide;
+	int m_bytesPerBlock;
+	bool m_measuring;
+	int* m_blockErrors;
+	std::vector< ErrorTotals > m_errors;
+};
+
+static bool g_blockCache = true;
+static BlockCacheStats g_blockCacheStats = { 0, 0, 0 };
+
+void SetBlockCache( bool enabled )
+{
+	g_blockCache = enabled;
+}
+
+BlockCacheStats GetBlockCacheStats()
+{
+	return g_blockCacheStats;
+}
+
+static BlockCache* CreateBlockCache( int blockCount, int workerCount, int flags )
+{
+	// share a block cache between the workers if required
+	if( !g_blockCache )
+		return NULL;
+	int bytesPerBlock = ( ( flags & kDxt1 ) != 0 ) ? 8 : 16;
+	return new BlockCache( blockCount, workerCount, bytesPerBlock );
+}
+
+static void DestroyBlockCache( BlockCache* cache )
+{
+	// keep the cache counts for this image
+	if( cache != NULL )
+	{
+		g_blockCacheStats = cache->GetStats();
+		delete cache;
+	}
+	else
+	{
+		BlockCacheStats none = { 0, 0, 0 };
+		g_blockCacheStats = none;
+	}
+}
+
+static void RunCompressImageTask( CompressImageTask& task, int tileCount, int blockCount, int workerCount, int flags )
+{
+	// compress the tiles on the pool, with a cache table for each of its workers
+	BlockCache* cache = CreateBlockCache( blockCount, workerCount, flags );
+	task.SetCache( cache );
+	ParallelFor( task, tileCount, workerCount );
+	DestroyBlockCache( cache );
+}
+
+void CompressImage( u8 const* rgba, int width, int height, void* blocks, int flags, ProgressFn progressFn )
+{
+	CompressImage( rgba, width, height, 4*width, kPixelRgba, blocks, flags, progressFn, NULL );
+}
+
+int CompressImage( u8 const* pixels, int width, int height, int stride, int pixelFormat, void* blocks, int flags, ProgressFn progressFn, int const volatile* cancel )
+{
+	return CompressImage( pixels, width, height, stride, pixelFormat, blocks, flags, progressFn, cancel, NULL );
+}
+
+int CompressImage( u8 const* pixels, int width, int height, int stride, int pixelFormat, void* blocks, int flags, ProgressFn progressFn, int const volatile* cancel, CompressionStats* stats )
+{
+	// fix any bad flags
+	flags = FixFlags( flags );
+
+	// keep the same kernels for every block of the image
+	KernelScope kernelScope;
+
+	if (progressFn != NULL)
+	{
+		progressFn(0, height);
+	}
+
+	// compress the tiles on the pool, measuring with the same workers
+	int const workerCount = GetWorkerCount();
+	CompressImageTask task( pixels, width, height, stride, pixelFormat, reinterpret_cast< u8* >( blocks ), flags, progressFn );
+	task.SetCancel( cancel );
+	if( stats != NULL )
+		task.SetMeasuring( stats->blockErrors, workerCount );
+	int blockCount = ( ( width + 3 )/4 )*( ( height + 3 )/4 );
+	RunCompressImageTask( task, task.GetTileCount(), blockCount, workerCount, flags );
+	if( task.IsCancelled() )
+		return kStatusCancelled;
+	if( stats != NULL )
+		task.GetStats( *stats );
+
+	if (progressFn != NULL)
+	{
+		progressFn(height, height);
+	}
+	return kStatusOk;
+}
+
+// lists the tiles of the task that hold any of the blocks flagged in dirty
+static void GetDirtyTiles( CompressImageTask const& task, std::vector< u8 > const& dirty, std::vector< int >& tiles )
+{
+	int const tilesWide = task.GetTilesWide();
+	int const blocksWide = task.GetBlocksWide();
+	for( int tile = 0; tile < task.GetTileCount(); ++tile )
+	{
+		int const rowStart = blocksWide*( tile/tilesWide );
+		int const bx = kTileBlocks*( tile % tilesWide );
+		int const bxend = std::min( bx + kTileBlocks, blocksWide );
+		for( int b = bx; b < bxend; ++b )
+		{
+			if( dirty[rowStart + b] != 0 )
+			{
+				tiles.push_back( tile );
+				break;
+			}
+		}
+	}
+}
+
+void RecompressImage( u8 const* rgba, int width, int height, void* blocks, int flags, DirtyRect const* rects, int rectCount, ProgressFn progressFn )
+{
+	RecompressImage( rgba, width, height, 4*width, kPixelRgba, blocks, flags, rects, rectCount, progressFn, NULL );
+}
+
+int RecompressImage( u8 const* pixels, int width, int height, int stride, int pixelFormat, void* blocks, int flags, DirtyRect const* rects, int rectCount, ProgressFn progressFn, int const volatile* cancel )
+{
+	// fix any bad flags
+	flags = FixFlags( flags );
+
+	// keep the same kernels for every block of the image
+	KernelScope kernelScope;
+
+	if (progressFn != NULL)
+	{
+		progressFn(0, height);
+	}
+
+	// flag the blocks touched by each rectangle
+	int const blocksWide = ( width + 3 )/4;
+	int const blocksHigh = ( height + 3 )/4;
+	std::vector< u8 > dirty( blocksWide*blocksHigh, 0 );
+	int dirtyCount = 0;
+	for( int r = 0; r < rectCount; ++r )
+	{
+		// clip the rectangle to the image
+		int const left = std::max( rects[r].x, 0 );
+		int const top = std::max( rects[r].y, 0 );
+		int const right = std::min( rects[r].x + rects[r].width, width );
+		int const bottom = std::min( rects[r].y + rects[r].height, height );
+		if( left >= right || top >= bottom )
+			continue;
+
+		for( int by = top/4; by < ( bottom + 3 )/4; ++by )
+		{
+			for( int bx = left/4; bx < ( right + 3 )/4; ++bx )
+			{
+				u8& flag = dirty[blocksWide*by + bx];
+				if( flag == 0 )
+				{
+					flag = 1;
+					++dirtyCount;
+				}
+			}
+		}
+	}
+
+	// list the tiles that hold dirty blocks
+	CompressImageTask task( pixels, width, height, stride, pixelFormat, reinterpret_cast< u8* >( blocks ), flags, progressFn );
+	std::vector< int > tiles;
+	GetDirtyTiles( task, dirty, tiles );
+
+	// compress just those blocks on the pool
+	if( !tiles.empty() )
+	{
+		task.SetDirtyBlocks( &dirty[0], &tiles[0], dirtyCount );
+		task.SetCancel( cancel );
+		RunCompressImageTask( task, ( int )tiles.size(), dirtyCount, GetWorkerCount(), flags );
+		if( task.IsCancelled() )
+			return kStatusCancelled;
+	}
+
+	if (progressFn != NULL)
+	{
+		progressFn(height, height);
+	}
+	return kStatusOk;
+}
+
+class CompressBatchTask : public ParallelTask
+{
+public:
+	CompressBatchTask( std::vector< CompressImageTask* > const& tasks, std::vector< int > const& firstTiles, int blockCount, ProgressFn progressFn )
+	  : m_tasks( tasks ), 
+		m_firstTiles( firstTiles ), 
+		m_progress( progressFn, blockCount, blockCount )
+	{
+	}
+
+	virtual void Poll()
+	{
+		m_progress.Poll();
+	}
+
+	virtual void Run( int item, int worker )
+	{
+		// find the image that holds this tile
+		int const image = int( std::upper_bound( m_firstTiles.begin(), m_firstTiles.end(), item ) - m_firstTiles.begin() ) - 1;
+		CompressImageTask& task = *m_tasks[image];
+		int const tile = item - m_firstTiles[image];
+		task.Run( tile, worker );
+		m_progress.Add( task.GetTileBlocks( tile ) );
+	}
+
+private:
+	std::vector< CompressImageTask* > const& m_tasks;
+	std::vector< int > const& m_firstTiles;
+	ProgressReporter m_progress;
+};
+
+int CompressImages( BatchImage const* images, int count, ProgressFn progressFn, int const volatile* cancel )
+{
+	// keep the same kernels for every block of the images
+	KernelScope kernelScope;
+
+	// set up each image, numbering the tiles of the batch in order
+	std::vector< CompressImageTask* > tasks;
+	std::vector< int > firstTiles;
+	std::vector< int > flags;
+	int tileCount = 0;
+	int blockCount = 0;
+	for( int i = 0; i < count; ++i )
+	{
+		BatchImage const& image = images[i];
+		int const fixedFlags = FixFlags( image.flags );
+		CompressImageTask* task = new CompressImageTask( 
+			image.pixels, image.width, image.height, image.stride, image.pixelFormat, 
+			reinterpret_cast< u8* >( image.blocks ), fixedFlags, NULL );
+		task->SetCancel( cancel );
+		tasks.push_back( task );
+		firstTiles.push_back( tileCount );
+		flags.push_back( fixedFlags );
+		tileCount += task->GetTileCount();
+		blockCount += ( ( image.width + 3 )/4 )*( ( image.height + 3 )/4 );
+	}
+
+	// share a block cache between the images with the same flags
+	int const workerCount = GetWorkerCount();
+	std::vector< BlockCache* > caches;
+	for( int i = 0; i < count; ++i )
+	{
+		int first = 0;
+		while( flags[first] != flags[i] )
+			++first;
+		if( first == i )
+		{
+			int cacheBlocks = 0;
+			for( int j = i; j < count; ++j )
+			{
+				if( flags[j] == flags[i] )
+					cacheBlocks += ( ( images[j].width + 3 )/4 )*( ( images[j].height + 3 )/4 );
+			}
+			BlockCache* cache = CreateBlockCache( cacheBlocks, workerCount, flags[i] );
+			if( cache != NULL )
+				caches.push_back( cache );
+			tasks[i]->SetCache( cache );
+		}
+		else
+		{
+			tasks[i]->SetCache( tasks[first]->GetCache() );
+		}
+	}
+
+	if (progressFn != NULL)
+	{
+		progressFn(0, blockCount);
+	}
+
+	// compress the tiles of every image on the pool at once
+	if( tileCount > 0 )
+	{
+		CompressBatchTask batch( tasks, firstTiles, blockCount, progressFn );
+		ParallelFor( batch, tileCount, workerCount );
+	}
+
+	// keep the cache counts of the whole batch
+	BlockCacheStats cacheStats = { 0, 0, 0 };
+	for( int c = 0; c < ( int )caches.size(); ++c )
+	{
+		BlockCacheStats const stats = caches[c]->GetStats();
+		cacheStats.blocks += stats.blocks;
+		cacheStats.localHits += stats.localHits;
+		cacheStats.sharedHits += stats.sharedHits;
+		delete caches[c];
+	}
+	g_blockCacheStats = cacheStats;
+
+	bool cancelled = false;
+	for( int i = 0; i < count; ++i )
+	{
+		cancelled = cancelled || tasks[i]->IsCancelled();
+		delete tasks[i];
+	}
+	if( cancelled )
+		return kStatusCancelled;
+
+	if (progressFn != NULL)
+	{
+		progressFn(blockCount, blockCount);
+	}
+	return kStatusOk;
+}
+
+class Job
+{
+public:
+	Job( BatchImage const* images, int count, ProgressFn progressFn, CompletionFn completionFn )
+	  : m_images( images, images + count ), 
+		m_progressFn( progressFn ), 
+		m_completionFn( completionFn ), 
+		m_cancel( 0 ), 
+		m_status( kStatusRunning ), 
+		m_references( 2 )
+	{
+	}
+
+	static void Main( void* arg )
+	{
+		// compress everything, then report back before counting as finished
+		Job* job = reinterpret_cast< Job* >( arg );
+		BatchImage const* images = job->m_images.empty() ? NULL : &job->m_images[0];
+		int const status = CompressImages( images, ( int )job->m_images.size(), job->m_progressFn, &job->m_cancel );
+		if( job->m_completionFn != NULL )
+			job->m_completionFn( status );
+		job->m_status = status;
+		job->m_finished.Set();
+		job->Release();
+	}
+
+	int Poll()
+	{
+		return m_finished.Wait( 0 ) ? m_status : kStatusRunning;
+	}
+
+	int Wait()
+	{
+		m_finished.Wait( -1 );
+		return m_status;
+	}
+
+	void Cancel()
+	{
+		m_cancel = 1;
+	}
+
+	//! Drops one of the references from the caller and the job's thread.
+	void Release()
+	{
+		if( AtomicAdd( &m_references, -1 ) == 0 )
+			delete this;
+	}
+
+private:
+	std::vector< BatchImage > m_images;
+	ProgressFn m_progressFn;
+	CompletionFn m_completionFn;
+	int volatile m_cancel;
+	int volatile m_status;
+	long volatile m_references;
+	Event m_finished;
+};
+
+Job* SubmitImages( BatchImage const* images, int count, ProgressFn progressFn, CompletionFn completionFn )
+{
+	Job* job = new Job( images, std::max( count, 0 ), progressFn, completionFn );
+	StartDetachedThread( &Job::Main, job );
+	return job;
+}
+
+int PollJob( Job* job )
+{
+	return job->Poll();
+}
+
+int WaitJob( Job* job )
+{
+	return job->Wait();
+}
+
+void CancelJob( Job* job )
+{
+	job->Cancel();
+}
+
+void ReleaseJob( Job* job )
+{
+	if( job != NULL )
+		job->Release();
+}
+
+// the number of blocks decompressed at a time when a band cannot be written in place
+enum { kBandBlocks = 16 };
+
+class DecompressImageTask : public ParallelTask
+{
+public:
+	DecompressImageTask( u8* pixels, int width, int height, int stride, int pixelFormat, u8 const* blocks, int flags, ProgressFn progressFn, int const volatile* cancel )
+	  : m_pixels( pixels ), 
+		m_width( width ), 
+		m_height( height ), 
+		m_stride( stride ), 
+		m_pixelFormat( pixelFormat ), 
+		m_blocks( blocks ), 
+		m_flags( flags ), 
+		m_progress( progressFn, height, height ), 
+		m_cancel( cancel ), 
+		m_cancelled( 0 )
+	{
+		m_blocksWide = ( width + 3 )/4;
+		m_bytesPerBlock = ( ( flags & kDxt1 ) != 0 ) ? 8 : 16;
+	}
+
+	int GetBandCount() const
+	{
+		return ( m_height + 3 )/4;
+	}
+
+	//! Returns true if any bands were skipped because of the cancel flag.
+	bool IsCancelled() const
+	{
+		return m_cancelled != 0;
+	}
+
+	virtual void Run( int band, int /*worker*/ )
+	{
+		// skip the band once the caller has given up
+		if( m_cancel != NULL && *m_cancel != 0 )
+		{
+			m_cancelled = 1;
+			return;
+		}
+
+		// find the blocks and the pixel rows of this band
+		Kernels const& kernels = GetKernels();
+		int const y = 4*band;
+		int const rows = std::min( 4, m_height - y );
+		u8 const* sourceBlocks = m_blocks + m_bytesPerBlock*m_blocksWide*band;
+		u8* targetRow = m_pixels + m_stride*y;
+
+		// decompress whole rgba blocks straight into the image
+		int first = 0;
+		if( m_pixelFormat == kPixelRgba && rows == 4 )
+		{
+			first = m_width/4;
+			kernels.DecompressBlocks( sourceBlocks, first, m_flags, targetRow, m_stride );
+		}
+
+		// decompress the rest into a small band and copy the pixels that are in the image
+		for( ; first < m_blocksWide; first += kBandBlocks )
+		{
+			int const count = std::min( m_blocksWide - first, ( int )kBandBlocks );
+			int const pixelCount = std::min( 4*count, m_width - 4*first );
+			u8 bandRgba[4][kBandBlocks*16*4];
+			kernels.DecompressBlocks( sourceBlocks + m_bytesPerBlock*first, count, m_flags, bandRgba[0], sizeof( bandRgba[0] ) );
+			for( int row = 0; row < rows; ++row )
+			{
+				if( m_pixelFormat != kPixelRgba )
+					ConvertFromRgba( bandRgba[row], pixelCount, m_pixelFormat );
+				std::memcpy( targetRow + m_stride*row + 16*first, bandRgba[row], 4*pixelCount );
+			}
+		}
+
+		// count the rows for the progress reports
+		m_progress.Add( rows );
+	}
+
+	virtual void Poll()
+	{
+		m_progress.Poll();
 	}
 
+private:
+	u8* m_pixels;
+	int m_width;
+	int m_height;
+	int m_stride;
+	int m_pixelFormat;
+	u8 const* m_blocks;
+	int m_flags;
+	ProgressReporter m_progress;
+	int const volatile* m_cancel;
+	long volatile m_cancelled;
+	int m_blocksWide;
+	int m_bytesPerBlock;
+};
+
+void DecompressImage( u8* rgba, int width, int height, void const* blocks, int flags, ProgressFn progressFn )
+{
+	DecompressImage( rgba, width, height, 4*width, kPixelRgba, blocks, flags, progressFn, NULL );
+}
+
+int DecompressImage( u8* pixels, int width, int height, int stride, int pixelFormat, void const* blocks, int flags, ProgressFn progressFn, int const volatile* cancel )
+{
+	// fix any bad flags
+	flags = FixFlags( flags );
+
+	// keep the same kernels for every block of the image
+	KernelScope kernelScope;
+
+	if (progressFn != NULL)
+	{
+		progressFn(0, height);
+	}
+
+	// decompress the bands on the pool
+	DecompressImageTask task( pixels, width, height, stride, pixelFormat, reinterpret_cast< u8 const* >( blocks ), flags, progressFn, cancel );
+	ParallelFor( task, task.GetBandCount(), GetWorkerCount() );
+	if( task.IsCancelled() )
+		return kStatusCancelled;
+
 	if (progressFn != NULL)
 	{
 		progressFn(height, height);
 	}
+	return kStatusOk;
+}
+
+// the number of mipmap rows filtered at a time
+enum { kFilterBandRows = 4 };
+
+class FilterMipmapTask
+{
+public:
+	FilterMipmapTask( MipmapPixels const& converter, MipmapTaps const& columns, MipmapTaps const& rows, int sourceWidth, int sourceHeight, int targetWidth, int targetHeight, float* target, u8* targetRgba )
+	  : m_converter( converter ), 
+		m_columns( columns ), 
+		m_rows( rows ), 
+		m_sourcePixels( NULL ), 
+		m_sourceStride( 0 ), 
+		m_sourcePixelFormat( kPixelRgba ), 
+		m_sourceValues( NULL ), 
+		m_target( target ), 
+		m_targetRgba( targetRgba ), 
+		m_targetPixelFormat( kPixelRgba )
+	{
+		DirtyRect source = { 0, 0, sourceWidth, sourceHeight };
+		DirtyRect region = { 0, 0, targetWidth, targetHeight };
+		SetRegion( region, source );
+	}
+
+	/*! Filters just the target pixels in region, from source values that 
+		cover the source pixels in source, which must hold all the taps of
+		the region. The target values and rgba then cover just the region.
+	*/
+	void SetRegion( DirtyRect const& region, DirtyRect const& source )
+	{
+		m_region = region;
+		m_source = source;
+		m_columnStarts.resize( region.width );
+		for( int i = 0; i < region.width; ++i )
+			m_columnStarts[i] = m_columns.GetStarts()[region.x + i] - source.x;
+	}
+
+	//! Filters from the pixels of the image itself.
+	void SetSourcePixels( u8 const* pixels, int stride, int pixelFormat )
+	{
+		m_sourcePixels = pixels;
+		m_sourceStride = stride;
+		m_sourcePixelFormat = pixelFormat;
+	}
+
+	//! Filters from the values of the mipmap before.
+	void SetSourceValues( float const* values )
+	{
+		m_sourceValues = values;
+	}
+
+	//! Writes the target pixels in another layout instead of rgba.
+	void SetTargetPixelFormat( int pixelFormat )
+	{
+		m_targetPixelFormat = pixelFormat;
+	}
+
+	int GetBandCount() const
+	{
+		return ( m_region.height + kFilterBandRows - 1 )/kFilterBandRows;
+	}
+
+	int GetBandRows( int band ) const
+	{
+		return std::min( ( int )kFilterBandRows, m_region.height - kFilterBandRows*band );
+	}
+
+	void Run( int band ) const
+	{
+		// find the target rows of this band and the source rows they need
+		Kernels const& kernels = GetKernels();
+		int const y = m_region.y + kFilterBandRows*band;
+		int const rows = std::min( ( int )kFilterBandRows, m_region.y + m_region.height - y );
+		int const tapCount = m_rows.GetTapCount();
+		int const* starts = m_rows.GetStarts();
+		float const* weights = m_rows.GetWeights();
+		int const first = starts[y];
+		int const end = starts[y + rows - 1] + tapCount;
+		int const rowValues = 4*m_source.width;
+
+		// convert the source rows from the image itself if needed
+		std::vector< float > sourceValues;
+		if( m_sourcePixels != NULL )
+		{
+			sourceValues.resize( rowValues*( end - first ) );
+			std::vector< u8 > rowRgba( 4*m_source.width );
+			for( int r = first; r < end; ++r )
+			{
+				std::memcpy( &rowRgba[0], m_sourcePixels + m_sourceStride*r + 4*m_source.x, 4*m_source.width );
+				ConvertToRgba( &rowRgba[0], m_source.width, m_sourcePixelFormat );
+				m_converter.ToValues( &rowRgba[0], m_source.width, &sourceValues[rowValues*( r - first )] );
+			}
+		}
+
+		// filter each row down then across
+		std::vector< float const* > sourceRows( tapCount );
+		std::vector< float > column( rowValues );
+		float const* columnWeights = m_columns.GetWeights() + m_columns.GetTapCount()*m_region.x;
+		for( int row = y; row < y + rows; ++row )
+		{
+			for( int t = 0; t < tapCount; ++t )
+			{
+				int const r = starts[row] + t;
+				if( m_sourcePixels != NULL )
+					sourceRows[t] = &sourceValues[rowValues*( r - first )];
+				else
+					sourceRows[t] = m_sourceValues + rowValues*( r - m_source.y );
+			}
+			kernels.FilterRows( &sourceRows[0], weights + tapCount*row, tapCount, rowValues, &column[0] );
+
+			int const offset = 4*m_region.width*( row - m_region.y );
+			kernels.FilterPixels( &column[0], &m_columnStarts[0], columnWeights, m_columns.GetTapCount(), m_region.width, m_target + offset );
+			m_converter.ToRgba( m_target + offset, m_region.width, m_targetRgba + offset );
+			if( m_targetPixelFormat != kPixelRgba )
+				ConvertFromRgba( m_targetRgba + offset, m_region.width, m_targetPixelFormat );
+		}
+	}
+
+private:
+	MipmapPixels const& m_converter;
+	MipmapTaps const& m_columns;
+	MipmapTaps const& m_rows;
+	DirtyRect m_region;
+	DirtyRect m_source;
+	std::vector< int > m_columnStarts;
+	u8 const* m_sourcePixels;
+	int m_sourceStride;
+	int m_sourcePixelFormat;
+	float const* m_sourceValues;
+	float* m_target;
+	u8* m_targetRgba;
+	int m_targetPixelFormat;
+};
+
+class GenerateMipmapTask : public ParallelTask
+{
+public:
+	GenerateMipmapTask( FilterMipmapTask const& filter, ProgressReporter& progress, int const volatile* cancel )
+	  : m_filter( filter ), 
+		m_progress( progress ), 
+		m_cancel( cancel ), 
+		m_cancelled( 0 )
+	{
+	}
+
+	//! Returns true if any bands were skipped because of the cancel flag.
+	bool IsCancelled() const
+	{
+		return m_cancelled != 0;
+	}
+
+	virtual void Run( int band, int /*worker*/ )
+	{
+		// filter the band and count its rows
+		if( m_cancel != NULL && *m_cancel != 0 )
+		{
+			m_cancelled = 1;
+			return;
+		}
+		m_filter.Run( band );
+		m_progress.Add( m_filter.GetBandRows( band ) );
+	}
+
+	virtual void Poll()
+	{
+		m_progress.Poll();
+	}
+
+private:
+	FilterMipmapTask const& m_filter;
+	ProgressReporter& m_progress;
+	int const volatile* m_cancel;
+	long volatile m_cancelled;
+};
+
+class CompressMipmapTask : public ParallelTask
+{
+public:
+	CompressMipmapTask( CompressImageTask& compress, int tileCount, FilterMipmapTask const* filter, ProgressReporter& progress, int const volatile* cancel )
+	  : m_compress( compress ), 
+		m_filter( filter ), 
+		m_progress( progress ), 
+		m_cancel( cancel ), 
+		m_cancelled( 0 ), 
+		m_tileCount( tileCount ), 
+		m_bandCount( ( filter != NULL ) ? filter->GetBandCount() : 0 )
+	{
+	}
+
+	int GetItemCount() const
+	{
+		return m_bandCount + m_tileCount;
+	}
+
+	//! Returns true if any bands or tiles were skipped because of the cancel flag.
+	bool IsCancelled() const
+	{
+		return m_cancelled != 0 || m_compress.IsCancelled();
+	}
+
+	virtual void Run( int item, int worker )
+	{
+		// filter the bands of the next mipmap
+		if( item < m_bandCount )
+		{
+			if( m_cancel != NULL && *m_cancel != 0 )
+				m_cancelled = 1;
+			else
+				m_filter->Run( item );
+			return;
+		}
+
+		// compress the tiles of this one and count the blocks
+		int const tile = item - m_bandCount;
+		m_compress.Run( tile, worker );
+		m_progress.Add( m_compress.GetItemBlocks( tile ) );
+	}
+
+	virtual void Poll()
+	{
+		m_progress.Poll();
+	}
+
+private:
+	CompressImageTask& m_compress;
+	FilterMipmapTask const* m_filter;
+	ProgressReporter& m_progress;
+	int const volatile* m_cancel;
+	long volatile m_cancelled;
+	int m_tileCount;
+	int m_bandCount;
+};
+
+static int GetMipmapSize( int size, int level )
+{
+	return std::max( size >> level, 1 );
+}
+
+int GetMipmapCount( int width, int height )
+{
+	int count = 1;
+	while( width > 1 || height > 1 )
+	{
+		width /= 2;
+		height /= 2;
+		++count;
+	}
+	return count;
+}
+
+int GetMipmapStorageRequirements( int width, int height, int mipmapCount, int flags )
+{
+	mipmapCount = std::min( mipmapCount, GetMipmapCount( width, height ) );
+	int size = 0;
+	for( int level = 0; level < mipmapCount; ++level )
+		size += GetStorageRequirements( GetMipmapSize( width, level ), GetMipmapSize( height, level ), flags );
+	return size;
+}
+
+// builds the taps that filter each mipmap of a chain from the one before along one axis
+static void GetMipmapTaps( int filter, int size, int mipmapCount, std::vector< MipmapTaps >& taps )
+{
+	for( int level = 1; level < mipmapCount; ++level )
+		taps.push_back( MipmapTaps( filter, GetMipmapSize( size, level - 1 ), GetMipmapSize( size, level ) ) );
+}
+
+static int GetMipmapFilter( int mipmapFlags )
+{
+	int const filter = mipmapFlags & ( kMipmapKaiser | kMipmapLanczos );
+	if( filter != kMipmapKaiser && filter != kMipmapLanczos )
+		return kMipmapBox;
+	return filter;
+}
+
+// finds the target pixels that use any of the source pixels in [begin, end)
+static void GetTargetRange( MipmapTaps const& taps, int targetSize, int& begin, int& end )
+{
+	// the starts only go up, so the target pixels are a run
+	int const* starts = taps.GetStarts();
+	int const first = int( std::upper_bound( starts, starts + targetSize, begin - taps.GetTapCount() ) - starts );
+	int const last = int( std::lower_bound( starts, starts + targetSize, end ) - starts );
+	begin = first;
+	end = std::max( last, first );
+}
+
+// finds the source pixels that the target pixels in [begin, end) use
+static void GetSourceRange( MipmapTaps const& taps, int& begin, int& end )
+{
+	int const* starts = taps.GetStarts();
+	int const first = starts[begin];
+	end = starts[end - 1] + taps.GetTapCount();
+	begin = first;
+}
+
+// grows the rectangle to cover the pixels in [left, right) x [top, bottom) as well
+static void GrowRect( DirtyRect& rect, int left, int top, int right, int bottom )
+{
+	if( rect.width > 0 && rect.height > 0 )
+	{
+		left = std::min( left, rect.x );
+		top = std::min( top, rect.y );
+		right = std::max( right, rect.x + rect.width );
+		bottom = std::max( bottom, rect.y + rect.height );
+	}
+	rect.x = left;
+	rect.y = top;
+	rect.width = right - left;
+	rect.height = bottom - top;
+}
+
+// grows the rectangle to cover the whole blocks it touches of an image
+static void GrowBlockRect( DirtyRect& rect, int width, int height, int left, int top, int right, int bottom )
+{
+	GrowRect( rect, left & ~3, top & ~3, std::min( ( right + 3 ) & ~3, width ), std::min( ( bottom + 3 ) & ~3, height ) );
+}
+
+DirtyRect GetMipDirtyRect( DirtyRect const& rect, int width, int height, int level, int mipmapFlags )
+{
+	// clip the rectangle to the image
+	int left = std::max( rect.x, 0 );
+	int top = std::max( rect.y, 0 );
+	int right = std::min( rect.x + rect.width, width );
+	int bottom = std::min( rect.y + rect.height, height );
+
+	// carry it down the chain through the taps of each mipmap
+	int const filter = GetMipmapFilter( mipmapFlags );
+	level = std::min( level, GetMipmapCount( width, height ) - 1 );
+	for( int l = 1; l <= level && left < right && top < bottom; ++l )
+	{
+		int const mipWidth = GetMipmapSize( width, l );
+		int const mipHeight = GetMipmapSize( height, l );
+		GetTargetRange( MipmapTaps( filter, GetMipmapSize( width, l - 1 ), mipWidth ), mipWidth, left, right );
+		GetTargetRange( MipmapTaps( filter, GetMipmapSize( height, l - 1 ), mipHeight ), mipHeight, top, bottom );
+	}
+
+	DirtyRect result;
+	result.x = left;
+	result.y = top;
+	result.width = std::max( right - left, 0 );
+	result.height = std::max( bottom - top, 0 );
+	return result;
+}
+
+int CompressMipmaps( u8 const* pixels, int width, int height, int stride, int pixelFormat, int mipmapCount, int mipmapFlags, void* blocks, int flags, ProgressFn progressFn, int const volatile* cancel )
+{
+	// fix any bad flags
+	flags = FixFlags( flags );
+	int const filter = GetMipmapFilter( mipmapFlags );
+	mipmapCount = std::min( std::max( mipmapCount, 1 ), GetMipmapCount( width, height ) );
+
+	// keep the same kernels for every block of the chain
+	KernelScope kernelScope;
+
+	// report progress in blocks over the whole chain
+	int totalBlocks = 0;
+	for( int level = 0; level < mipmapCount; ++level )
+		totalBlocks += ( ( GetMipmapSize( width, level ) + 3 )/4 )*( ( GetMipmapSize( height, level ) + 3 )/4 );
+	ProgressReporter progress( progressFn, totalBlocks, totalBlocks );
+
+	if (progressFn != NULL)
+	{
+		progressFn(0, totalBlocks);
+	}
+
+	// the filtered mipmaps alternate between two sets of buffers
+	std::vector< MipmapTaps > columns;
+	std::vector< MipmapTaps > rows;
+	GetMipmapTaps( filter, width, mipmapCount, columns );
+	GetMipmapTaps( filter, height, mipmapCount, rows );
+	MipmapPixels const converter( mipmapFlags );
+	std::vector< u8 > levelRgba[2];
+	std::vector< float > levelValues[2];
+	int const workerCount = GetWorkerCount();
+	BlockCache* cache = CreateBlockCache( totalBlocks, workerCount, flags );
+	u8* output = reinterpret_cast< u8* >( blocks );
+	bool cancelled = false;
+	for( int level = 0; level < mipmapCount && !cancelled; ++level )
+	{
+		// compress the image itself, or the mipmap filtered during the last pass
+		int const levelWidth = GetMipmapSize( width, level );
+		int const levelHeight = GetMipmapSize( height, level );
+		int const current = level & 1;
+		int const next = current ^ 1;
+		CompressImageTask compress( 
+			( level == 0 ) ? pixels : &levelRgba[current][0], levelWidth, levelHeight, 
+			( level == 0 ) ? stride : 4*levelWidth, ( level == 0 ) ? pixelFormat : kPixelRgba, 
+			output, flags, NULL );
+		compress.SetCache( cache );
+		compress.SetCancel( cancel );
+
+		// filter the next mipmap from this one on the same pass
+		FilterMipmapTask* filterTask = NULL;
+		if( level + 1 < mipmapCount )
+		{
+			int const nextWidth = GetMipmapSize( width, level + 1 );
+			int const nextHeight = GetMipmapSize( height, level + 1 );
+			levelRgba[next].resize( 4*nextWidth*nextHeight );
+			levelValues[next].resize( 4*nextWidth*nextHeight );
+			filterTask = new FilterMipmapTask( converter, columns[level], rows[level], levelWidth, levelHeight, nextWidth, nextHeight, &levelValues[next][0], &levelRgba[next][0] );
+			if( level == 0 )
+				filterTask->SetSourcePixels( pixels, stride, pixelFormat );
+			else
+				filterTask->SetSourceValues( &levelValues[current][0] );
+		}
+
+		CompressMipmapTask task( compress, compress.GetTileCount(), filterTask, progress, cancel );
+		ParallelFor( task, task.GetItemCount(), workerCount );
+		cancelled = task.IsCancelled();
+		delete filterTask;
+
+		output += GetStorageRequirements( levelWidth, levelHeight, flags );
+	}
+	DestroyBlockCache( cache );
+	if( cancelled )
+		return kStatusCancelled;
+
+	if (progressFn != NULL)
+	{
+		progressFn(totalBlocks, totalBlocks);
+	}
+	return kStatusOk;
+}
+
+int RecompressMipmaps( u8 const* pixels, int width, int height, int stride, int pixelFormat, int mipmapCount, int mipmapFlags, void* blocks, int flags, DirtyRect const* rects, int rectCount, ProgressFn progressFn, int const volatile* cancel )
+{
+	// fix any bad flags
+	flags = FixFlags( flags );
+	int const filter = GetMipmapFilter( mipmapFlags );
+	mipmapCount = std::min( std::max( mipmapCount, 1 ), GetMipmapCount( width, height ) );
+
+	// keep the same kernels for every block of the chain
+	KernelScope kernelScope;
+
+	// carry each rectangle down the chain, and cover the blocks it changes in each mipmap
+	std::vector< MipmapTaps > columns;
+	std::vector< MipmapTaps > rows;
+	GetMipmapTaps( filter, width, mipmapCount, columns );
+	GetMipmapTaps( filter, height, mipmapCount, rows );
+	DirtyRect const none = { 0, 0, 0, 0 };
+	std::vector< DirtyRect > changed( mipmapCount*rectCount, none );
+	std::vector< DirtyRect > regions( mipmapCount, none );
+	for( int r = 0; r < rectCount; ++r )
+	{
+		int left = std::max( rects[r].x, 0 );
+		int top = std::max( rects[r].y, 0 );
+		int right = std::min( rects[r].x + rects[r].width, width );
+		int bottom = std::min( rects[r].y + rects[r].height, height );
+		for( int level = 0; level < mipmapCount; ++level )
+		{
+			int const levelWidth = GetMipmapSize( width, level );
+			int const levelHeight = GetMipmapSize( height, level );
+			if( level > 0 )
+			{
+				GetTargetRange( columns[level - 1], levelWidth, left, right );
+				GetTargetRange( rows[level - 1], levelHeight, top, bottom );
+			}
+			if( left >= right || top >= bottom )
+				break;
+
+			GrowRect( changed[mipmapCount*r + level], left, top, right, bottom );
+			GrowBlockRect( regions[level], levelWidth, levelHeight, left, top, right, bottom );
+		}
+	}
+
+	// each mipmap is filtered from the pixels under the taps of the next one, and the
+	// smallest mipmaps take in most of the image, so the regions grow back up the chain
+	for( int level = mipmapCount - 1; level > 1; --level )
+	{
+		DirtyRect const& region = regions[level];
+		if( region.width == 0 )
+			continue;
+
+		int left = region.x;
+		int top = region.y;
+		int right = region.x + region.width;
+		int bottom = region.y + region.height;
+		GetSourceRange( columns[level - 1], left, right );
+		GetSourceRange( rows[level - 1], top, bottom );
+		GrowBlockRect( regions[level - 1], GetMipmapSize( width, level - 1 ), GetMipmapSize( height, level - 1 ), left, top, right, bottom );
+	}
+
+	// flag the changed blocks within the region of each mipmap
+	std::vector< std::vector< u8 > > dirty( mipmapCount );
+	std::vector< int > dirtyCounts( mipmapCount, 0 );
+	int totalBlocks = 0;
+	for( int level = 0; level < mipmapCount; ++level )
+	{
+		DirtyRect const& region = regions[level];
+		int const blocksWide = ( region.width + 3 )/4;
+		dirty[level].assign( blocksWide*( ( region.height + 3 )/4 ), 0 );
+		for( int r = 0; r < rectCount; ++r )
+		{
+			DirtyRect const& rect = changed[mipmapCount*r + level];
+			if( rect.width == 0 )
+				continue;
+			for( int by = ( rect.y - region.y )/4; by < ( rect.y + rect.height - region.y + 3 )/4; ++by )
+			{
+				for( int bx = ( rect.x - region.x )/4; bx < ( rect.x + rect.width - region.x + 3 )/4; ++bx )
+				{
+					u8& flag = dirty[level][blocksWide*by + bx];
+					if( flag == 0 )
+					{
+						flag = 1;
+						++dirtyCounts[level];
+					}
+				}
+			}
+		}
+		totalBlocks += dirtyCounts[level];
+	}
+	ProgressReporter progress( progressFn, totalBlocks, totalBlocks );
+
+	if (progressFn != NULL)
+	{
+		progressFn(0, totalBlocks);
+	}
+
+	// the filtered regions alternate between two sets of buffers
+	MipmapPixels const converter( mipmapFlags );
+	std::vector< u8 > levelRgba[2];
+	std::vector< float > levelValues[2];
+	int const bytesPerBlock = ( ( flags & kDxt1 ) != 0 ) ? 8 : 16;
+	int const workerCount = GetWorkerCount();
+	BlockCache* cache = CreateBlockCache( totalBlocks, workerCount, flags );
+	u8* output = reinterpret_cast< u8* >( blocks );
+	bool cancelled = false;
+	for( int level = 0; level < mipmapCount && !cancelled; ++level )
+	{
+		// the regions only shrink down the chain, so stop at the first empty one
+		DirtyRect const& region = regions[level];
+		if( region.width == 0 )
+			break;
+
+		// compress the changed blocks of the region into their place in the whole mipmap
+		int const levelWidth = GetMipmapSize( width, level );
+		int const levelHeight = GetMipmapSize( height, level );
+		int const levelBlocksWide = ( levelWidth + 3 )/4;
+		int const current = level & 1;
+		int const next = current ^ 1;
+		CompressImageTask compress( 
+			( level == 0 ) ? pixels + stride*region.y + 4*region.x : &levelRgba[current][0], region.width, region.height, 
+			( level == 0 ) ? stride : 4*region.width, ( level == 0 ) ? pixelFormat : kPixelRgba, 
+			output + bytesPerBlock*( levelBlocksWide*( region.y/4 ) + region.x/4 ), flags, NULL );
+		compress.SetBlockPitch( levelBlocksWide );
+		compress.SetCache( cache );
+		compress.SetCancel( cancel );
+		std::vector< int > tiles;
+		GetDirtyTiles( compress, dirty[level], tiles );
+		compress.SetDirtyBlocks( &dirty[level][0], &tiles[0], dirtyCounts[level] );
+
+		// filter the region of the next mipmap from this one on the same pass
+		FilterMipmapTask* filterTask = NULL;
+		if( level + 1 < mipmapCount && regions[level + 1].width > 0 )
+		{
+			DirtyRect const& nextRegion = regions[level + 1];
+			levelRgba[next].resize( 4*nextRegion.width*nextRegion.height );
+			levelValues[next].resize( 4*nextRegion.width*nextRegion.height );
+			filterTask = new FilterMipmapTask( converter, columns[level], rows[level], levelWidth, levelHeight, 
+				GetMipmapSize( width, level + 1 ), GetMipmapSize( height, level + 1 ), &levelValues[next][0], &levelRgba[next][0] );
+			if( level == 0 )
+			{
+				// read just the pixels under the taps of the region
+				int left = nextRegion.x;
+				int top = nextRegion.y;
+				int right = nextRegion.x + nextRegion.width;
+				int bottom = nextRegion.y + nextRegion.height;
+				GetSourceRange( columns[0], left, right );
+				GetSourceRange( rows[0], top, bottom );
+				DirtyRect const source = { left, top, right - left, bottom - top };
+				filterTask->SetRegion( nextRegion, source );
+				filterTask->SetSourcePixels( pixels, stride, pixelFormat );
+			}
+			else
+			{
+				filterTask->SetRegion( nextRegion, region );
+				filterTask->SetSourceValues( &levelValues[current][0] );
+			}
+		}
+
+		CompressMipmapTask task( compress, ( int )tiles.size(), filterTask, progress, cancel );
+		ParallelFor( task, task.GetItemCount(), workerCount );
+		cancelled = task.IsCancelled();
+		delete filterTask;
+
+		output += GetStorageRequirements( levelWidth, levelHeight, flags );
+	}
+	DestroyBlockCache( cache );
+	if( cancelled )
+		return kStatusCancelled;
+
+	if (progressFn != NULL)
+	{
+		progressFn(totalBlocks, totalBlocks);
+	}
+	return kStatusOk;
+}
+
+int GenerateMipmaps( u8 const* pixels, int width, int height, int stride, int pixelFormat, int mipmapCount, int mipmapFlags, void* mipmaps, ProgressFn progressFn, int const volatile* cancel )
+{
+	int const filter = GetMipmapFilter( mipmapFlags );
+	mipmapCount = std::min( std::max( mipmapCount, 1 ), GetMipmapCount( width, height ) );
+
+	// keep the same kernels for every mipmap of the chain
+	KernelScope kernelScope;
+
+	// report progress in rows over the whole chain
+	int totalRows = 0;
+	for( int level = 1; level < mipmapCount; ++level )
+		totalRows += GetMipmapSize( height, level );
+	ProgressReporter progress( progressFn, totalRows, totalRows );
+
+	if (progressFn != NULL)
+	{
+		progressFn(0, totalRows);
+	}
+
+	// filter each mipmap from the values of the one before, as CompressMipmaps does
+	std::vector< MipmapTaps > columns;
+	std::vector< MipmapTaps > rows;
+	GetMipmapTaps( filter, width, mipmapCount, columns );
+	GetMipmapTaps( filter, height, mipmapCount, rows );
+	MipmapPixels const converter( mipmapFlags );
+	std::vector< float > levelValues[2];
+	int const workerCount = GetWorkerCount();
+	u8* output = reinterpret_cast< u8* >( mipmaps );
+	bool cancelled = false;
+	for( int level = 1; level < mipmapCount && !cancelled; ++level )
+	{
+		int const levelWidth = GetMipmapSize( width, level );
+		int const levelHeight = GetMipmapSize( height, level );
+		int const current = level & 1;
+		int const previous = current ^ 1;
+		levelValues[current].resize( 4*levelWidth*levelHeight );
+		FilterMipmapTask filterTask( converter, columns[level - 1], rows[level - 1], GetMipmapSize( width, level - 1 ), GetMipmapSize( height, level - 1 ), 
+			levelWidth, levelHeight, &levelValues[current][0], output );
+		filterTask.SetTargetPixelFormat( pixelFormat );
+		if( level == 1 )
+			filterTask.SetSourcePixels( pixels, stride, pixelFormat );
+		else
+			filterTask.SetSourceValues( &levelValues[previous][0] );
+
+		GenerateMipmapTask task( filterTask, progress, cancel );
+		ParallelFor( task, filterTask.GetBandCount(), workerCount );
+		cancelled = task.IsCancelled();
+
+		output += 4*levelWidth*levelHeight;
+	}
+	if( cancelled )
+		return kStatusCancelled;
+
+	if (progressFn != NULL)
+	{
+		progressFn(totalRows, totalRows);
+	}
+	return kStatusOk;
 }
 
 } // namespace squish
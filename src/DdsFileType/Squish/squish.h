@@ -63,6 +63,24 @@ enum
 	//! Use a fast but low quality colour compressor.
 	kColourRangeFit	= ( 1 << 4 ),
 	
+	//! Compress the blocks that the fast fit does badly again with the cluster fit (see squish::GetEffortFlags).
+	kColourAdaptiveFit = ( 1 << 9 ),
+	
+	//! Use a very fast but lowest quality compressor, for previews.
+	kColourFastFit = ( 1 << 11 ),
+	
+	//! Run the cluster fits in integers, for the same blocks on every platform.
+	kColourFixedPoint = ( 1 << 10 ),
+	
+	//! Estimate the principle axis of the colours by power iteration, rather than solving for it.
+	kColourPowerIteration = ( 1 << 16 ),
+	
+	//! Refine the DXT5 alpha end points by least squares, for a slower but closer fit.
+	kAlphaIterativeFit = ( 1 << 17 ),
+	
+	//! The bits that hold the effort level of kColourAdaptiveFit.
+	kColourEffortMask = ( 15 << 12 ),
+	
 	//! Use a perceptual metric for colour error (the default).
 	kColourMetricPerceptual = ( 1 << 5 ),
 
@@ -94,20 +112,72 @@ enum
 	The flags parameter can also specify a preferred colour compressor and 
 	colour error metric to use when fitting the RGB components of the data. 
 	Possible colour compressors are: kColourClusterFit (the default), 
-	kColourRangeFit or kColourIterativeClusterFit. Possible colour error metrics 
-	are: kColourMetricPerceptual (the default) or kColourMetricUniform. If no 
-	flags are specified in any particular category then the default will be 
-	used. Unknown flags are ignored.
+	kColourRangeFit, kColourIterativeClusterFit, kColourFastFit or 
+	kColourAdaptiveFit with an effort level from squish::GetEffortFlags. 
+	Possible colour error metrics are: kColourMetricPerceptual (the default) 
+	or kColourMetricUniform. If no flags are specified in any particular 
+	category then the default will be used. Unknown flags are ignored.
+	
+	kColourFastFit is meant for previews. It takes the end points from the
+	bounding box of the colours and picks the nearest palette entry of each
+	pixel in integers, ignoring the metric. With DXT5 it also fits alpha to 
+	the range of the values alone.
 	
 	When using kColourClusterFit, an additional flag can be specified to
 	weight the colour of each pixel by its alpha value. For images that are
 	rendered using alpha blending, this can significantly increase the 
 	perceived quality.
+	
+	The cluster fits normally work in floating point, so the blocks can vary
+	slightly between builds for different instruction sets. Adding 
+	kColourFixedPoint runs them in exact integer arithmetic instead, which 
+	gives the same blocks on every platform. It also measures the error of
+	the decoded palette exactly, and weights alpha in 16ths of a pixel.
+	
+	The range and cluster fits start from the principle axis of the colours,
+	which is solved for exactly by default. Adding kColourPowerIteration 
+	estimates it with a few power iterations instead, which is cheaper and 
+	vectorises across blocks, but can pick a slightly different axis when 
+	the colours spread nearly as far in two directions.
+	
+	DXT5 alpha is fitted to the range of the values with both code books. 
+	Adding kAlphaIterativeFit then moves the end points of each code book 
+	to the least squares fit of its indices while that lowers the error.
+	
+	Blocks whose pixels are all the same are written straight from lookup 
+	tables, giving the same blocks as the fits would, except with 
+	kColourFastFit which always fits the bounding box.
 */
 void Compress( u8 const* rgba, void* block, int flags );
 
 // -----------------------------------------------------------------------------
 
+/*! @brief Gets the flags for adaptive colour compression at an effort level.
+
+	@param effort	The effort level, from 0 for the fastest to 5 for the best.
+	
+	The flags are kColourAdaptiveFit with the effort level in the bits of 
+	kColourEffortMask, and are combined with the other flags as usual. Each
+	block is compressed with kColourFastFit first, which also gives the 
+	squared RGB error of the block. Only the blocks whose error is over the
+	threshold of the level are compressed again with kColourClusterFit. The
+	thresholds halve from 6400 at level 0 to 200 at level 5, so a level 
+	spends its time on the blocks the fast fit did worst. Alpha is fitted 
+	as it is for the other colour compressors.
+	
+	The levels lie between kColourFastFit and kColourClusterFit in both 
+	speed and quality. On a 512x512 photo, level 0 costs about the same as 
+	the fast fit, level 3 gets 0.8dB of the 1.3dB between the two in the 
+	perceptual metric in a quarter of the time of the cluster fit, and 
+	level 5 is within 0.05dB of the cluster fit in 75% of its time. Detailed
+	images have more blocks over the thresholds, so there the upper levels 
+	cost close to the cluster fit. Escalating to kColourIterativeClusterFit
+	gains too little over the cluster fit for its cost, so no level uses it.
+*/
+int GetEffortFlags( int effort );
+
+// -----------------------------------------------------------------------------
+
 /*! @brief Compresses a 4x4 block of pixels.
 
 	@param rgba		The rgba values of the 16 source pixels.
@@ -149,6 +219,29 @@ void CompressMasked( u8 const* rgba, int mask, void* block, int flags );
 
 // -----------------------------------------------------------------------------
 
+/*! @brief Compresses a run of 4x4 blocks of pixels.
+
+	@param rgba		The rgba values of the 16 source pixels of each block.
+	@param masks	The valid pixel mask of each block.
+	@param count	The number of blocks.
+	@param blocks	Storage for the compressed DXT blocks.
+	@param flags	Compression flags.
+	
+	The source pixels should be presented as count contiguous arrays of 16 
+	rgba values, laid out as for squish::CompressMasked, and the compressed 
+	blocks are written one after the other. The output is identical to 
+	calling squish::CompressMasked on each block in turn.
+	
+	Groups of 4 blocks are compressed together with one block in each lane 
+	of the SIMD registers. This covers the covariance and range of the range
+	fit. Blocks with a single colour, the cluster fits and DXT5 alpha are 
+	still compressed one block at a time, and the DXT5 alpha fit matches the
+	16 pixels of a block to each code book at once instead.
+*/
+void CompressMaskedBlocks( u8 const* rgba, int const* masks, int count, void* blocks, int flags );
+
+// -----------------------------------------------------------------------------
+
 /*! @brief Decompresses a 4x4 block of pixels.
 
 	@param rgba		Storage for the 16 decompressed pixels.
@@ -217,14 +310,94 @@ int GetStorageRequirements( int width, int height, int flags );
 	rendered using alpha blending, this can significantly increase the 
 	perceived quality.
 	
-	Internally this function calls squish::Compress for each block. To see how
-	much memory is required in the compressed image, use
-	squish::GetStorageRequirements.
+	Internally this function calls squish::CompressMaskedBlocks for each tile
+	of blocks, skipping the blocks that were already compressed earlier in 
+	the image, see squish::SetBlockCache. To see how much memory is required 
+	in the compressed image, use squish::GetStorageRequirements.
+
+	The blocks are compressed in tiles on a persistent pool of worker threads,
+	see squish::SetThreadCount. The progress function is only called on the 
+	calling thread, at most once for each 1% of the blocks or every 50ms.
 */
 void CompressImage( u8 const* rgba, int width, int height, void* blocks, int flags, ProgressFn progressFn );
 
 // -----------------------------------------------------------------------------
 
+//! A rectangle of pixels within an image.
+struct DirtyRect
+{
+	//! The left edge of the rectangle.
+	int x;
+
+	//! The top edge of the rectangle.
+	int y;
+
+	//! The width of the rectangle.
+	int width;
+
+	//! The height of the rectangle.
+	int height;
+};
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Recompresses the parts of an image that have changed.
+
+	@param rgba			The pixels of the source.
+	@param width		The width of the source image.
+	@param height		The height of the source image.
+	@param blocks		The compressed image to update.
+	@param flags		Compression flags.
+	@param rects		The rectangles of pixels that have changed.
+	@param rectCount	The number of rectangles.
+	@param progressFn	The progress function, or NULL.
+	
+	The blocks should hold the output of an earlier squish::CompressImage of
+	an image of the same size with the same flags. Only the 4x4 blocks that 
+	overlap one of the rectangles are compressed again, and the rest of the 
+	blocks are left alone, so the result is the same as compressing the new 
+	image in full as long as every changed pixel is inside a rectangle. The
+	rectangles are clipped to the image and may overlap.
+
+	A small edit to a large image only costs the time of the blocks it 
+	touches. Use squish::RecompressMipmaps to update a whole mipmap chain, 
+	or squish::GetMipDirtyRect to find the rectangles that change in each
+	mipmap.
+*/
+void RecompressImage( u8 const* rgba, int width, int height, void* blocks, int flags, DirtyRect const* rects, int rectCount, ProgressFn progressFn );
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Recompresses the parts of an image in memory with any row stride and channel order.
+
+	This is the same as the other squish::RecompressImage, except that the 
+	pixels are read as for the strided squish::CompressImage, which also
+	describes the cancel flag and the return value.
+*/
+int RecompressImage( u8 const* pixels, int width, int height, int stride, int pixelFormat, void* blocks, int flags, DirtyRect const* rects, int rectCount, ProgressFn progressFn, int const volatile* cancel );
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Maps a changed rectangle of an image onto one of its mipmaps.
+
+	@param rect			The rectangle of the full size image.
+	@param width		The width of the full size image.
+	@param height		The height of the full size image.
+	@param level		The mipmap, where 0 is the image itself.
+	@param mipmapFlags	The mipmap flags, as for squish::CompressMipmaps.
+	
+	Returns the rectangle of pixels in the mipmap that can change when the 
+	pixels in rect change, for mipmaps made by squish::CompressMipmaps with
+	the same mipmap flags. Each mipmap is filtered from the one before, so 
+	the rectangle is carried down the chain one mipmap at a time through 
+	the taps of the filter. The box filter only reaches the pixels under 
+	each mipmap pixel, but the sinc filters reach 3 mipmap pixels further on
+	each side, and that margin is added again at every mipmap down the chain.
+*/
+DirtyRect GetMipDirtyRect( DirtyRect const& rect, int width, int height, int level, int mipmapFlags );
+
+// -----------------------------------------------------------------------------
+
 /*! @brief Decompresses an image in memory.
 
 	@param rgba		Storage for the decompressed pixels.
@@ -242,12 +415,616 @@ void CompressImage( u8 const* rgba, int width, int height, void* blocks, int fla
 	however, DXT1 will be used by default if none is specified. All other flags 
 	are ignored.
 
-	Internally this function calls squish::Decompress for each block.
+	Each band of 4 rows is decoded a whole row of blocks at a time, straight
+	into the output where the layout allows, using SIMD instructions when the
+	processor supports them. The output is identical to calling 
+	squish::Decompress for each block. The bands are decoded on the same pool
+	of worker threads as squish::CompressImage, and the progress function is
+	called on the calling thread in the same way.
 */
 void DecompressImage( u8* rgba, int width, int height, void const* blocks, int flags, ProgressFn progressFn );
 
 // -----------------------------------------------------------------------------
 
+//! The layouts of the pixels of an image in memory.
+enum
+{
+	//! Bytes in the order red, green, blue, alpha.
+	kPixelRgba = 0, 
+	
+	//! Bytes in the order blue, green, red, alpha.
+	kPixelBgra = ( 1 << 0 ), 
+	
+	//! The colour has been multiplied by alpha.
+	kPixelPremultiplied = ( 1 << 1 )
+};
+
+// -----------------------------------------------------------------------------
+
+//! The results of the image functions that can be cancelled.
+enum
+{
+	//! Every block of the image was processed.
+	kStatusOk = 0, 
+	
+	//! The cancel flag was set before every block was processed.
+	kStatusCancelled = 1, 
+
+	//! A background job has not finished yet.
+	kStatusRunning = 2
+};
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Compresses an image in memory with any row stride and channel order.
+
+	@param pixels		The first row of the source.
+	@param width		The width of the source image.
+	@param height		The height of the source image.
+	@param stride		The distance in bytes from one row to the next.
+	@param pixelFormat	The layout of the pixels, kPixelRgba or kPixelBgra, 
+						optionally with kPixelPremultiplied.
+	@param blocks		Storage for the compressed output.
+	@param flags		Compression flags.
+	@param progressFn	The progress function, or NULL.
+	@param cancel		A flag that another thread sets to non-zero to stop
+						the work early, or NULL.
+	
+	This is the same as the other squish::CompressImage, except that the 
+	pixels are read straight from the caller's memory. Each pixel is 4 
+	bytes, but the rows may have padding between them. BGRA pixels are 
+	swapped and premultiplied colours are divided by alpha as each block is
+	read, so no copy of the image is ever made.
+
+	The workers check the cancel flag before each tile, so once it is set 
+	the function returns within the time of a tile or so. It returns 
+	kStatusCancelled if any blocks were skipped, in which case the output
+	is incomplete and the final progress report is not made, or kStatusOk 
+	otherwise.
+*/
+int CompressImage( u8 const* pixels, int width, int height, int stride, int pixelFormat, void* blocks, int flags, ProgressFn progressFn, int const volatile* cancel );
+
+// -----------------------------------------------------------------------------
+
+//! The errors of an image against its source, measured as it was compressed.
+struct CompressionStats
+{
+	//! The mean squared error of the red, green, blue and alpha channels.
+	double mse[4];
+
+	//! The peak signal to noise ratio of each channel in dB, infinite if it has no error.
+	double psnr[4];
+
+	//! The largest squared error of a block, summed over its pixels and channels.
+	int maxBlockError;
+
+	//! The index of the block with the largest error, in row order.
+	int maxBlock;
+
+	//! Storage for the squared error of every block in row order, or NULL.
+	int* blockErrors;
+};
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Compresses an image and measures the error of the result.
+
+	@param pixels		The first row of the source.
+	@param width		The width of the source image.
+	@param height		The height of the source image.
+	@param stride		The distance in bytes from one row to the next.
+	@param pixelFormat	The layout of the pixels, kPixelRgba or kPixelBgra, 
+						optionally with kPixelPremultiplied.
+	@param blocks		Storage for the compressed output.
+	@param flags		Compression flags.
+	@param progressFn	The progress function, or NULL.
+	@param cancel		A flag that another thread sets to non-zero to stop
+						the work early, or NULL.
+	@param stats		The error statistics to fill in.
+	
+	This is the same as the strided squish::CompressImage, except that each 
+	tile of blocks is decoded again while its source pixels are still in the
+	cache and compared against them, so there is no second pass over the 
+	image. The errors are in 0-255 units against the straight rgba pixels 
+	that were compressed, without the colour metric or alpha weighting, and
+	pixels outside the image are not counted. If blockErrors is not NULL it 
+	must have room for one value per block, as for GetStorageRequirements.
+
+	The stats are only filled in if the function returns kStatusOk.
+*/
+int CompressImage( u8 const* pixels, int width, int height, int stride, int pixelFormat, void* blocks, int flags, ProgressFn progressFn, int const volatile* cancel, CompressionStats* stats );
+
+// -----------------------------------------------------------------------------
+
+//! One image of a batch compressed by squish::CompressImages.
+struct BatchImage
+{
+	//! The first row of the source.
+	u8 const* pixels;
+
+	//! The width of the source image.
+	int width;
+
+	//! The height of the source image.
+	int height;
+
+	//! The distance in bytes from one row to the next.
+	int stride;
+
+	//! The layout of the pixels, as for the strided squish::CompressImage.
+	int pixelFormat;
+
+	//! Storage for the compressed output.
+	void* blocks;
+
+	//! Compression flags.
+	int flags;
+};
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Compresses a list of images as a single job.
+
+	@param images		The images to compress.
+	@param count		The number of images.
+	@param progressFn	The progress function, or NULL.
+	@param cancel		A flag that another thread sets to non-zero to stop
+						the work early, or NULL.
+	
+	Each image is compressed exactly as the strided squish::CompressImage 
+	would, but the tiles of all the images are handed out to the pool 
+	together. Small images no longer wait for the workers to start and stop
+	one at a time, and a few large images among many small ones still 
+	balance across the workers. The faces of a cube map, the slices of an 
+	array texture and the mipmaps of each are all just entries in the list.
+	
+	Images with the same flags share a block cache, so blocks repeated 
+	between them are only compressed once. Progress is reported in blocks
+	out of the total of all the images, and the return value is as for the
+	strided squish::CompressImage.
+*/
+int CompressImages( BatchImage const* images, int count, ProgressFn progressFn, int const volatile* cancel );
+
+// -----------------------------------------------------------------------------
+
+//! A compression job running in the background, see squish::SubmitImages.
+class Job;
+
+//! The function called once when a background job finishes, with its status.
+typedef void (__stdcall *CompletionFn)(int status);
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Starts compressing a list of images in the background.
+
+	@param images		The images to compress.
+	@param count		The number of images.
+	@param progressFn	The progress function, or NULL.
+	@param completionFn	The function to call when the job finishes, or NULL.
+	
+	The images are compressed as squish::CompressImages would, on a thread
+	of the job's own that drives the shared pool, and this returns straight
+	away. The list itself is copied, but the pixels and the outputs must 
+	stay valid until the job has finished. The caller is free to do other 
+	work meanwhile, such as writing the parts of a file that are already 
+	known, and can check on the job with squish::PollJob or block with 
+	squish::WaitJob. 
+	
+	The progress function and the completion function are both called on 
+	the job's thread. The completion function is called exactly once, 
+	whether the job finished or was cancelled, and before the job counts as
+	finished, so it must not wait for its own job. If other images are 
+	being compressed at the same time, the job shares the threads of the 
+	pool with them.
+	
+	Every job must be given back with squish::ReleaseJob.
+*/
+Job* SubmitImages( BatchImage const* images, int count, ProgressFn progressFn, CompletionFn completionFn );
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Checks on a background job without waiting.
+
+	Returns kStatusRunning until the job has finished and its completion 
+	function has returned, then the status that squish::CompressImages 
+	returned.
+*/
+int PollJob( Job* job );
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Waits for a background job to finish and returns its status.
+*/
+int WaitJob( Job* job );
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Asks a background job to stop early.
+
+	The job stops within the time of a tile or so and finishes with 
+	kStatusCancelled, unless every block was already done.
+*/
+void CancelJob( Job* job );
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Gives back a background job.
+
+	The handle must not be used again. A job that is still running carries
+	on until it finishes and then frees itself, so call squish::CancelJob 
+	first if the output is no longer wanted.
+*/
+void ReleaseJob( Job* job );
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Decompresses an image in memory with any row stride and channel order.
+
+	@param pixels		The first row of storage for the decompressed pixels.
+	@param width		The width of the source image.
+	@param height		The height of the source image.
+	@param stride		The distance in bytes from one row to the next.
+	@param pixelFormat	The layout of the pixels, kPixelRgba or kPixelBgra, 
+						optionally with kPixelPremultiplied.
+	@param blocks		The compressed DXT blocks.
+	@param flags		Compression flags.
+	@param progressFn	The progress function, or NULL.
+	@param cancel		A flag that another thread sets to non-zero to stop
+						the work early, or NULL.
+	
+	This is the same as the other squish::DecompressImage, except that the
+	pixels are written straight to the caller's memory in the given layout.
+	Any padding at the end of each row is left alone. The cancel flag is 
+	checked before each band of 4 rows, and the return value is as for the
+	strided squish::CompressImage.
+*/
+int DecompressImage( u8* pixels, int width, int height, int stride, int pixelFormat, void const* blocks, int flags, ProgressFn progressFn, int const volatile* cancel );
+
+// -----------------------------------------------------------------------------
+
+//! The filters and options for generating mipmaps.
+enum
+{
+	//! Average the pixels that each mipmap pixel covers (the default).
+	kMipmapBox = 0, 
+	
+	//! Use a Kaiser windowed sinc filter, which keeps the mipmaps sharper.
+	kMipmapKaiser = 1, 
+	
+	//! Use a 3 lobe Lanczos filter, which is sharper again but can ring.
+	kMipmapLanczos = 2, 
+	
+	//! Filter the colours in linear light, treating the pixels as sRGB.
+	kMipmapGammaCorrect = ( 1 << 4 ), 
+	
+	//! Weight the colours by alpha, so transparent pixels do not bleed.
+	kMipmapWeightByAlpha = ( 1 << 5 )
+};
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Computes the number of mipmaps in a full chain.
+
+	@param width	The width of the image.
+	@param height	The height of the image.
+	
+	Each mipmap is half the size of the one before, rounded down to no less
+	than 1 pixel, and the chain includes the image itself and ends at 1x1.
+*/
+int GetMipmapCount( int width, int height );
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Computes the amount of compressed storage required for mipmaps.
+
+	@param width		The width of the image.
+	@param height		The height of the image.
+	@param mipmapCount	The number of mipmaps, including the image itself.
+	@param flags		Compression flags.
+	
+	This is the sum of squish::GetStorageRequirements over the mipmaps.
+*/
+int GetMipmapStorageRequirements( int width, int height, int mipmapCount, int flags );
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Generates the mipmaps of an image and compresses them all.
+
+	@param pixels		The first row of the source.
+	@param width		The width of the source image.
+	@param height		The height of the source image.
+	@param stride		The distance in bytes from one row to the next.
+	@param pixelFormat	The layout of the pixels, as for squish::CompressImage.
+	@param mipmapCount	The number of mipmaps, including the image itself.
+	@param mipmapFlags	The mipmap filter, optionally with kMipmapGammaCorrect
+						and kMipmapWeightByAlpha.
+	@param blocks		Storage for the compressed output.
+	@param flags		Compression flags.
+	@param progressFn	The progress function, or NULL.
+	@param cancel		A flag that another thread sets to non-zero to stop
+						the work early, or NULL.
+	
+	The compressed mipmaps are written one after another, starting with the
+	image itself, which is the layout of a DDS file. Use 
+	squish::GetMipmapStorageRequirements to see how much memory is required.
+	
+	Each mipmap is filtered from the one before in floating point, so the 
+	rounding errors do not build up down the chain. The filtering runs on 
+	the same pool of worker threads as the compression, and each mipmap is
+	filtered while the blocks of the one before are still being compressed.
+	The progress function is called on the calling thread with the number 
+	of blocks done out of the total for the chain, and the cancel flag and 
+	the return value are as for the strided squish::CompressImage.
+*/
+int CompressMipmaps( u8 const* pixels, int width, int height, int stride, int pixelFormat, int mipmapCount, int mipmapFlags, void* blocks, int flags, ProgressFn progressFn, int const volatile* cancel );
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Updates compressed mipmaps for the parts of an image that have changed.
+
+	@param pixels		The first row of the source.
+	@param width		The width of the source image.
+	@param height		The height of the source image.
+	@param stride		The distance in bytes from one row to the next.
+	@param pixelFormat	The layout of the pixels, as for squish::CompressImage.
+	@param mipmapCount	The number of mipmaps, including the image itself.
+	@param mipmapFlags	The mipmap filter and options, as for squish::CompressMipmaps.
+	@param blocks		The compressed mipmaps to update.
+	@param flags		Compression flags.
+	@param rects		The rectangles of pixels that have changed.
+	@param rectCount	The number of rectangles.
+	@param progressFn	The progress function, or NULL.
+	@param cancel		A flag that another thread sets to non-zero to stop
+						the work early, or NULL.
+	
+	The blocks should hold the output of an earlier squish::CompressMipmaps
+	of an image of the same size with the same flags. Each rectangle is 
+	carried down the chain as for squish::GetMipDirtyRect, and only the 
+	blocks it reaches are compressed again, so the result is the same as 
+	compressing the new image in full as long as every changed pixel is 
+	inside a rectangle.
+	
+	Each mipmap is only filtered over the region that covers its changed 
+	blocks and the taps of the region of the next mipmap. A block needs all
+	of its pixels, and the last few mipmaps are a block or so that depends 
+	on the whole image, so the first mipmaps are filtered over most of the 
+	image, but filtering is a small part of the cost of the chain and only
+	the changed blocks are compressed. The progress function is called with
+	the number of blocks done out of the number to compress, and the cancel
+	flag and the return value are as for the strided squish::CompressImage.
+	A cancelled update leaves some of the blocks out of date.
+*/
+int RecompressMipmaps( u8 const* pixels, int width, int height, int stride, int pixelFormat, int mipmapCount, int mipmapFlags, void* blocks, int flags, DirtyRect const* rects, int rectCount, ProgressFn progressFn, int const volatile* cancel );
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Generates the mipmaps of an image without compressing them.
+
+	@param pixels		The first row of the source.
+	@param width		The width of the source image.
+	@param height		The height of the source image.
+	@param stride		The distance in bytes from one row to the next.
+	@param pixelFormat	The layout of the pixels, as for squish::CompressImage.
+	@param mipmapCount	The number of mipmaps, including the image itself.
+	@param mipmapFlags	The mipmap filter and options, as for squish::CompressMipmaps.
+	@param mipmaps		Storage for the mipmaps after the image itself.
+	@param progressFn	The progress function, or NULL.
+	@param cancel		A flag that another thread sets to non-zero to stop
+						the work early, or NULL.
+	
+	The mipmaps are filtered just as squish::CompressMipmaps filters them, 
+	so an uncompressed chain matches a compressed one. They are written one
+	after another from the first mipmap below the image itself, each with 
+	the pixel layout of the source and rows of 4*width bytes. The progress
+	function is called with the number of rows done out of the total for 
+	the chain, and the cancel flag and the return value are as for the 
+	strided squish::CompressImage.
+*/
+int GenerateMipmaps( u8 const* pixels, int width, int height, int stride, int pixelFormat, int mipmapCount, int mipmapFlags, void* mipmaps, ProgressFn progressFn, int const volatile* cancel );
+
+// -----------------------------------------------------------------------------
+
+//! The uncompressed pixel formats of DDS files, with channels from the top bit down.
+enum
+{
+	//! 32 bits with 8 bits each of alpha, red, green and blue.
+	kFormatA8R8G8B8 = 0,
+
+	//! 32 bits with 8 unused bits and 8 bits each of red, green and blue.
+	kFormatX8R8G8B8 = 1,
+
+	//! 32 bits with 8 bits each of alpha, blue, green and red.
+	kFormatA8B8G8R8 = 2,
+
+	//! 32 bits with 8 unused bits and 8 bits each of blue, green and red.
+	kFormatX8B8G8R8 = 3,
+
+	//! 16 bits with 1 bit of alpha and 5 bits each of red, green and blue.
+	kFormatA1R5G5B5 = 4,
+
+	//! 16 bits with 4 bits each of alpha, red, green and blue.
+	kFormatA4R4G4B4 = 5,
+
+	//! 24 bits with 8 bits each of red, green and blue.
+	kFormatR8G8B8 = 6,
+
+	//! 16 bits with 5 bits of red, 6 bits of green and 5 bits of blue.
+	kFormatR5G6B5 = 7
+};
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Gets the number of bytes in a pixel of an uncompressed format.
+
+	@param format	The packed format, such as kFormatA8R8G8B8.
+
+	Returns 2, 3 or 4, or 0 if the format is not known.
+*/
+int GetFormatPixelSize( int format );
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Packs an image into one of the uncompressed DDS formats.
+
+	@param pixels		The first row of the source.
+	@param width		The width of the source image.
+	@param height		The height of the source image.
+	@param stride		The distance in bytes from one row to the next.
+	@param pixelFormat	The layout of the pixels, kPixelRgba or kPixelBgra.
+	@param packed		Storage for the first packed row.
+	@param pitch		The distance in bytes from one packed row to the next.
+	@param format		The packed format, such as kFormatA8R8G8B8.
+	@param progressFn	The progress function, or NULL.
+	@param cancel		A flag that another thread sets to non-zero to stop
+						the work early, or NULL.
+
+	Each channel keeps its top bits, the alpha bit of kFormatA1R5G5B5 is set
+	for any alpha above zero, and the unused byte of the X formats is zero.
+	The packed pixels are little endian, which is how DDS files store them,
+	and any padding at the end of each packed row is left alone. Pixels with
+	kPixelPremultiplied are packed as they are.
+
+	The rows are packed in bands on the same pool of worker threads as
+	squish::CompressImage, using SIMD shuffles when the processor supports
+	them. The progress function is called on the calling thread with the
+	number of rows done, and the cancel flag and the return value are as for
+	the strided squish::CompressImage.
+*/
+int PackImage( u8 const* pixels, int width, int height, int stride, int pixelFormat, void* packed, int pitch, int format, ProgressFn progressFn, int const volatile* cancel );
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Unpacks an image from one of the uncompressed DDS formats.
+
+	@param pixels		The first row of storage for the unpacked pixels.
+	@param width		The width of the image.
+	@param height		The height of the image.
+	@param stride		The distance in bytes from one row to the next.
+	@param pixelFormat	The layout of the pixels, kPixelRgba or kPixelBgra.
+	@param packed		The first packed row.
+	@param pitch		The distance in bytes from one packed row to the next.
+	@param format		The packed format, such as kFormatA8R8G8B8.
+	@param progressFn	The progress function, or NULL.
+	@param cancel		A flag that another thread sets to non-zero to stop
+						the work early, or NULL.
+
+	This is the reverse of squish::PackImage. Each channel is widened to 8
+	bits by repeating its top bits, so that the largest value becomes 255,
+	and the formats without alpha are unpacked as opaque.
+*/
+int UnpackImage( u8* pixels, int width, int height, int stride, int pixelFormat, void const* packed, int pitch, int format, ProgressFn progressFn, int const volatile* cancel );
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Sets the number of threads used to compress images.
+
+	@param count	The thread count, or 0 for one thread per processor.
+
+	The worker threads are created on first use and reused by later calls.
+	The thread calling into squish always takes part in the work, so a count
+	of 1 compresses everything on the calling thread. Changing the count
+	recreates the pool on the next call that finds it idle. Images that are
+	compressed at the same time from different threads share the threads 
+	of the pool, which take on the earliest image first.
+*/
+void SetThreadCount( int count );
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Gets the number of threads used to compress images.
+*/
+int GetThreadCount();
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Enables or disables the block cache of squish::CompressImage.
+
+	@param enabled	Whether repeated blocks should reuse an earlier result.
+
+	The cache is enabled by default. Identical source blocks are only 
+	compressed once per image and the result is copied to the others. This
+	does not change the output, but saves a lot of time on images with flat
+	areas or repeated tiles.
+*/
+void SetBlockCache( bool enabled );
+
+// -----------------------------------------------------------------------------
+
+//! The block cache counts of the last image that was compressed.
+struct BlockCacheStats
+{
+	//! The number of blocks that were looked up in the cache.
+	int blocks;
+
+	//! The number of blocks found in the table of the same worker.
+	int localHits;
+
+	//! The number of blocks found in the table shared by all the workers.
+	int sharedHits;
+};
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Gets the block cache counts of the last image that was compressed.
+
+	The hit rate is ( localHits + sharedHits )/blocks. A worker that finds 
+	almost nothing in its first thousand or so blocks stops looking, so the 
+	blocks it compresses after that are not counted. All the counts are zero
+	if the cache was disabled. After squish::CompressImages they are the 
+	counts of the whole batch.
+*/
+BlockCacheStats GetBlockCacheStats();
+
+// -----------------------------------------------------------------------------
+
+//! The instruction sets that the compression kernels are built for.
+enum
+{
+	//! Portable C++ code.
+	kInstructionSetScalar = 0,
+
+	//! SSE2 instructions.
+	kInstructionSetSse2 = 1,
+
+	//! AVX2 instructions.
+	kInstructionSetAvx2 = 2
+};
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Selects the compression kernels to use.
+
+	@param maximum	The highest instruction set that may be used.
+
+	The hot loops of the compressors are built once per instruction set and 
+	the fastest version that both this build and the processor support is 
+	picked through a table of function pointers. This normally happens the 
+	first time an image is compressed, so this function only needs to be 
+	called to limit the instruction set, for example to compare the output 
+	of the different kernels. The float cluster fits can give slightly 
+	different blocks with the scalar kernels than with the SSE2 and AVX2 
+	ones, which agree with each other, as the scalar code divides where the
+	others refine an approximate reciprocal. The fixed point cluster fit and
+	all the other kernels produce identical output on every instruction set.
+	The AVX2 kernels are only built by compilers that support AVX2, which is
+	Visual Studio 2012 or above with MSVC.
+
+	It is safe to call this while images are being processed on other 
+	threads. The new kernels are then only used once all of those images
+	are done, so every block of an image goes through the same kernels.
+
+	Returns the instruction set that was selected.
+*/
+int SetInstructionSet( int maximum );
+
+// -----------------------------------------------------------------------------
+
+/*! @brief Gets the instruction set of the compression kernels in use.
+*/
+int GetInstructionSet();
+
+// -----------------------------------------------------------------------------
+
 } // namespace squish
 
 #endif // ndef SQUISH_H
@@ -30,9 +30,10 @@ extern "C"
 {
 	void SquishInitialize( void )
 	{
-		// This function doesn't do anything. It exists solely to ensure that the Squish DLL is loaded
-		// and mapped into memory at an earlier point in time. That way the error checking can be
-		// a bit simpler for something like the DDS Paint.NET plugin.
+		// This function exists to ensure that the Squish DLL is loaded and mapped into memory at
+		// an earlier point in time. That way the error checking can be a bit simpler for something
+		// like the DDS Paint.NET plugin. It also picks the fastest kernels this CPU supports.
+		squish::SetInstructionSet( squish::kInstructionSetAvx2 );
 	}
 
 	void SquishCompressImage( char* rgba, int width, int height, void* blocks, int flags, squish::ProgressFn progressFn )
@@ -44,4 +45,89 @@ extern "C"
 	{
 		squish::DecompressImage( ( squish::u8* ) rgba, width, height, ( void const* )blocks, flags, progressFn );
 	}
+
+	int SquishCompressSurface( void* pixels, int width, int height, int stride, int pixelFormat, void* blocks, int flags, squish::ProgressFn progressFn, int const volatile* cancel )
+	{
+		return squish::CompressImage( ( const squish::u8* )pixels, width, height, stride, pixelFormat, blocks, flags, progressFn, cancel );
+	}
+
+	int SquishDecompressSurface( void* pixels, int width, int height, int stride, int pixelFormat, void* blocks, int flags, squish::ProgressFn progressFn, int const volatile* cancel )
+	{
+		return squish::DecompressImage( ( squish::u8* )pixels, width, height, stride, pixelFormat, ( void const* )blocks, flags, progressFn, cancel );
+	}
+
+	int SquishRecompressSurface( void* pixels, int width, int height, int stride, int pixelFormat, void* blocks, int flags, squish::DirtyRect const* rects, int rectCount, squish::ProgressFn progressFn, int const volatile* cancel )
+	{
+		return squish::RecompressImage( ( const squish::u8* )pixels, width, height, stride, pixelFormat, blocks, flags, rects, rectCount, progressFn, cancel );
+	}
+
+	int SquishCompressSurfaces( squish::BatchImage const* images, int count, squish::ProgressFn progressFn, int const volatile* cancel )
+	{
+		return squish::CompressImages( images, count, progressFn, cancel );
+	}
+
+	squish::Job* SquishSubmitSurfaces( squish::BatchImage const* images, int count, squish::ProgressFn progressFn, squish::CompletionFn completionFn )
+	{
+		return squish::SubmitImages( images, count, progressFn, completionFn );
+	}
+
+	int SquishPollJob( squish::Job* job )
+	{
+		return squish::PollJob( job );
+	}
+
+	int SquishWaitJob( squish::Job* job )
+	{
+		return squish::WaitJob( job );
+	}
+
+	void SquishCancelJob( squish::Job* job )
+	{
+		squish::CancelJob( job );
+	}
+
+	void SquishReleaseJob( squish::Job* job )
+	{
+		squish::ReleaseJob( job );
+	}
+
+	int SquishCompressMipmaps( void* pixels, int width, int height, int stride, int pixelFormat, int mipmapCount, int mipmapFlags, void* blocks, int flags, squish::ProgressFn progressFn, int const volatile* cancel )
+	{
+		return squish::CompressMipmaps( ( const squish::u8* )pixels, width, height, stride, pixelFormat, mipmapCount, mipmapFlags, blocks, flags, progressFn, cancel );
+	}
+
+	int SquishGenerateMipmaps( void* pixels, int width, int height, int stride, int pixelFormat, int mipmapCount, int mipmapFlags, void* mipmaps, squish::ProgressFn progressFn, int const volatile* cancel )
+	{
+		return squish::GenerateMipmaps( ( const squish::u8* )pixels, width, height, stride, pixelFormat, mipmapCount, mipmapFlags, mipmaps, progressFn, cancel );
+	}
+
+	int SquishRecompressMipmaps( void* pixels, int width, int height, int stride, int pixelFormat, int mipmapCount, int mipmapFlags, void* blocks, int flags, squish::DirtyRect const* rects, int rectCount, squish::ProgressFn progressFn, int const volatile* cancel )
+	{
+		return squish::RecompressMipmaps( ( const squish::u8* )pixels, width, height, stride, pixelFormat, mipmapCount, mipmapFlags, blocks, flags, rects, rectCount, progressFn, cancel );
+	}
+
+	int SquishPackSurface( void* pixels, int width, int height, int stride, int pixelFormat, void* packed, int pitch, int format, squish::ProgressFn progressFn, int const volatile* cancel )
+	{
+		return squish::PackImage( ( const squish::u8* )pixels, width, height, stride, pixelFormat, packed, pitch, format, progressFn, cancel );
+	}
+
+	int SquishUnpackSurface( void* pixels, int width, int height, int stride, int pixelFormat, void* packed, int pitch, int format, squish::ProgressFn progressFn, int const volatile* cancel )
+	{
+		return squish::UnpackImage( ( squish::u8* )pixels, width, height, stride, pixelFormat, ( void const* )packed, pitch, format, progressFn, cancel );
+	}
+
+	void SquishRecompressImage( char* rgba, int width, int height, void* blocks, int flags, squish::DirtyRect const* rects, int rectCount, squish::ProgressFn progressFn )
+	{
+		squish::RecompressImage( ( const squish::u8* )rgba, width, height, blocks, flags, rects, rectCount, progressFn );
+	}
+
+	void SquishGetMipDirtyRect( squish::DirtyRect const* rect, int width, int height, int level, int mipmapFlags, squish::DirtyRect* mipRect )
+	{
+		*mipRect = squish::GetMipDirtyRect( *rect, width, height, level, mipmapFlags );
+	}
+
+	void SquishSetThreadCount( int count )
+	{
+		squish::SetThreadCount( count );
+	}
 };
\ No newline at end of file
@@ -33,6 +33,23 @@ extern "C"
 	__declspec( dllexport ) void SquishInitialize( void );
 	__declspec( dllexport ) void SquishCompressImage( char*, int width, int height, void* blocks, int flags, squish::ProgressFn progressFn );
 	__declspec( dllexport ) void SquishDecompressImage( char* rgba, int width, int height, void* blocks, int flags, squish::ProgressFn progressFn );
+	__declspec( dllexport ) int SquishCompressSurface( void* pixels, int width, int height, int stride, int pixelFormat, void* blocks, int flags, squish::ProgressFn progressFn, int const volatile* cancel );
+	__declspec( dllexport ) int SquishDecompressSurface( void* pixels, int width, int height, int stride, int pixelFormat, void* blocks, int flags, squish::ProgressFn progressFn, int const volatile* cancel );
+	__declspec( dllexport ) int SquishRecompressSurface( void* pixels, int width, int height, int stride, int pixelFormat, void* blocks, int flags, squish::DirtyRect const* rects, int rectCount, squish::ProgressFn progressFn, int const volatile* cancel );
+	__declspec( dllexport ) int SquishCompressSurfaces( squish::BatchImage const* images, int count, squish::ProgressFn progressFn, int const volatile* cancel );
+	__declspec( dllexport ) squish::Job* SquishSubmitSurfaces( squish::BatchImage const* images, int count, squish::ProgressFn progressFn, squish::CompletionFn completionFn );
+	__declspec( dllexport ) int SquishPollJob( squish::Job* job );
+	__declspec( dllexport ) int SquishWaitJob( squish::Job* job );
+	__declspec( dllexport ) void SquishCancelJob( squish::Job* job );
+	__declspec( dllexport ) void SquishReleaseJob( squish::Job* job );
+	__declspec( dllexport ) int SquishCompressMipmaps( void* pixels, int width, int height, int stride, int pixelFormat, int mipmapCount, int mipmapFlags, void* blocks, int flags, squish::ProgressFn progressFn, int const volatile* cancel );
+	__declspec( dllexport ) int SquishGenerateMipmaps( void* pixels, int width, int height, int stride, int pixelFormat, int mipmapCount, int mipmapFlags, void* mipmaps, squish::ProgressFn progressFn, int const volatile* cancel );
+	__declspec( dllexport ) int SquishRecompressMipmaps( void* pixels, int width, int height, int stride, int pixelFormat, int mipmapCount, int mipmapFlags, void* blocks, int flags, squish::DirtyRect const* rects, int rectCount, squish::ProgressFn progressFn, int const volatile* cancel );
+	__declspec( dllexport ) int SquishPackSurface( void* pixels, int width, int height, int stride, int pixelFormat, void* packed, int pitch, int format, squish::ProgressFn progressFn, int const volatile* cancel );
+	__declspec( dllexport ) int SquishUnpackSurface( void* pixels, int width, int height, int stride, int pixelFormat, void* packed, int pitch, int format, squish::ProgressFn progressFn, int const volatile* cancel );
+	__declspec( dllexport ) void SquishRecompressImage( char* rgba, int width, int height, void* blocks, int flags, squish::DirtyRect const* rects, int rectCount, squish::ProgressFn progressFn );
+	__declspec( dllexport ) void SquishGetMipDirtyRect( squish::DirtyRect const* rect, int width, int height, int level, int mipmapFlags, squish::DirtyRect* mipRect );
+	__declspec( dllexport ) void SquishSetThreadCount( int count );
 }
 
 #endif	//SQUISH_INTERFACE_H
\ No newline at end of file
@@ -0,0 +1,723 @@
+/* -----------------------------------------------------------------------------
+
+	Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files (the 
+	"Software"), to	deal in the Software without restriction, including
+	without limitation the rights to use, copy, modify, merge, publish,
+	distribute, sublicense, and/or sell copies of the Software, and to 
+	permit persons to whom the Software is furnished to do so, subject to 
+	the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+	
+   -------------------------------------------------------------------------- */
+   
+#include "threadpool.h"
+#include <algorithm>
+#include <climits>
+
+#ifdef _WIN32
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0501
+#endif
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/time.h>
+#endif
+
+namespace squish {
+
+// -----------------------------------------------------------------------------
+// platform primitives
+
+#ifdef _WIN32
+
+long AtomicAdd( long volatile* target, long value )
+{
+	return InterlockedExchangeAdd( target, value ) + value;
+}
+
+long AtomicCompareExchange( long volatile* target, long exchange, long comparand )
+{
+	return InterlockedCompareExchange( target, exchange, comparand );
+}
+
+static unsigned int GetMilliseconds()
+{
+	return ( unsigned int )GetTickCount();
+}
+
+static int GetProcessorCount()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo( &info );
+	return ( int )info.dwNumberOfProcessors;
+}
+
+class Mutex
+{
+public:
+	Mutex() { InitializeCriticalSection( &m_cs ); }
+	~Mutex() { DeleteCriticalSection( &m_cs ); }
+
+	void Lock() { EnterCriticalSection( &m_cs ); }
+	void Unlock() { LeaveCriticalSection( &m_cs ); }
+
+private:
+	Mutex( Mutex const& );
+	Mutex& operator=( Mutex const& );
+
+	CRITICAL_SECTION m_cs;
+};
+
+class Semaphore
+{
+public:
+	Semaphore() : m_handle( CreateSemaphore( NULL, 0, LONG_MAX, NULL ) ) {}
+	~Semaphore() { CloseHandle( m_handle ); }
+
+	void Post() { ReleaseSemaphore( m_handle, 1, NULL ); }
+	void Wait() { WaitForSingleObject( m_handle, INFINITE ); }
+	bool Wait( int milliseconds ) { return WaitForSingleObject( m_handle, milliseconds ) == WAIT_OBJECT_0; }
+
+private:
+	Semaphore( Semaphore const& );
+	Semaphore& operator=( Semaphore const& );
+
+	HANDLE m_handle;
+};
+
+class Thread
+{
+public:
+	Thread() : m_handle( NULL ) {}
+
+	void Start( void ( *main )( void* ), void* arg )
+	{
+		m_main = main;
+		m_arg = arg;
+		m_handle = ( HANDLE )_beginthreadex( NULL, 0, &Entry, this, 0, NULL );
+	}
+
+	void Join()
+	{
+		WaitForSingleObject( m_handle, INFINITE );
+		CloseHandle( m_handle );
+	}
+
+private:
+	static unsigned __stdcall Entry( void* arg )
+	{
+		Thread* thread = reinterpret_cast< Thread* >( arg );
+		thread->m_main( thread->m_arg );
+		return 0;
+	}
+
+	HANDLE m_handle;
+	void ( *m_main )( void* );
+	void* m_arg;
+};
+
+#else
+
+long AtomicAdd( long volatile* target, long value )
+{
+	return __sync_add_and_fetch( target, value );
+}
+
+long AtomicCompareExchange( long volatile* target, long exchange, long comparand )
+{
+	return __sync_val_compare_and_swap( target, comparand, exchange );
+}
+
+static unsigned int GetMilliseconds()
+{
+	timeval now;
+	gettimeofday( &now, NULL );
+	return ( unsigned int )( now.tv_sec*1000 + now.tv_usec/1000 );
+}
+
+static int GetProcessorCount()
+{
+	long count = sysconf( _SC_NPROCESSORS_ONLN );
+	return ( count > 0 ) ? ( int )count : 1;
+}
+
+class Mutex
+{
+public:
+	Mutex() { pthread_mutex_init( &m_mutex, NULL ); }
+	~Mutex() { pthread_mutex_destroy( &m_mutex ); }
+
+	void Lock() { pthread_mutex_lock( &m_mutex ); }
+	void Unlock() { pthread_mutex_unlock( &m_mutex ); }
+
+private:
+	Mutex( Mutex const& );
+	Mutex& operator=( Mutex const& );
+
+	pthread_mutex_t m_mutex;
+};
+
+class Semaphore
+{
+public:
+	Semaphore() : m_count( 0 )
+	{
+		pthread_mutex_init( &m_mutex, NULL );
+		pthread_cond_init( &m_cond, NULL );
+	}
+
+	~Semaphore()
+	{
+		pthread_cond_destroy( &m_cond );
+		pthread_mutex_destroy( &m_mutex );
+	}
+
+	void Post()
+	{
+		pthread_mutex_lock( &m_mutex );
+		++m_count;
+		pthread_cond_signal( &m_cond );
+		pthread_mutex_unlock( &m_mutex );
+	}
+
+	void Wait()
+	{
+		pthread_mutex_lock( &m_mutex );
+		while( m_count == 0 )
+			pthread_cond_wait( &m_cond, &m_mutex );
+		--m_count;
+		pthread_mutex_unlock( &m_mutex );
+	}
+
+	bool Wait( int milliseconds )
+	{
+		// get the absolute time to give up at
+		timeval now;
+		gettimeofday( &now, NULL );
+		long nanoseconds = now.tv_usec*1000 + ( milliseconds % 1000 )*1000000L;
+		timespec until;
+		until.tv_sec = now.tv_sec + milliseconds/1000 + nanoseconds/1000000000L;
+		until.tv_nsec = nanoseconds % 1000000000L;
+
+		pthread_mutex_lock( &m_mutex );
+		while( m_count == 0 )
+		{
+			if( pthread_cond_timedwait( &m_cond, &m_mutex, &until ) == ETIMEDOUT )
+				break;
+		}
+		bool const posted = ( m_count > 0 );
+		if( posted )
+			--m_count;
+		pthread_mutex_unlock( &m_mutex );
+		return posted;
+	}
+
+private:
+	Semaphore( Semaphore const& );
+	Semaphore& operator=( Semaphore const& );
+
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_cond;
+	int m_count;
+};
+
+class Thread
+{
+public:
+	void Start( void ( *main )( void* ), void* arg )
+	{
+		m_main = main;
+		m_arg = arg;
+		pthread_create( &m_thread, NULL, &Entry, this );
+	}
+
+	void Join()
+	{
+		pthread_join( m_thread, NULL );
+	}
+
+private:
+	static void* Entry( void* arg )
+	{
+		Thread* thread = reinterpret_cast< Thread* >( arg );
+		thread->m_main( thread->m_arg );
+		return NULL;
+	}
+
+	pthread_t m_thread;
+	void ( *m_main )( void* );
+	void* m_arg;
+};
+
+#endif
+
+// -----------------------------------------------------------------------------
+// background threads
+
+class Event::Impl
+{
+public:
+	Impl() : m_set( false ) {}
+
+	void Set()
+	{
+		m_set = true;
+		m_semaphore.Post();
+	}
+
+	bool Wait( int milliseconds )
+	{
+		if( m_set )
+			return true;
+
+		// pass the post on so that every waiter wakes
+		bool posted = true;
+		if( milliseconds < 0 )
+			m_semaphore.Wait();
+		else
+			posted = m_semaphore.Wait( milliseconds );
+		if( posted )
+			m_semaphore.Post();
+		return posted;
+	}
+
+private:
+	Semaphore m_semaphore;
+	bool volatile m_set;
+};
+
+Event::Event() : m_impl( new Impl ) {}
+
+Event::~Event() { delete m_impl; }
+
+void Event::Set() { m_impl->Set(); }
+
+bool Event::Wait( int milliseconds ) { return m_impl->Wait( milliseconds ); }
+
+class CriticalSection::Impl
+{
+public:
+	Mutex mutex;
+};
+
+CriticalSection::CriticalSection() : m_impl( new Impl ) {}
+
+CriticalSection::~CriticalSection() { delete m_impl; }
+
+void CriticalSection::Enter() { m_impl->mutex.Lock(); }
+
+void CriticalSection::Leave() { m_impl->mutex.Unlock(); }
+
+struct DetachedStart
+{
+	void ( *main )( void* );
+	void* arg;
+};
+
+#ifdef _WIN32
+
+static unsigned __stdcall DetachedEntry( void* arg )
+{
+	DetachedStart start = *reinterpret_cast< DetachedStart* >( arg );
+	delete reinterpret_cast< DetachedStart* >( arg );
+	start.main( start.arg );
+	return 0;
+}
+
+void StartDetachedThread( void ( *main )( void* ), void* arg )
+{
+	DetachedStart* start = new DetachedStart;
+	start->main = main;
+	start->arg = arg;
+	HANDLE handle = ( HANDLE )_beginthreadex( NULL, 0, &DetachedEntry, start, 0, NULL );
+	if( handle != NULL )
+	{
+		CloseHandle( handle );
+	}
+	else
+	{
+		delete start;
+		main( arg );
+	}
+}
+
+#else
+
+static void* DetachedEntry( void* arg )
+{
+	DetachedStart start = *reinterpret_cast< DetachedStart* >( arg );
+	delete reinterpret_cast< DetachedStart* >( arg );
+	start.main( start.arg );
+	return NULL;
+}
+
+void StartDetachedThread( void ( *main )( void* ), void* arg )
+{
+	DetachedStart* start = new DetachedStart;
+	start->main = main;
+	start->arg = arg;
+	pthread_t thread;
+	if( pthread_create( &thread, NULL, &DetachedEntry, start ) == 0 )
+	{
+		pthread_detach( thread );
+	}
+	else
+	{
+		delete start;
+		main( arg );
+	}
+}
+
+#endif
+
+// -----------------------------------------------------------------------------
+// progress
+
+// how often the calling thread wakes to report progress while it waits
+enum { kPollMilliseconds = 50 };
+
+ProgressReporter::ProgressReporter( ProgressFn progressFn, int total, int reportTotal )
+  : m_progressFn( progressFn ), 
+	m_total( std::max( total, 1 ) ), 
+	m_reportTotal( reportTotal ), 
+	m_step( std::max( total/100, 1 ) ), 
+	m_done( 0 ), 
+	m_reported( 0 ), 
+	m_reportTime( GetMilliseconds() )
+{
+}
+
+void ProgressReporter::Add( int work )
+{
+	if( m_progressFn != NULL )
+		AtomicAdd( &m_done, work );
+}
+
+void ProgressReporter::Poll()
+{
+	// only look at the clock once there is something new to report
+	long const done = m_done;
+	if( m_progressFn == NULL || done == m_reported )
+		return;
+	unsigned int const now = GetMilliseconds();
+	if( done - m_reported < m_step && now - m_reportTime < ( unsigned int )kPollMilliseconds )
+		return;
+
+	m_reported = done;
+	m_reportTime = now;
+	m_progressFn( ( int )( ( ( double )done*m_reportTotal )/m_total ), m_reportTotal );
+}
+
+// -----------------------------------------------------------------------------
+// work-stealing pool
+
+class ThreadPool
+{
+public:
+	explicit ThreadPool( int threadCount );
+	~ThreadPool();
+
+	//! Gets the number of threads that can work on one task, counting its caller.
+	int GetThreadCount() const { return m_helperCount + 1; }
+
+	void Run( ParallelTask& task, int count, int workerCount );
+
+private:
+	struct Range
+	{
+		Mutex lock;
+		int begin;
+		int end;
+	};
+
+	/*! @brief The items of one call to Run.
+
+		The caller is worker 0 and each helper that joins takes the next
+		worker number, up to the worker count of the call. The counts and 
+		flags are guarded by the pool lock.
+	*/
+	struct Job
+	{
+		ParallelTask* task;
+		Range* ranges;
+		int workerCount;
+		int joined;
+		int helpers;
+		bool closed;
+		bool exhausted;
+		Semaphore done;
+		Job* next;
+	};
+
+	ThreadPool( ThreadPool const& );
+	ThreadPool& operator=( ThreadPool const& );
+
+	static void HelperMain( void* arg );
+
+	void Help();
+	void Work( Job& job, int index );
+	bool Steal( Job& job, int index );
+
+	int m_helperCount;
+	Thread* m_helpers;
+	Mutex m_lock;
+	Semaphore m_wake;
+	Job* m_jobs;
+	bool m_quit;
+};
+
+ThreadPool::ThreadPool( int threadCount )
+  : m_helperCount( threadCount - 1 ), 
+	m_helpers( new Thread[threadCount] ), 
+	m_jobs( NULL ), 
+	m_quit( false )
+{
+	// the callers of Run work too, so only start the helpers
+	for( int i = 0; i < m_helperCount; ++i )
+		m_helpers[i].Start( &HelperMain, this );
+}
+
+ThreadPool::~ThreadPool()
+{
+	// wake the helpers with the quit flag set and wait for them to exit
+	m_lock.Lock();
+	m_quit = true;
+	m_lock.Unlock();
+	for( int i = 0; i < m_helperCount; ++i )
+		m_wake.Post();
+	for( int i = 0; i < m_helperCount; ++i )
+		m_helpers[i].Join();
+	delete[] m_helpers;
+}
+
+void ThreadPool::HelperMain( void* arg )
+{
+	reinterpret_cast< ThreadPool* >( arg )->Help();
+}
+
+void ThreadPool::Help()
+{
+	for( ;; )
+	{
+		// join the oldest job that still has items and room for another worker
+		m_lock.Lock();
+		Job* job = m_jobs;
+		while( job != NULL && ( job->exhausted || job->joined == job->workerCount ) )
+			job = job->next;
+		int index = 0;
+		if( job != NULL )
+		{
+			index = job->joined++;
+			++job->helpers;
+		}
+		bool const quit = m_quit;
+		m_lock.Unlock();
+
+		// sleep until there is a new job or we are asked to quit
+		if( job == NULL )
+		{
+			if( quit )
+				break;
+			m_wake.Wait();
+			continue;
+		}
+
+		// run until there is nothing left to steal
+		Work( *job, index );
+
+		// the last helper to leave a closed job releases its caller
+		m_lock.Lock();
+		if( --job->helpers == 0 && job->closed )
+			job->done.Post();
+		m_lock.Unlock();
+	}
+}
+
+void ThreadPool::Run( ParallelTask& task, int count, int workerCount )
+{
+	// split the items into one contiguous range per worker that can join
+	int const used = std::min( std::min( workerCount, GetThreadCount() ), count );
+	Job job;
+	job.task = &task;
+	job.ranges = new Range[workerCount];
+	for( int i = 0; i < workerCount; ++i )
+	{
+		Range& range = job.ranges[i];
+		range.begin = ( i < used ) ? ( int )( ( ( double )count*i )/used ) : 0;
+		range.end = ( i < used ) ? ( int )( ( ( double )count*( i + 1 ) )/used ) : 0;
+	}
+	job.workerCount = workerCount;
+	job.joined = 1;
+	job.helpers = 0;
+	job.closed = false;
+	job.exhausted = false;
+	job.next = NULL;
+
+	// queue the job behind any others, wake enough helpers for it and join in ourselves
+	m_lock.Lock();
+	Job** tail = &m_jobs;
+	while( *tail != NULL )
+		tail = &( *tail )->next;
+	*tail = &job;
+	m_lock.Unlock();
+	for( int i = 1; i < used; ++i )
+		m_wake.Post();
+	Work( job, 0 );
+
+	// stop any more helpers joining, and take the job off the queue
+	m_lock.Lock();
+	job.closed = true;
+	tail = &m_jobs;
+	while( *tail != &job )
+		tail = &( *tail )->next;
+	*tail = job.next;
+	bool const wait = ( job.helpers > 0 );
+	m_lock.Unlock();
+
+	// wait for any items that were stolen from us to complete, polling as we go
+	if( wait )
+	{
+		while( !job.done.Wait( kPollMilliseconds ) )
+			task.Poll();
+
+		// the helper posts under the lock, so it is done with the job once we get it
+		m_lock.Lock();
+		m_lock.Unlock();
+	}
+	delete[] job.ranges;
+}
+
+void ThreadPool::Work( Job& job, int index )
+{
+	Range& self = job.ranges[index];
+	for( ;; )
+	{
+		// take the next item from the front of our own range
+		self.lock.Lock();
+		int item = self.begin;
+		bool found = ( item < self.end );
+		if( found )
+			++self.begin;
+		self.lock.Unlock();
+
+		// run it, or refill our range from another worker
+		if( found )
+		{
+			job.task->Run( item, index );
+			if( index == 0 )
+				job.task->Poll();
+		}
+		else if( !Steal( job, index ) )
+			break;
+	}
+}
+
+bool ThreadPool::Steal( Job& job, int index )
+{
+	for( int i = 1; i < job.workerCount; ++i )
+	{
+		// take the back half of the victim's remaining range
+		Range& victim = job.ranges[( index + i ) % job.workerCount];
+		victim.lock.Lock();
+		int end = victim.end;
+		int begin = end - ( end - victim.begin + 1 )/2;
+		if( begin < end )
+			victim.end = begin;
+		victim.lock.Unlock();
+
+		// make it our own range
+		if( begin < end )
+		{
+			Range& self = job.ranges[index];
+			self.lock.Lock();
+			self.begin = begin;
+			self.end = end;
+			self.lock.Unlock();
+			return true;
+		}
+	}
+
+	// the ranges only shrink, so no helper that joins later will find anything
+	m_lock.Lock();
+	job.exhausted = true;
+	m_lock.Unlock();
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// shared pool
+
+// the pool is deliberately never destroyed, since joining threads while the 
+// module is being unloaded can deadlock on Windows
+static ThreadPool* g_pool = NULL;
+static Mutex g_poolLock;
+static int g_poolUsers = 0;
+static long volatile g_threadCount = 0;
+
+int GetWorkerCount()
+{
+	int count = ( int )g_threadCount;
+	return ( count > 0 ) ? count : GetProcessorCount();
+}
+
+void ParallelFor( ParallelTask& task, int count, int workerCount )
+{
+	// run on the calling thread alone when there is nothing to share
+	if( workerCount <= 1 || count <= 1 )
+	{
+		for( int i = 0; i < count; ++i )
+		{
+			task.Run( i, 0 );
+			task.Poll();
+		}
+		return;
+	}
+
+	// (re)create the pool for a new thread count once nobody is using it, 
+	// while concurrent and nested calls share the helpers of the current one
+	g_poolLock.Lock();
+	if( g_pool == NULL || ( g_poolUsers == 0 && g_pool->GetThreadCount() != workerCount ) )
+	{
+		delete g_pool;
+		g_pool = new ThreadPool( workerCount );
+	}
+	ThreadPool* pool = g_pool;
+	++g_poolUsers;
+	g_poolLock.Unlock();
+
+	pool->Run( task, count, workerCount );
+
+	g_poolLock.Lock();
+	--g_poolUsers;
+	g_poolLock.Unlock();
+}
+
+void SetThreadCount( int count )
+{
+	g_threadCount = std::max( count, 0 );
+}
+
+int GetThreadCount()
+{
+	return GetWorkerCount();
+}
+
+} // namespace squish
@@ -0,0 +1,152 @@
+/* -----------------------------------------------------------------------------
+
+	Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files (the 
+	"Software"), to	deal in the Software without restriction, including
+	without limitation the rights to use, copy, modify, merge, publish,
+	distribute, sublicense, and/or sell copies of the Software, and to 
+	permit persons to whom the Software is furnished to do so, subject to 
+	the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+	
+   -------------------------------------------------------------------------- */
+   
+#ifndef SQUISH_THREADPOOL_H
+#define SQUISH_THREADPOOL_H
+
+#include <squish.h>
+
+namespace squish {
+
+/*! @brief A unit of parallel work that is split into independent items.
+
+	Items are handed out to the pool workers in contiguous ranges. A worker
+	that runs out of items steals half of the remaining range of another 
+	worker, so items with very different costs still balance well.
+*/
+class ParallelTask
+{
+public:
+	virtual ~ParallelTask() {}
+
+	//! Processes a single item on the given worker (0 is the calling thread).
+	virtual void Run( int item, int worker ) = 0;
+
+	//! Called regularly on the calling thread until every item is done.
+	virtual void Poll() {}
+};
+
+/*! @brief Runs items [0, count) of the task on the shared pool and waits for them.
+
+	The items are run on at most workerCount workers, numbered from 0, so 
+	a task can size its storage for each worker from the same count. The 
+	calling thread is worker 0. Calls from several threads at once, or from
+	inside a task, queue their items on the same helper threads, and each
+	helper works through the oldest call that still has items to hand out.
+*/
+void ParallelFor( ParallelTask& task, int count, int workerCount );
+
+//! Returns the number of workers for the thread count (at least 1), to read once for each ParallelFor.
+int GetWorkerCount();
+
+/*! @brief Reports the progress of a parallel task on the calling thread only.
+
+	Workers record the work they finish with a single atomic add. The 
+	calling thread samples the total from ParallelTask::Poll and makes the
+	callback once another 1% of the work is done, or once 50ms have passed
+	with some progress, so the callback is never made from the workers.
+*/
+class ProgressReporter
+{
+public:
+	//! Reports progress out of reportTotal for work that adds up to total.
+	ProgressReporter( ProgressFn progressFn, int total, int reportTotal );
+
+	//! Records finished work from any thread.
+	void Add( int work );
+
+	//! Makes the callback if enough has changed since the last one.
+	void Poll();
+
+private:
+	ProgressFn m_progressFn;
+	int m_total;
+	int m_reportTotal;
+	int m_step;
+	long volatile m_done;
+	long m_reported;
+	unsigned int m_reportTime;
+};
+
+/*! @brief A flag that threads can wait on, which stays set once it is set.
+*/
+class Event
+{
+public:
+	Event();
+	~Event();
+
+	//! Sets the flag and wakes every thread that is waiting for it.
+	void Set();
+
+	//! Waits for the flag for up to the given time, or forever if it is negative, and returns true if it is set.
+	bool Wait( int milliseconds );
+
+private:
+	Event( Event const& );
+	Event& operator=( Event const& );
+
+	class Impl;
+	Impl* m_impl;
+};
+
+/*! @brief A lock for short sections of shared state, which one thread may hold at a time.
+*/
+class CriticalSection
+{
+public:
+	CriticalSection();
+	~CriticalSection();
+
+	//! Waits until no other thread holds the lock, then takes it.
+	void Enter();
+
+	//! Releases the lock.
+	void Leave();
+
+private:
+	CriticalSection( CriticalSection const& );
+	CriticalSection& operator=( CriticalSection const& );
+
+	class Impl;
+	Impl* m_impl;
+};
+
+/*! @brief Runs main( arg ) on a new thread that nobody joins.
+
+	If the thread cannot be created, main is run on the calling thread 
+	before this returns.
+*/
+void StartDetachedThread( void ( *main )( void* ), void* arg );
+
+//! Atomically adds value to target and returns the new value.
+long AtomicAdd( long volatile* target, long value );
+
+//! Atomically sets target to exchange if it equals comparand and returns the old value.
+long AtomicCompareExchange( long volatile* target, long exchange, long comparand );
+
+} // namespace squish
+
+#endif // ndef SQUISH_THREADPOOL_H
@@ -177,7 +177,6 @@ namespace PaintDotNet
                     "ShellExtension_x86.dll",
                     "Squish_x64.dll",
                     "Squish_x86.dll",
-                    "Squish_x86_SSE2.dll",
                     "UpdateMonitor.exe",
                     "WiaProxy32.exe"
                 };